@@ -0,0 +1,624 @@
+/* file_pcm_plugin.c
+**
+** Copyright (c) 2026, The Linux Foundation. All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above
+**     copyright notice, this list of conditions and the following
+**     disclaimer in the documentation and/or other materials provided
+**     with the distribution.
+**   * Neither the name of The Linux Foundation nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+** WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+** ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+** BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+** CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+** SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+** WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+** OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+** IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**/
+
+/*
+ * A PCM plugin backed by WAV files, to run streams on machines without
+ * audio hardware.
+ *
+ * Playback writes the frames to <dir>/pcmC<card>D<device>p.wav and capture
+ * reads them from <dir>/pcmC<card>D<device>c.wav, whose format is the only
+ * one the stream accepts. Capture goes on with silence once the file ends.
+ * <dir> is TINYALSA_FILE_PCM_DIR, the current directory by default.
+ *
+ * TINYALSA_FILE_PCM_PACE sets how fast streams run: "realtime", the
+ * default, paces the transfers with the clock the way a device would,
+ * and "fast" transfers the frames as fast as the file allows.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sound/asound.h>
+#include <tinyalsa/plugin.h>
+#include <tinyalsa/asoundlib.h>
+
+#define ID_RIFF 0x46464952
+#define ID_WAVE 0x45564157
+#define ID_FMT  0x20746d66
+#define ID_DATA 0x61746164
+
+#define WAVE_FORMAT_PCM 0x0001
+#define WAVE_FORMAT_IEEE_FLOAT 0x0003
+
+#define PCM_FORMAT_BIT(x) (1ULL << x)
+#define NSEC_PER_SEC 1000000000ULL
+
+struct riff_wave_header {
+    uint32_t riff_id;
+    uint32_t riff_sz;
+    uint32_t wave_id;
+};
+
+struct chunk_header {
+    uint32_t id;
+    uint32_t sz;
+};
+
+struct chunk_fmt {
+    uint16_t audio_format;
+    uint16_t num_channels;
+    uint32_t sample_rate;
+    uint32_t byte_rate;
+    uint16_t block_align;
+    uint16_t bits_per_sample;
+};
+
+/* The header of the files written by playback streams */
+struct wav_header {
+    struct riff_wave_header riff;
+    struct chunk_header fmt_header;
+    struct chunk_fmt fmt;
+    struct chunk_header data_header;
+};
+
+struct file_pcm_priv {
+    FILE *file;
+    struct pcm_plugin_hw_constraints constrs;
+    int realtime;
+
+    int format;
+    unsigned int channels;
+    unsigned int rate;
+    unsigned int frame_bytes;
+    snd_pcm_uframes_t period_size;
+    snd_pcm_uframes_t buffer_size;
+
+    /* bytes of the data chunk, written so far or left to read */
+    uint32_t data_bytes;
+
+    /* frames transferred since the stream was prepared */
+    snd_pcm_uframes_t pos;
+    /* when the stream started, the clock of realtime streams */
+    struct timespec start;
+    int started;
+};
+
+static unsigned int file_pcm_format_bits(int format)
+{
+    switch (format) {
+    case SNDRV_PCM_FORMAT_S32_LE:
+    case SNDRV_PCM_FORMAT_FLOAT_LE:
+        return 32;
+    case SNDRV_PCM_FORMAT_S24_3LE:
+        return 24;
+    default:
+    case SNDRV_PCM_FORMAT_S16_LE:
+        return 16;
+    };
+}
+
+static int file_pcm_wave_format(const struct chunk_fmt *fmt)
+{
+    if (fmt->audio_format == WAVE_FORMAT_IEEE_FLOAT)
+        return fmt->bits_per_sample == 32 ? SNDRV_PCM_FORMAT_FLOAT_LE : -EINVAL;
+    if (fmt->audio_format != WAVE_FORMAT_PCM)
+        return -EINVAL;
+
+    switch (fmt->bits_per_sample) {
+    case 16:
+        return SNDRV_PCM_FORMAT_S16_LE;
+    case 24:
+        return SNDRV_PCM_FORMAT_S24_3LE;
+    case 32:
+        return SNDRV_PCM_FORMAT_S32_LE;
+    default:
+        return -EINVAL;
+    }
+}
+
+/* Finds the data chunk of a capture file, and restricts the stream to its format */
+static int file_pcm_read_header(struct file_pcm_priv *priv)
+{
+    struct riff_wave_header riff;
+    struct chunk_header chunk;
+    struct chunk_fmt fmt;
+    int format = -EINVAL;
+
+    if (fread(&riff, sizeof(riff), 1, priv->file) != 1 ||
+        riff.riff_id != ID_RIFF || riff.wave_id != ID_WAVE)
+        return -EINVAL;
+
+    for (;;) {
+        if (fread(&chunk, sizeof(chunk), 1, priv->file) != 1)
+            return -EINVAL;
+
+        if (chunk.id == ID_DATA)
+            break;
+
+        if (chunk.id == ID_FMT) {
+            if (chunk.sz < sizeof(fmt) || fread(&fmt, sizeof(fmt), 1, priv->file) != 1)
+                return -EINVAL;
+            format = file_pcm_wave_format(&fmt);
+            chunk.sz -= sizeof(fmt);
+        }
+
+        /* chunks are padded to an even size */
+        if (fseek(priv->file, chunk.sz + (chunk.sz & 1), SEEK_CUR))
+            return -errno;
+    }
+
+    if (format < 0 || !fmt.num_channels || !fmt.sample_rate)
+        return -EINVAL;
+
+    priv->data_bytes = chunk.sz;
+    priv->constrs.format = PCM_FORMAT_BIT(format);
+    priv->constrs.bit_width.min = priv->constrs.bit_width.max = file_pcm_format_bits(format);
+    priv->constrs.channels.min = priv->constrs.channels.max = fmt.num_channels;
+    priv->constrs.rate.min = priv->constrs.rate.max = fmt.sample_rate;
+    return 0;
+}
+
+/* Rewrites the header of a playback file with the size of the frames written so far */
+static int file_pcm_write_header(struct file_pcm_priv *priv)
+{
+    struct wav_header header;
+    unsigned int bits = file_pcm_format_bits(priv->format);
+
+    header.riff.riff_id = ID_RIFF;
+    header.riff.riff_sz = sizeof(header) - 8 + priv->data_bytes;
+    header.riff.wave_id = ID_WAVE;
+    header.fmt_header.id = ID_FMT;
+    header.fmt_header.sz = sizeof(header.fmt);
+    header.fmt.audio_format = priv->format == SNDRV_PCM_FORMAT_FLOAT_LE ?
+                              WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
+    header.fmt.num_channels = priv->channels;
+    header.fmt.sample_rate = priv->rate;
+    header.fmt.byte_rate = priv->rate * priv->frame_bytes;
+    header.fmt.block_align = priv->frame_bytes;
+    header.fmt.bits_per_sample = bits;
+    header.data_header.id = ID_DATA;
+    header.data_header.sz = priv->data_bytes;
+
+    if (fseek(priv->file, 0, SEEK_SET) ||
+        fwrite(&header, sizeof(header), 1, priv->file) != 1 ||
+        fseek(priv->file, 0, SEEK_END) || fflush(priv->file))
+        return -EIO;
+
+    return 0;
+}
+
+static void file_pcm_frames_to_time(struct file_pcm_priv *priv,
+                snd_pcm_uframes_t frames, struct timespec *ts)
+{
+    uint64_t ns = (uint64_t) frames * NSEC_PER_SEC / priv->rate;
+
+    ts->tv_sec = priv->start.tv_sec + ns / NSEC_PER_SEC;
+    ts->tv_nsec = priv->start.tv_nsec + ns % NSEC_PER_SEC;
+    if (ts->tv_nsec >= (long) NSEC_PER_SEC) {
+        ts->tv_sec++;
+        ts->tv_nsec -= NSEC_PER_SEC;
+    }
+}
+
+static int file_pcm_time_before(const struct timespec *a, const struct timespec *b)
+{
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+static void file_pcm_start_clock(struct file_pcm_priv *priv)
+{
+    if (priv->started)
+        return;
+
+    clock_gettime(CLOCK_MONOTONIC, &priv->start);
+    priv->started = 1;
+}
+
+/* Frames the clock of the stream went through since it started */
+static snd_pcm_uframes_t file_pcm_elapsed(struct file_pcm_priv *priv)
+{
+    struct timespec now;
+    uint64_t ns;
+
+    if (!priv->started)
+        return 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ns = (uint64_t) (now.tv_sec - priv->start.tv_sec) * NSEC_PER_SEC +
+         now.tv_nsec - priv->start.tv_nsec;
+    return ns * priv->rate / NSEC_PER_SEC;
+}
+
+static snd_pcm_uframes_t file_pcm_hw_ptr(struct pcm_plugin *plugin)
+{
+    struct file_pcm_priv *priv = plugin->priv;
+    snd_pcm_uframes_t elapsed;
+
+    /* fast streams play the frames as soon as they are written,
+     * and always have a buffer of frames to capture
+     */
+    if (!priv->realtime)
+        return plugin->mode & PCM_IN ? priv->pos + priv->buffer_size : priv->pos;
+
+    elapsed = file_pcm_elapsed(priv);
+    if (plugin->mode & PCM_IN)
+        return elapsed < priv->pos + priv->buffer_size ?
+               elapsed : priv->pos + priv->buffer_size;
+
+    return elapsed < priv->pos ? elapsed : priv->pos;
+}
+
+/* Waits until the clock of the stream went through the given frames */
+static int file_pcm_wait(struct pcm_plugin *plugin, snd_pcm_uframes_t frames)
+{
+    struct file_pcm_priv *priv = plugin->priv;
+    struct timespec deadline, now;
+    int rc;
+
+    if (!priv->realtime)
+        return 0;
+
+    file_pcm_start_clock(priv);
+    file_pcm_frames_to_time(priv, frames, &deadline);
+
+    if (plugin->mode & PCM_NONBLOCK) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return file_pcm_time_before(&now, &deadline) ? -EAGAIN : 0;
+    }
+
+    do {
+        rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+    } while (rc == EINTR);
+
+    return -rc;
+}
+
+/* Frames the clock must go through before the stream can transfer the given frames */
+static snd_pcm_uframes_t file_pcm_ready_at(struct pcm_plugin *plugin,
+                snd_pcm_uframes_t frames)
+{
+    struct file_pcm_priv *priv = plugin->priv;
+
+    if (plugin->mode & PCM_IN)
+        return priv->pos + frames;
+
+    /* playback waits for room in the buffer */
+    if (priv->pos + frames <= priv->buffer_size)
+        return 0;
+    return priv->pos + frames - priv->buffer_size;
+}
+
+static int file_pcm_hw_params(struct pcm_plugin *plugin,
+                struct snd_pcm_hw_params *params)
+{
+    struct file_pcm_priv *priv = plugin->priv;
+    struct snd_mask *format;
+
+    format = &params->masks[SNDRV_PCM_HW_PARAM_FORMAT - SNDRV_PCM_HW_PARAM_FIRST_MASK];
+    for (priv->format = 0; priv->format < 32; priv->format++)
+        if (format->bits[0] & (1U << priv->format))
+            break;
+    priv->channels = params->intervals[SNDRV_PCM_HW_PARAM_CHANNELS -
+                                       SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].min;
+    priv->rate = params->intervals[SNDRV_PCM_HW_PARAM_RATE -
+                                   SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].min;
+    priv->period_size = params->intervals[SNDRV_PCM_HW_PARAM_PERIOD_SIZE -
+                                          SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].min;
+    priv->buffer_size = params->intervals[SNDRV_PCM_HW_PARAM_BUFFER_SIZE -
+                                          SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].min;
+    priv->frame_bytes = priv->channels * file_pcm_format_bits(priv->format) / 8;
+
+    if (plugin->mode & PCM_IN)
+        return 0;
+
+    /* a new stream starts a new file */
+    priv->data_bytes = 0;
+    if (fflush(priv->file) || ftruncate(fileno(priv->file), 0))
+        return -errno;
+
+    return file_pcm_write_header(priv);
+}
+
+static int file_pcm_sw_params(struct pcm_plugin *plugin,
+                struct snd_pcm_sw_params *sparams)
+{
+    return 0;
+}
+
+static int file_pcm_sync_ptr(struct pcm_plugin *plugin,
+                struct snd_pcm_sync_ptr *sync_ptr)
+{
+    struct file_pcm_priv *priv = plugin->priv;
+
+    /* the stream keeps its own application pointer */
+    if (sync_ptr->flags & SNDRV_PCM_SYNC_PTR_APPL)
+        sync_ptr->c.control.appl_ptr = priv->pos;
+    sync_ptr->s.status.hw_ptr = file_pcm_hw_ptr(plugin);
+
+    return 0;
+}
+
+static int file_pcm_writei_frames(struct pcm_plugin *plugin, struct snd_xferi *x)
+{
+    struct file_pcm_priv *priv = plugin->priv;
+    size_t bytes = x->frames * priv->frame_bytes;
+    int rc;
+
+    rc = file_pcm_wait(plugin, file_pcm_ready_at(plugin, x->frames));
+    if (rc)
+        return rc;
+
+    if (fwrite(x->buf, 1, bytes, priv->file) != bytes)
+        return -EIO;
+
+    priv->data_bytes += bytes;
+    priv->pos += x->frames;
+    x->result = x->frames;
+    return 0;
+}
+
+static int file_pcm_readi_frames(struct pcm_plugin *plugin, struct snd_xferi *x)
+{
+    struct file_pcm_priv *priv = plugin->priv;
+    size_t bytes = x->frames * priv->frame_bytes;
+    size_t len = 0;
+    int rc;
+
+    rc = file_pcm_wait(plugin, file_pcm_ready_at(plugin, x->frames));
+    if (rc)
+        return rc;
+
+    if (priv->data_bytes)
+        len = fread(x->buf, 1, bytes < priv->data_bytes ? bytes : priv->data_bytes,
+                    priv->file);
+
+    priv->data_bytes -= len;
+    memset((char *) x->buf + len, 0, bytes - len);
+
+    priv->pos += x->frames;
+    x->result = x->frames;
+    return 0;
+}
+
+static int file_pcm_ttstamp(struct pcm_plugin *plugin, int *tstamp)
+{
+    return 0;
+}
+
+static int file_pcm_prepare(struct pcm_plugin *plugin)
+{
+    struct file_pcm_priv *priv = plugin->priv;
+
+    priv->pos = 0;
+    priv->started = 0;
+    return 0;
+}
+
+static int file_pcm_start(struct pcm_plugin *plugin)
+{
+    file_pcm_start_clock(plugin->priv);
+    return 0;
+}
+
+static int file_pcm_drain(struct pcm_plugin *plugin)
+{
+    struct file_pcm_priv *priv = plugin->priv;
+    int rc;
+
+    if (plugin->mode & PCM_IN)
+        return 0;
+
+    rc = file_pcm_wait(plugin, priv->pos);
+    if (rc)
+        return rc;
+
+    return file_pcm_write_header(priv);
+}
+
+static int file_pcm_drop(struct pcm_plugin *plugin)
+{
+    struct file_pcm_priv *priv = plugin->priv;
+
+    priv->started = 0;
+    return 0;
+}
+
+static int file_pcm_ioctl(struct pcm_plugin *plugin, int cmd, void *arg)
+{
+    /* the pointers are computed each time they are synced */
+    if (cmd == (int) SNDRV_PCM_IOCTL_HWSYNC)
+        return 0;
+
+    return -ENOTTY;
+}
+
+static void *file_pcm_mmap(struct pcm_plugin *plugin, void *addr, size_t length, int prot,
+                int flags, off_t offset)
+{
+    return MAP_FAILED;
+}
+
+static int file_pcm_munmap(struct pcm_plugin *plugin, void *addr, size_t length)
+{
+    return 0;
+}
+
+/* Waits until a period can be transferred */
+static int file_pcm_poll(struct pcm_plugin *plugin, struct pollfd *pfd,
+                nfds_t nfds, int timeout)
+{
+    struct file_pcm_priv *priv = plugin->priv;
+    struct timespec deadline, limit;
+    int rc;
+
+    if (priv->realtime) {
+        file_pcm_start_clock(priv);
+        file_pcm_frames_to_time(priv, file_pcm_ready_at(plugin, priv->period_size),
+                                &deadline);
+
+        if (timeout >= 0) {
+            clock_gettime(CLOCK_MONOTONIC, &limit);
+            limit.tv_sec += timeout / 1000;
+            limit.tv_nsec += (timeout % 1000) * 1000000L;
+            if (limit.tv_nsec >= (long) NSEC_PER_SEC) {
+                limit.tv_sec++;
+                limit.tv_nsec -= NSEC_PER_SEC;
+            }
+            if (file_pcm_time_before(&limit, &deadline)) {
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &limit, NULL);
+                return 0;
+            }
+        }
+
+        do {
+            rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+        } while (rc == EINTR);
+    }
+
+    pfd->revents = plugin->mode & PCM_IN ? POLLIN : POLLOUT;
+    return 1;
+}
+
+static int file_pcm_close(struct pcm_plugin *plugin)
+{
+    struct file_pcm_priv *priv = plugin->priv;
+    int ret = 0;
+
+    if (!(plugin->mode & PCM_IN) && priv->frame_bytes)
+        ret = file_pcm_write_header(priv);
+
+    fclose(priv->file);
+    free(priv);
+    free(plugin);
+
+    return ret;
+}
+
+int file_pcm_open(struct pcm_plugin **plugin, unsigned int card,
+                  unsigned int device, unsigned int mode)
+{
+    struct pcm_plugin *file_pcm_plugin;
+    struct file_pcm_priv *priv;
+    const char *dir, *pace;
+    char fname[PATH_MAX];
+    int ret = 0;
+
+    file_pcm_plugin = calloc(1, sizeof(struct pcm_plugin));
+    if (!file_pcm_plugin)
+        return -ENOMEM;
+
+    priv = calloc(1, sizeof(struct file_pcm_priv));
+    if (!priv) {
+        ret = -ENOMEM;
+        goto err_plugin_free;
+    }
+
+    pace = getenv("TINYALSA_FILE_PCM_PACE");
+    priv->realtime = !pace || strcmp(pace, "fast");
+
+    dir = getenv("TINYALSA_FILE_PCM_DIR");
+    snprintf(fname, sizeof(fname), "%s/pcmC%uD%u%c.wav", dir ? dir : ".",
+             card, device, mode & PCM_IN ? 'c' : 'p');
+
+    priv->file = fopen(fname, mode & PCM_IN ? "rb" : "wb");
+    if (!priv->file) {
+        ret = -errno;
+        fprintf(stderr, "%s: unable to open %s: %s\n", __func__, fname, strerror(errno));
+        goto err_priv_free;
+    }
+
+    priv->constrs.access = PCM_FORMAT_BIT(SNDRV_PCM_ACCESS_RW_INTERLEAVED);
+    priv->constrs.format = (PCM_FORMAT_BIT(SNDRV_PCM_FORMAT_S16_LE) |
+                            PCM_FORMAT_BIT(SNDRV_PCM_FORMAT_S24_3LE) |
+                            PCM_FORMAT_BIT(SNDRV_PCM_FORMAT_S32_LE) |
+                            PCM_FORMAT_BIT(SNDRV_PCM_FORMAT_FLOAT_LE));
+    priv->constrs.bit_width.min = 16;
+    priv->constrs.bit_width.max = 32;
+    priv->constrs.channels.min = 1;
+    priv->constrs.channels.max = 8;
+    priv->constrs.rate.min = 8000;
+    priv->constrs.rate.max = 384000;
+    priv->constrs.periods.min = 1;
+    priv->constrs.periods.max = 8;
+    priv->constrs.period_bytes.min = 96;
+    priv->constrs.period_bytes.max = 122880;
+
+    if (mode & PCM_IN) {
+        ret = file_pcm_read_header(priv);
+        if (ret) {
+            fprintf(stderr, "%s: %s is not a supported wave file\n", __func__, fname);
+            goto err_file_close;
+        }
+    }
+
+    file_pcm_plugin->card = card;
+    file_pcm_plugin->device = device;
+    file_pcm_plugin->mode = mode;
+    file_pcm_plugin->constraints = &priv->constrs;
+    file_pcm_plugin->priv = priv;
+
+    *plugin = file_pcm_plugin;
+    return 0;
+
+err_file_close:
+    fclose(priv->file);
+err_priv_free:
+    free(priv);
+err_plugin_free:
+    free(file_pcm_plugin);
+    return ret;
+}
+
+struct pcm_plugin_ops pcm_plugin_ops = {
+    .open = file_pcm_open,
+    .close = file_pcm_close,
+    .hw_params = file_pcm_hw_params,
+    .sw_params = file_pcm_sw_params,
+    .sync_ptr = file_pcm_sync_ptr,
+    .writei_frames = file_pcm_writei_frames,
+    .readi_frames = file_pcm_readi_frames,
+    .ttstamp = file_pcm_ttstamp,
+    .prepare = file_pcm_prepare,
+    .start = file_pcm_start,
+    .drain = file_pcm_drain,
+    .drop = file_pcm_drop,
+    .ioctl = file_pcm_ioctl,
+    .mmap = file_pcm_mmap,
+    .munmap = file_pcm_munmap,
+    .poll = file_pcm_poll,
+};
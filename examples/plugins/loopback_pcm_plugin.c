@@ -0,0 +1,829 @@
+/* loopback_pcm_plugin.c
+**
+** Copyright (c) 2026, The Linux Foundation. All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above
+**     copyright notice, this list of conditions and the following
+**     disclaimer in the documentation and/or other materials provided
+**     with the distribution.
+**   * Neither the name of The Linux Foundation nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+** WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+** ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+** BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+** CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+** SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+** WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+** OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+** IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**/
+
+/*
+ * A PCM plugin that loops playback back to capture, in place of the
+ * snd-aloop module.
+ *
+ * Devices 2n and 2n + 1 of a card form a pair: the frames played on one
+ * device are captured on the other. The streams of a pair follow the same
+ * clock, which runs from the monotonic time while any of them is running,
+ * and must use the same format, channels and rate.
+ *
+ * Each stream keeps its frames in a ring backed by a memfd, which is what
+ * PCM_MMAP streams map. Playback streams that run out of frames are played
+ * as silence, and capture streams drop the frames they have no room for,
+ * so that the streams never stop on an xrun. Streams start on their first
+ * transfer, as kernel devices do.
+ */
+
+/* for memfd_create() */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sound/asound.h>
+#include <tinyalsa/plugin.h>
+#include <tinyalsa/asoundlib.h>
+
+#define PCM_FORMAT_BIT(x) (1ULL << x)
+#define NSEC_PER_SEC 1000000000ULL
+
+struct loopback_pair;
+
+struct loopback_stream {
+    struct loopback_pair *pair;
+    struct pcm_plugin_hw_constraints constrs;
+    unsigned int mode;
+    /* the ring of frames, see loopback_hw_params() */
+    int fd;
+    char *buf;
+    size_t buf_bytes;
+    unsigned int frame_bytes;
+    snd_pcm_uframes_t buffer_size;
+    snd_pcm_uframes_t period_size;
+    snd_pcm_uframes_t boundary;
+    snd_pcm_uframes_t start_threshold;
+    snd_pcm_uframes_t avail_min;
+    snd_pcm_uframes_t hw_ptr;
+    snd_pcm_uframes_t appl_ptr;
+    int running;
+};
+
+struct loopback_pair {
+    struct loopback_pair *next;
+    unsigned int card;
+    unsigned int index;
+    unsigned int refs;
+    pthread_mutex_t lock;
+    /* the streams of the devices of the pair, by device parity */
+    struct loopback_stream *playback[2];
+    struct loopback_stream *capture[2];
+    /* the parameters of the configured streams */
+    unsigned int configured;
+    int format;
+    unsigned int channels;
+    unsigned int rate;
+    /* the clock, in frames since the first running stream started */
+    unsigned int running;
+    struct timespec clock_start;
+    snd_pcm_uframes_t clock_pos;
+};
+
+static pthread_mutex_t loopback_pairs_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct loopback_pair *loopback_pairs;
+
+static snd_pcm_uframes_t loopback_ptr_add(struct loopback_stream *s,
+                snd_pcm_uframes_t ptr, snd_pcm_uframes_t frames)
+{
+    ptr += frames;
+    if (ptr >= s->boundary)
+        ptr -= s->boundary;
+    return ptr;
+}
+
+static snd_pcm_uframes_t loopback_ptr_diff(struct loopback_stream *s,
+                snd_pcm_uframes_t a, snd_pcm_uframes_t b)
+{
+    return a >= b ? a - b : a + s->boundary - b;
+}
+
+/* Frames written and not played yet, or captured and not read yet */
+static snd_pcm_uframes_t loopback_queued(struct loopback_stream *s)
+{
+    if (s->mode & PCM_IN)
+        return loopback_ptr_diff(s, s->hw_ptr, s->appl_ptr);
+    return loopback_ptr_diff(s, s->appl_ptr, s->hw_ptr);
+}
+
+static snd_pcm_uframes_t loopback_avail(struct loopback_stream *s)
+{
+    if (s->mode & PCM_IN)
+        return loopback_queued(s);
+    return s->buffer_size - loopback_queued(s);
+}
+
+/* Copies frames into the ring, or silence without frames to copy */
+static void loopback_ring_write(struct loopback_stream *s, snd_pcm_uframes_t ptr,
+                const char *src, snd_pcm_uframes_t frames)
+{
+    snd_pcm_uframes_t offset, n;
+
+    while (frames) {
+        offset = ptr % s->buffer_size;
+        n = s->buffer_size - offset;
+        if (n > frames)
+            n = frames;
+
+        if (src) {
+            memcpy(s->buf + offset * s->frame_bytes, src, n * s->frame_bytes);
+            src += n * s->frame_bytes;
+        } else {
+            memset(s->buf + offset * s->frame_bytes, 0, n * s->frame_bytes);
+        }
+
+        ptr += n;
+        frames -= n;
+    }
+}
+
+static void loopback_ring_read(struct loopback_stream *s, snd_pcm_uframes_t ptr,
+                char *dst, snd_pcm_uframes_t frames)
+{
+    snd_pcm_uframes_t offset, n;
+
+    while (frames) {
+        offset = ptr % s->buffer_size;
+        n = s->buffer_size - offset;
+        if (n > frames)
+            n = frames;
+
+        memcpy(dst, s->buf + offset * s->frame_bytes, n * s->frame_bytes);
+        dst += n * s->frame_bytes;
+        ptr += n;
+        frames -= n;
+    }
+}
+
+/* Moves the frames played on one device to the capture of the other one */
+static void loopback_transfer(struct loopback_stream *p, struct loopback_stream *c,
+                snd_pcm_uframes_t frames)
+{
+    snd_pcm_uframes_t played = 0, captured = 0, offset, n;
+
+    if (p) {
+        played = loopback_queued(p);
+        if (played > frames)
+            played = frames;
+    }
+
+    if (c) {
+        captured = c->buffer_size - loopback_queued(c);
+        if (captured > frames)
+            captured = frames;
+    }
+
+    for (n = 0; c && n < captured; n += offset) {
+        /* the frames go from one ring to the other, in contiguous chunks */
+        offset = c->buffer_size - (c->hw_ptr + n) % c->buffer_size;
+        if (offset > captured - n)
+            offset = captured - n;
+
+        if (n < played) {
+            if (offset > played - n)
+                offset = played - n;
+            loopback_ring_read(p, p->hw_ptr + n,
+                               c->buf + (c->hw_ptr + n) % c->buffer_size * c->frame_bytes,
+                               offset);
+        } else {
+            loopback_ring_write(c, c->hw_ptr + n, NULL, offset);
+        }
+    }
+
+    if (p)
+        p->hw_ptr = loopback_ptr_add(p, p->hw_ptr, played);
+    if (c)
+        c->hw_ptr = loopback_ptr_add(c, c->hw_ptr, captured);
+}
+
+static snd_pcm_uframes_t loopback_clock(struct loopback_pair *pair)
+{
+    struct timespec now;
+    uint64_t ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ns = (uint64_t) (now.tv_sec - pair->clock_start.tv_sec) * NSEC_PER_SEC +
+         now.tv_nsec - pair->clock_start.tv_nsec;
+    return (ns / NSEC_PER_SEC) * pair->rate + (ns % NSEC_PER_SEC) * pair->rate / NSEC_PER_SEC;
+}
+
+/* Runs the streams of the pair up to the current time, with the pair locked */
+static void loopback_update(struct loopback_pair *pair)
+{
+    struct loopback_stream *p, *c;
+    snd_pcm_uframes_t clock, frames;
+    unsigned int d;
+
+    if (!pair->running)
+        return;
+
+    clock = loopback_clock(pair);
+    frames = clock - pair->clock_pos;
+    pair->clock_pos = clock;
+    if (!frames)
+        return;
+
+    for (d = 0; d < 2; d++) {
+        p = pair->playback[d];
+        c = pair->capture[!d];
+        loopback_transfer(p && p->running ? p : NULL, c && c->running ? c : NULL, frames);
+    }
+}
+
+/* Sleeps until the clock of the pair goes through the given frames,
+ * with the pair locked
+ */
+static void loopback_wait(struct loopback_pair *pair, snd_pcm_uframes_t frames)
+{
+    struct timespec deadline;
+    uint64_t ns;
+
+    ns = (uint64_t) (pair->clock_pos + frames) * NSEC_PER_SEC / pair->rate;
+    deadline.tv_sec = pair->clock_start.tv_sec + ns / NSEC_PER_SEC;
+    deadline.tv_nsec = pair->clock_start.tv_nsec + ns % NSEC_PER_SEC;
+    if (deadline.tv_nsec >= (long) NSEC_PER_SEC) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= NSEC_PER_SEC;
+    }
+
+    pthread_mutex_unlock(&pair->lock);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+        ;
+    pthread_mutex_lock(&pair->lock);
+    loopback_update(pair);
+}
+
+static void loopback_start_stream(struct loopback_stream *s)
+{
+    struct loopback_pair *pair = s->pair;
+
+    if (s->running)
+        return;
+
+    loopback_update(pair);
+    if (!pair->running++) {
+        clock_gettime(CLOCK_MONOTONIC, &pair->clock_start);
+        pair->clock_pos = 0;
+    }
+    s->running = 1;
+}
+
+static void loopback_stop_stream(struct loopback_stream *s)
+{
+    struct loopback_pair *pair = s->pair;
+
+    if (!s->running)
+        return;
+
+    loopback_update(pair);
+    pair->running--;
+    s->running = 0;
+}
+
+static struct loopback_stream **loopback_slot(struct loopback_pair *pair,
+                unsigned int device, unsigned int mode)
+{
+    return mode & PCM_IN ? &pair->capture[device & 1] : &pair->playback[device & 1];
+}
+
+static struct loopback_pair *loopback_get_pair(unsigned int card, unsigned int device)
+{
+    struct loopback_pair *pair;
+
+    for (pair = loopback_pairs; pair; pair = pair->next)
+        if (pair->card == card && pair->index == device / 2)
+            break;
+
+    if (!pair) {
+        pair = calloc(1, sizeof(*pair));
+        if (!pair)
+            return NULL;
+        pair->card = card;
+        pair->index = device / 2;
+        pthread_mutex_init(&pair->lock, NULL);
+        pair->next = loopback_pairs;
+        loopback_pairs = pair;
+    }
+
+    pair->refs++;
+    return pair;
+}
+
+static void loopback_put_pair(struct loopback_pair *pair)
+{
+    struct loopback_pair **p;
+
+    if (--pair->refs)
+        return;
+
+    for (p = &loopback_pairs; *p != pair; p = &(*p)->next)
+        ;
+    *p = pair->next;
+
+    pthread_mutex_destroy(&pair->lock);
+    free(pair);
+}
+
+static void loopback_free_ring(struct loopback_stream *s)
+{
+    if (s->buf)
+        munmap(s->buf, s->buf_bytes);
+    if (s->fd >= 0)
+        close(s->fd);
+    s->buf = NULL;
+    s->fd = -1;
+}
+
+static unsigned int loopback_format_bits(int format)
+{
+    switch (format) {
+    case SNDRV_PCM_FORMAT_S32_LE:
+    case SNDRV_PCM_FORMAT_S24_LE:
+    case SNDRV_PCM_FORMAT_FLOAT_LE:
+        return 32;
+    case SNDRV_PCM_FORMAT_S24_3LE:
+        return 24;
+    default:
+    case SNDRV_PCM_FORMAT_S16_LE:
+        return 16;
+    };
+}
+
+static int loopback_hw_params(struct pcm_plugin *plugin,
+                struct snd_pcm_hw_params *params)
+{
+    struct loopback_stream *s = plugin->priv;
+    struct loopback_pair *pair = s->pair;
+    struct snd_mask *mask;
+    int format, rc = 0;
+    unsigned int channels, rate;
+
+    mask = &params->masks[SNDRV_PCM_HW_PARAM_FORMAT - SNDRV_PCM_HW_PARAM_FIRST_MASK];
+    for (format = 0; format < 32; format++)
+        if (mask->bits[0] & (1U << format))
+            break;
+    channels = params->intervals[SNDRV_PCM_HW_PARAM_CHANNELS -
+                                 SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].min;
+    rate = params->intervals[SNDRV_PCM_HW_PARAM_RATE -
+                             SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].min;
+
+    pthread_mutex_lock(&pair->lock);
+
+    if (s->buf) {
+        loopback_free_ring(s);
+        pair->configured--;
+    }
+
+    /* the frames go from one stream to the other as they are */
+    if (pair->configured &&
+        (pair->format != format || pair->channels != channels || pair->rate != rate)) {
+        fprintf(stderr, "%s: the other stream of the pair uses other parameters\n",
+                __func__);
+        rc = -EINVAL;
+        goto exit;
+    }
+
+    s->frame_bytes = channels * loopback_format_bits(format) / 8;
+    s->period_size = params->intervals[SNDRV_PCM_HW_PARAM_PERIOD_SIZE -
+                                       SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].min;
+    s->buffer_size = params->intervals[SNDRV_PCM_HW_PARAM_BUFFER_SIZE -
+                                       SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].min;
+    s->buf_bytes = s->buffer_size * s->frame_bytes;
+
+    /* the same defaults as the core, until sw_params sets them */
+    s->boundary = s->buffer_size;
+    while (s->boundary * 2 <= INT_MAX - s->buffer_size)
+        s->boundary *= 2;
+    s->start_threshold = 1;
+    s->avail_min = s->period_size;
+
+    s->fd = memfd_create("tinyalsa-loopback", MFD_CLOEXEC);
+    if (s->fd < 0 || ftruncate(s->fd, s->buf_bytes)) {
+        rc = -errno;
+        loopback_free_ring(s);
+        goto exit;
+    }
+
+    s->buf = mmap(NULL, s->buf_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+    if (s->buf == MAP_FAILED) {
+        rc = -errno;
+        s->buf = NULL;
+        loopback_free_ring(s);
+        goto exit;
+    }
+
+    pair->format = format;
+    pair->channels = channels;
+    pair->rate = rate;
+    pair->configured++;
+
+exit:
+    pthread_mutex_unlock(&pair->lock);
+    return rc;
+}
+
+static int loopback_sw_params(struct pcm_plugin *plugin,
+                struct snd_pcm_sw_params *sparams)
+{
+    struct loopback_stream *s = plugin->priv;
+
+    pthread_mutex_lock(&s->pair->lock);
+    if (sparams->boundary)
+        s->boundary = sparams->boundary;
+    s->start_threshold = sparams->start_threshold ? sparams->start_threshold : 1;
+    s->avail_min = sparams->avail_min ? sparams->avail_min : 1;
+    pthread_mutex_unlock(&s->pair->lock);
+
+    return 0;
+}
+
+static int loopback_sync_ptr(struct pcm_plugin *plugin,
+                struct snd_pcm_sync_ptr *sync_ptr)
+{
+    struct loopback_stream *s = plugin->priv;
+
+    pthread_mutex_lock(&s->pair->lock);
+    loopback_update(s->pair);
+
+    /* the application pointer only comes from the caller when it
+     * moves it through the mmapped ring
+     */
+    if ((sync_ptr->flags & SNDRV_PCM_SYNC_PTR_APPL) || !(s->mode & PCM_MMAP))
+        sync_ptr->c.control.appl_ptr = s->appl_ptr;
+    else
+        s->appl_ptr = sync_ptr->c.control.appl_ptr;
+
+    if (sync_ptr->flags & SNDRV_PCM_SYNC_PTR_AVAIL_MIN)
+        sync_ptr->c.control.avail_min = s->avail_min;
+    else if (sync_ptr->c.control.avail_min)
+        s->avail_min = sync_ptr->c.control.avail_min;
+
+    sync_ptr->s.status.hw_ptr = s->hw_ptr;
+    pthread_mutex_unlock(&s->pair->lock);
+
+    return 0;
+}
+
+static int loopback_writei_frames(struct pcm_plugin *plugin, struct snd_xferi *x)
+{
+    struct loopback_stream *s = plugin->priv;
+    struct loopback_pair *pair = s->pair;
+    const char *src = x->buf;
+    snd_pcm_uframes_t avail, n, done = 0;
+
+    pthread_mutex_lock(&pair->lock);
+    loopback_update(pair);
+
+    while (done < x->frames) {
+        avail = loopback_avail(s);
+        if (!avail) {
+            /* a full buffer starts the stream, whatever the threshold */
+            loopback_start_stream(s);
+            if (s->mode & PCM_NONBLOCK)
+                break;
+            n = x->frames - done;
+            loopback_wait(pair, n < s->avail_min ? n : s->avail_min);
+            continue;
+        }
+
+        n = x->frames - done;
+        if (n > avail)
+            n = avail;
+        loopback_ring_write(s, s->appl_ptr, src + done * s->frame_bytes, n);
+        s->appl_ptr = loopback_ptr_add(s, s->appl_ptr, n);
+        done += n;
+
+        if (loopback_queued(s) >= s->start_threshold)
+            loopback_start_stream(s);
+    }
+
+    pthread_mutex_unlock(&pair->lock);
+
+    if (!done && x->frames)
+        return -EAGAIN;
+
+    x->result = done;
+    return 0;
+}
+
+static int loopback_readi_frames(struct pcm_plugin *plugin, struct snd_xferi *x)
+{
+    struct loopback_stream *s = plugin->priv;
+    struct loopback_pair *pair = s->pair;
+    char *dst = x->buf;
+    snd_pcm_uframes_t avail, n, done = 0;
+
+    pthread_mutex_lock(&pair->lock);
+    loopback_start_stream(s);
+
+    while (done < x->frames) {
+        avail = loopback_avail(s);
+        if (!avail) {
+            if (s->mode & PCM_NONBLOCK)
+                break;
+            n = x->frames - done;
+            loopback_wait(pair, n < s->avail_min ? n : s->avail_min);
+            continue;
+        }
+
+        n = x->frames - done;
+        if (n > avail)
+            n = avail;
+        loopback_ring_read(s, s->appl_ptr, dst + done * s->frame_bytes, n);
+        s->appl_ptr = loopback_ptr_add(s, s->appl_ptr, n);
+        done += n;
+    }
+
+    pthread_mutex_unlock(&pair->lock);
+
+    if (!done && x->frames)
+        return -EAGAIN;
+
+    x->result = done;
+    return 0;
+}
+
+static int loopback_ttstamp(struct pcm_plugin *plugin, int *tstamp)
+{
+    return 0;
+}
+
+static int loopback_prepare(struct pcm_plugin *plugin)
+{
+    struct loopback_stream *s = plugin->priv;
+
+    pthread_mutex_lock(&s->pair->lock);
+    loopback_stop_stream(s);
+    s->hw_ptr = 0;
+    s->appl_ptr = 0;
+    pthread_mutex_unlock(&s->pair->lock);
+
+    return 0;
+}
+
+static int loopback_start(struct pcm_plugin *plugin)
+{
+    struct loopback_stream *s = plugin->priv;
+
+    pthread_mutex_lock(&s->pair->lock);
+    loopback_start_stream(s);
+    pthread_mutex_unlock(&s->pair->lock);
+
+    return 0;
+}
+
+static int loopback_drain(struct pcm_plugin *plugin)
+{
+    struct loopback_stream *s = plugin->priv;
+    struct loopback_pair *pair = s->pair;
+
+    pthread_mutex_lock(&pair->lock);
+    loopback_update(pair);
+
+    while (!(s->mode & PCM_IN) && s->running && loopback_queued(s))
+        loopback_wait(pair, loopback_queued(s));
+
+    loopback_stop_stream(s);
+    pthread_mutex_unlock(&pair->lock);
+
+    return 0;
+}
+
+static int loopback_drop(struct pcm_plugin *plugin)
+{
+    struct loopback_stream *s = plugin->priv;
+
+    pthread_mutex_lock(&s->pair->lock);
+    loopback_stop_stream(s);
+    pthread_mutex_unlock(&s->pair->lock);
+
+    return 0;
+}
+
+static int loopback_ioctl(struct pcm_plugin *plugin, int cmd, void *arg)
+{
+    struct loopback_stream *s = plugin->priv;
+    snd_pcm_sframes_t *delay = arg;
+
+    switch (cmd) {
+    case (int) SNDRV_PCM_IOCTL_HWSYNC:
+        return 0;
+    case (int) SNDRV_PCM_IOCTL_DELAY:
+        pthread_mutex_lock(&s->pair->lock);
+        loopback_update(s->pair);
+        *delay = loopback_queued(s);
+        pthread_mutex_unlock(&s->pair->lock);
+        return 0;
+    case (int) SNDRV_PCM_IOCTL_LINK:
+    case (int) SNDRV_PCM_IOCTL_UNLINK:
+        /* the streams of a pair already share the clock */
+        return 0;
+    default:
+        return -ENOTTY;
+    }
+}
+
+static void *loopback_mmap(struct pcm_plugin *plugin, void *addr, size_t length, int prot,
+                int flags, off_t offset)
+{
+    struct loopback_stream *s = plugin->priv;
+
+    /* the pointers move with the clock, the core syncs them */
+    if (offset != 0 || !s->buf || length > s->buf_bytes)
+        return MAP_FAILED;
+
+    return mmap(addr, length, prot, flags, s->fd, 0);
+}
+
+static int loopback_munmap(struct pcm_plugin *plugin, void *addr, size_t length)
+{
+    return munmap(addr, length) ? -errno : 0;
+}
+
+/* Waits until the stream can transfer avail_min frames */
+static int loopback_poll(struct pcm_plugin *plugin, struct pollfd *pfd,
+                nfds_t nfds, int timeout)
+{
+    struct loopback_stream *s = plugin->priv;
+    struct loopback_pair *pair = s->pair;
+    snd_pcm_uframes_t avail, frames;
+    int ready = 1;
+
+    pthread_mutex_lock(&pair->lock);
+    loopback_update(pair);
+
+    /* a stream that does not run is started by its next transfer */
+    while (s->running && (avail = loopback_avail(s)) < s->avail_min) {
+        frames = s->avail_min - avail;
+        if (timeout >= 0 && (uint64_t) frames * 1000 > (uint64_t) timeout * pair->rate) {
+            frames = (uint64_t) timeout * pair->rate / 1000;
+            loopback_wait(pair, frames);
+            ready = loopback_avail(s) >= s->avail_min;
+            break;
+        }
+        loopback_wait(pair, frames);
+    }
+
+    pthread_mutex_unlock(&pair->lock);
+
+    pfd->revents = ready ? (s->mode & PCM_IN ? POLLIN : POLLOUT) : 0;
+    return ready;
+}
+
+static int loopback_close(struct pcm_plugin *plugin)
+{
+    struct loopback_stream *s = plugin->priv;
+    struct loopback_pair *pair = s->pair;
+
+    pthread_mutex_lock(&loopback_pairs_lock);
+    pthread_mutex_lock(&pair->lock);
+    loopback_stop_stream(s);
+    if (s->buf)
+        pair->configured--;
+    *loopback_slot(pair, plugin->device, s->mode) = NULL;
+    pthread_mutex_unlock(&pair->lock);
+    loopback_put_pair(pair);
+    pthread_mutex_unlock(&loopback_pairs_lock);
+
+    loopback_free_ring(s);
+    free(s);
+    free(plugin);
+
+    return 0;
+}
+
+int loopback_open(struct pcm_plugin **plugin, unsigned int card,
+                  unsigned int device, unsigned int mode)
+{
+    struct pcm_plugin *loopback_plugin;
+    struct loopback_stream *s;
+    struct loopback_stream **slot;
+    struct loopback_pair *pair;
+    int ret = 0;
+
+    loopback_plugin = calloc(1, sizeof(struct pcm_plugin));
+    if (!loopback_plugin)
+        return -ENOMEM;
+
+    s = calloc(1, sizeof(struct loopback_stream));
+    if (!s) {
+        ret = -ENOMEM;
+        goto err_plugin_free;
+    }
+
+    s->fd = -1;
+    s->mode = mode;
+    s->constrs.access = (PCM_FORMAT_BIT(SNDRV_PCM_ACCESS_RW_INTERLEAVED) |
+                         PCM_FORMAT_BIT(SNDRV_PCM_ACCESS_MMAP_INTERLEAVED));
+    s->constrs.format = (PCM_FORMAT_BIT(SNDRV_PCM_FORMAT_S16_LE) |
+                         PCM_FORMAT_BIT(SNDRV_PCM_FORMAT_S24_LE) |
+                         PCM_FORMAT_BIT(SNDRV_PCM_FORMAT_S24_3LE) |
+                         PCM_FORMAT_BIT(SNDRV_PCM_FORMAT_S32_LE) |
+                         PCM_FORMAT_BIT(SNDRV_PCM_FORMAT_FLOAT_LE));
+    s->constrs.bit_width.min = 16;
+    s->constrs.bit_width.max = 32;
+    s->constrs.channels.min = 1;
+    s->constrs.channels.max = 8;
+    s->constrs.rate.min = 8000;
+    s->constrs.rate.max = 192000;
+    s->constrs.periods.min = 1;
+    s->constrs.periods.max = 16;
+    s->constrs.period_bytes.min = 64;
+    s->constrs.period_bytes.max = 131072;
+
+    pthread_mutex_lock(&loopback_pairs_lock);
+
+    pair = loopback_get_pair(card, device);
+    if (!pair) {
+        ret = -ENOMEM;
+        goto err_unlock;
+    }
+
+    pthread_mutex_lock(&pair->lock);
+    slot = loopback_slot(pair, device, mode);
+    if (*slot) {
+        ret = -EBUSY;
+    } else {
+        *slot = s;
+        s->pair = pair;
+    }
+
+    /* the stream can only use the parameters the pair runs with */
+    if (!ret && pair->configured) {
+        s->constrs.format = PCM_FORMAT_BIT(pair->format);
+        s->constrs.bit_width.min = s->constrs.bit_width.max =
+            loopback_format_bits(pair->format);
+        s->constrs.channels.min = s->constrs.channels.max = pair->channels;
+        s->constrs.rate.min = s->constrs.rate.max = pair->rate;
+    }
+    pthread_mutex_unlock(&pair->lock);
+
+    if (ret) {
+        loopback_put_pair(pair);
+        goto err_unlock;
+    }
+
+    pthread_mutex_unlock(&loopback_pairs_lock);
+
+    loopback_plugin->card = card;
+    loopback_plugin->device = device;
+    loopback_plugin->mode = mode;
+    loopback_plugin->constraints = &s->constrs;
+    loopback_plugin->priv = s;
+
+    *plugin = loopback_plugin;
+    return 0;
+
+err_unlock:
+    pthread_mutex_unlock(&loopback_pairs_lock);
+    free(s);
+err_plugin_free:
+    free(loopback_plugin);
+    return ret;
+}
+
+struct pcm_plugin_ops pcm_plugin_ops = {
+    .open = loopback_open,
+    .close = loopback_close,
+    .hw_params = loopback_hw_params,
+    .sw_params = loopback_sw_params,
+    .sync_ptr = loopback_sync_ptr,
+    .writei_frames = loopback_writei_frames,
+    .readi_frames = loopback_readi_frames,
+    .ttstamp = loopback_ttstamp,
+    .prepare = loopback_prepare,
+    .start = loopback_start,
+    .drain = loopback_drain,
+    .drop = loopback_drop,
+    .ioctl = loopback_ioctl,
+    .mmap = loopback_mmap,
+    .munmap = loopback_munmap,
+    .poll = loopback_poll,
+};
@@ -0,0 +1,98 @@
+/* sample_gain_stage.c
+**
+** Copyright (c) 2026, The Linux Foundation. All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above
+**     copyright notice, this list of conditions and the following
+**     disclaimer in the documentation and/or other materials provided
+**     with the distribution.
+**   * Neither the name of The Linux Foundation nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+** WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+** ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+** BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+** CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+** SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+** BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+** WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+** OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+** IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**/
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sound/asound.h>
+#include <tinyalsa/plugin.h>
+
+/* Q15 gain applied to the samples, -6dB */
+#define SAMPLE_GAIN_Q15 (16384)
+
+struct sample_gain_priv {
+    unsigned int channels;
+    int32_t gain;
+};
+
+static int sample_gain_open(void **stage, unsigned int card,
+                unsigned int device, unsigned int flags)
+{
+    struct sample_gain_priv *priv;
+
+    priv = calloc(1, sizeof(*priv));
+    if (!priv)
+        return -ENOMEM;
+
+    priv->gain = SAMPLE_GAIN_Q15;
+    *stage = priv;
+    return 0;
+}
+
+static void sample_gain_close(void *stage)
+{
+    free(stage);
+}
+
+static int sample_gain_hw_params(void *stage, struct snd_pcm_hw_params *params)
+{
+    struct sample_gain_priv *priv = stage;
+    struct snd_mask *format;
+
+    /* only signed 16 bit samples are scaled by this stage */
+    format = &params->masks[SNDRV_PCM_HW_PARAM_FORMAT - SNDRV_PCM_HW_PARAM_FIRST_MASK];
+    if (!(format->bits[0] & (1U << SNDRV_PCM_FORMAT_S16_LE)))
+        return -EINVAL;
+
+    priv->channels = params->intervals[SNDRV_PCM_HW_PARAM_CHANNELS -
+                                       SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].min;
+    return 0;
+}
+
+static int sample_gain_process(void *stage, void *buf, unsigned int frames)
+{
+    struct sample_gain_priv *priv = stage;
+    int16_t *samples = buf;
+    unsigned int i;
+
+    for (i = 0; i < frames * priv->channels; i++)
+        samples[i] = (int16_t) ((samples[i] * priv->gain) >> 15);
+
+    return 0;
+}
+
+const struct pcm_plugin_stage_ops pcm_plugin_stage_ops = {
+    .size = sizeof(struct pcm_plugin_stage_ops),
+    .open = sample_gain_open,
+    .close = sample_gain_close,
+    .hw_params = sample_gain_hw_params,
+    .process = sample_gain_process,
+};
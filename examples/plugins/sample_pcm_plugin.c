@@ -53,6 +53,12 @@ struct sample_pcm_priv {
     int sample_rate;
     unsigned int period_size;
     snd_pcm_uframes_t total_size_frames;
+    /* shared with the core, see sample_pcm_mmap() */
+    struct snd_pcm_mmap_status status;
+    struct snd_pcm_mmap_control control;
+    /* signals the core that the stream progressed */
+    pcm_event_callback event_cb;
+    void *event_data;
 };
 
 struct pcm_plugin_hw_constraints sample_pcm_constrs = {
@@ -80,6 +86,17 @@ struct pcm_plugin_hw_constraints sample_pcm_constrs = {
     },
 };
 
+static const unsigned int sample_pcm_rates[] = {
+    8000, 16000, 32000, 44100, 48000, 96000, 192000, 384000,
+};
+
+static const struct pcm_plugin_hw_lists sample_pcm_lists = {
+    .rate = {
+        .count = sizeof(sample_pcm_rates) / sizeof(sample_pcm_rates[0]),
+        .values = sample_pcm_rates,
+    },
+};
+
 static inline struct snd_interval *param_to_interval(struct snd_pcm_hw_params *p,
                                                   int n)
 {
@@ -207,11 +224,21 @@ static int sample_pcm_writei_frames(struct pcm_plugin *plugin, struct snd_xferi
     struct sample_pcm_priv *priv = plugin->priv;
     void *buff;
     size_t count;
+    int ret;
 
     buff = x->buf;
     count = x->frames * (priv->channels * (priv->bitwidth) / 8);
 
-    return sample_session_write(priv, buff, count);
+    ret = sample_session_write(priv, buff, count);
+    if (ret)
+        return ret;
+
+    /* the frames are consumed as soon as they are written */
+    priv->control.appl_ptr += x->frames;
+    priv->status.hw_ptr = priv->control.appl_ptr;
+    if (priv->event_cb)
+        priv->event_cb(priv->event_data);
+    return 0;
 }
 
 static int sample_pcm_readi_frames(struct pcm_plugin *plugin, struct snd_xferi *x)
@@ -260,6 +287,16 @@ static int sample_pcm_poll(struct pcm_plugin *plugin, struct pollfd *pfd,
 static void* sample_pcm_mmap(struct pcm_plugin *plugin, void *addr, size_t length, int prot,
                                int flags, off_t offset)
 {
+    struct sample_pcm_priv *priv = plugin->priv;
+
+    /* sharing the status and control pages spares a sync_ptr call
+     * each time the core needs the pointers or the state
+     */
+    if (offset == SNDRV_PCM_MMAP_OFFSET_STATUS)
+        return &priv->status;
+    if (offset == SNDRV_PCM_MMAP_OFFSET_CONTROL)
+        return &priv->control;
+
     return MAP_FAILED;
 }
 
@@ -330,3 +367,25 @@ struct pcm_plugin_ops pcm_plugin_ops = {
     .munmap = sample_pcm_munmap,
     .poll = sample_pcm_poll,
 };
+
+static const struct pcm_plugin_hw_lists *sample_pcm_hw_lists(struct pcm_plugin *plugin)
+{
+    return &sample_pcm_lists;
+}
+
+static int sample_pcm_subscribe_events(struct pcm_plugin *plugin,
+                                       pcm_event_callback event_cb, void *data)
+{
+    struct sample_pcm_priv *priv = plugin->priv;
+
+    priv->event_cb = event_cb;
+    priv->event_data = data;
+    return 0;
+}
+
+struct pcm_plugin_ext_ops pcm_plugin_ext_ops = {
+    .size = sizeof(struct pcm_plugin_ext_ops),
+    .flags = PCM_PLUGIN_SHARED_PTRS,
+    .hw_lists = sample_pcm_hw_lists,
+    .subscribe_events = sample_pcm_subscribe_events,
+};
@@ -29,6 +29,7 @@
 #ifndef TINYALSA_ASOUNDLIB_H
 #define TINYALSA_ASOUNDLIB_H
 
+#include "card.h"
 #include "mixer.h"
 #include "pcm.h"
 #include "version.h"
@@ -0,0 +1,160 @@
+/* card.h
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are met:
+**     * Redistributions of source code must retain the above copyright
+**       notice, this list of conditions and the following disclaimer.
+**     * Redistributions in binary form must reproduce the above copyright
+**       notice, this list of conditions and the following disclaimer in the
+**       documentation and/or other materials provided with the distribution.
+**     * Neither the name of The Android Open Source Project nor the names of
+**       its contributors may be used to endorse or promote products derived
+**       from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY The Android Open Source Project ``AS IS'' AND
+** ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+** IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+** ARE DISCLAIMED. IN NO EVENT SHALL The Android Open Source Project BE LIABLE
+** FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+** DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+** SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+** CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+** LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+** OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+** DAMAGE.
+*/
+
+/** @file */
+
+/** @defgroup libtinyalsa-card Card Interface
+ * @brief All macros, structures and functions that make up the card interface.
+ */
+
+#ifndef TINYALSA_CARD_H
+#define TINYALSA_CARD_H
+
+#include <tinyalsa/mixer.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/** The directory holding the sound device nodes
+ * @ingroup libtinyalsa-card
+ */
+#define CARD_DEFAULT_DIR "/dev/snd"
+
+/** The kind of change reported by a card monitor
+ * @ingroup libtinyalsa-card
+ */
+enum card_event_type {
+    /** A device node appeared */
+    CARD_EVENT_ADD,
+    /** A device node disappeared */
+    CARD_EVENT_REMOVE,
+};
+
+/** The kind of device a card event refers to
+ * @ingroup libtinyalsa-card
+ */
+enum card_device_type {
+    /** The control device, which comes and goes with the card itself */
+    CARD_DEVICE_CONTROL,
+    /** A playback PCM */
+    CARD_DEVICE_PCM_PLAYBACK,
+    /** A capture PCM */
+    CARD_DEVICE_PCM_CAPTURE,
+    /** A compress offload device */
+    CARD_DEVICE_COMPRESS,
+};
+
+/** A change of the sound devices
+ * @ingroup libtinyalsa-card
+ */
+struct card_event {
+    enum card_event_type type;
+    enum card_device_type device_type;
+    unsigned int card;
+    /** The device number, zero for the control device */
+    unsigned int device;
+    /** The identifier of the card, empty if it could not be resolved */
+    char id[16];
+};
+
+/** Receives the events of a card monitor
+ * @ingroup libtinyalsa-card
+ */
+typedef void (*card_event_callback)(const struct card_event *event, void *data);
+
+struct card_monitor;
+
+struct card_monitor *card_monitor_open(const char *dir, card_event_callback callback,
+                                       void *data);
+
+void card_monitor_close(struct card_monitor *monitor);
+
+int card_monitor_get_fd(const struct card_monitor *monitor);
+
+int card_monitor_process(struct card_monitor *monitor, int timeout);
+
+int mixer_manager_handle_card_event(struct mixer_manager *mm, const struct card_event *event);
+
+/** Makes card_list_get() return the shared, cached list.
+ * @ingroup libtinyalsa-card
+ */
+#define CARD_LIST_CACHED 0x00000001
+
+/** A PCM device of a card
+ * @ingroup libtinyalsa-card
+ */
+struct card_pcm {
+    unsigned int device;
+    char id[64];
+    char name[80];
+    /** The number of playback subdevices, zero if the device cannot play */
+    unsigned int playback_subdevices;
+    /** The number of capture subdevices, zero if the device cannot capture */
+    unsigned int capture_subdevices;
+};
+
+/** A sound card and its PCM devices
+ * @ingroup libtinyalsa-card
+ */
+struct card_desc {
+    unsigned int card;
+    char id[16];
+    char driver[16];
+    char name[32];
+    char long_name[80];
+    unsigned int num_pcms;
+    /** The PCM devices, in increasing device order */
+    const struct card_pcm *pcms;
+};
+
+/** The sound cards of the system
+ * @ingroup libtinyalsa-card
+ */
+struct card_list {
+    unsigned int num_cards;
+    /** The cards, in increasing card order */
+    const struct card_desc *cards;
+};
+
+const struct card_list *card_list_get(unsigned int flags);
+
+void card_list_free(const struct card_list *list);
+
+void card_list_invalidate(void);
+
+const struct card_desc *card_list_find(const struct card_list *list, const char *id);
+
+int card_get_index(const char *name);
+
+#if defined(__cplusplus)
+}  /* extern "C" */
+#endif
+
+#endif
+
@@ -65,6 +65,18 @@ struct mixer_ctl_event {
     } data;
 };
 
+/** How mixer_find_ctls() matches control names.
+ * @ingroup libtinyalsa-mixer
+ */
+enum mixer_find_mode {
+    /** names starting with the pattern */
+    MIXER_FIND_PREFIX,
+    /** names matching a shell wildcard pattern, see fnmatch() */
+    MIXER_FIND_GLOB,
+    /** names matching a POSIX extended regular expression */
+    MIXER_FIND_REGEX,
+};
+
 /** Mixer control type.
  * @ingroup libtinyalsa-mixer
  */
@@ -87,12 +99,16 @@ enum mixer_ctl_type {
 
 struct mixer *mixer_open(unsigned int card);
 
+struct mixer *mixer_open_by_name(const char *name);
+
 void mixer_close(struct mixer *mixer);
 
 int mixer_add_new_ctls(struct mixer *mixer);
 
 const char *mixer_get_name(const struct mixer *mixer);
 
+const char *mixer_get_id(const struct mixer *mixer);
+
 unsigned int mixer_get_num_ctls(const struct mixer *mixer);
 
 unsigned int mixer_get_num_ctls_by_name(const struct mixer *mixer, const char *name);
@@ -111,8 +127,16 @@ struct mixer_ctl *mixer_get_ctl_by_name_and_index(struct mixer *mixer,
                                                   const char *name,
                                                   unsigned int index);
 
+int mixer_find_ctls(struct mixer *mixer, const char *pattern, enum mixer_find_mode mode,
+                    struct mixer_ctl **ctls, unsigned int size);
+
 int mixer_subscribe_events(struct mixer *mixer, int subscribe);
 
+int mixer_ctl_subscribe_events(struct mixer_ctl *ctl, int subscribe);
+
+int mixer_subscribe_events_by_name(struct mixer *mixer, const char *pattern,
+                                   enum mixer_find_mode mode, int subscribe);
+
 int mixer_wait_event(struct mixer *mixer, int timeout);
 
 unsigned int mixer_ctl_get_id(const struct mixer_ctl *ctl);
@@ -142,6 +166,15 @@ int mixer_ctl_get_percent(const struct mixer_ctl *ctl, unsigned int id);
 
 int mixer_ctl_set_percent(struct mixer_ctl *ctl, unsigned int id, int percent);
 
+/* Gain in hundredths of a dB that mutes the output */
+#define MIXER_CTL_DB_MUTE -9999999
+
+int mixer_ctl_get_db(struct mixer_ctl *ctl, unsigned int id, int *db);
+
+int mixer_ctl_get_db_range(struct mixer_ctl *ctl, int *min_db, int *max_db);
+
+int mixer_ctl_set_db(struct mixer_ctl *ctl, unsigned int id, int db);
+
 int mixer_ctl_get_value(const struct mixer_ctl *ctl, unsigned int id);
 
 int mixer_ctl_get_array(const struct mixer_ctl *ctl, void *array, size_t count);
@@ -162,6 +195,78 @@ unsigned int mixer_ctl_get_device(const struct mixer_ctl *ctl);
 int mixer_read_event(struct mixer *mixer, struct mixer_ctl_event *event);
 
 int mixer_consume_event(struct mixer *mixer);
+
+int mixer_read_events(struct mixer *mixer, struct mixer_ctl_event *events,
+                      unsigned int count);
+
+typedef void (*mixer_ctl_event_callback)(struct mixer_ctl *ctl,
+                                         const struct mixer_ctl_event *event,
+                                         void *data);
+
+int mixer_ctl_set_event_callback(struct mixer_ctl *ctl,
+                                 mixer_ctl_event_callback callback, void *data);
+
+int mixer_dispatch_events(struct mixer *mixer);
+
+int mixer_snapshot_save(struct mixer *mixer, void **data, size_t *size);
+
+int mixer_snapshot_restore(struct mixer *mixer, const void *data, size_t size);
+
+/* Mixer paths, compiled from a file of named lists of control settings */
+struct mixer_route;
+
+struct mixer_route *mixer_route_open(struct mixer *mixer, const char *file_name);
+
+void mixer_route_close(struct mixer_route *route);
+
+unsigned int mixer_route_get_num_paths(const struct mixer_route *route);
+
+const char *mixer_route_get_path_name(const struct mixer_route *route, unsigned int id);
+
+int mixer_route_apply_path(struct mixer_route *route, const char *name);
+
+int mixer_route_reset_path(struct mixer_route *route, const char *name);
+
+void mixer_route_reset(struct mixer_route *route);
+
+int mixer_route_update(struct mixer_route *route);
+
+/* Volume ramps, stepped by a worker thread */
+struct mixer_ramp;
+
+struct mixer_ramp *mixer_ramp_open(void);
+
+void mixer_ramp_close(struct mixer_ramp *mr);
+
+int mixer_ramp_start(struct mixer_ramp *mr, struct mixer_ctl *ctl, int from, int to,
+                     unsigned int duration_ms);
+
+int mixer_ramp_cancel(struct mixer_ramp *mr, struct mixer_ctl *ctl);
+
+int mixer_ramp_wait(struct mixer_ramp *mr, struct mixer_ctl *ctl, int timeout_ms);
+
+/* Mixers of several cards, sharing one control namespace */
+struct mixer_manager;
+
+struct mixer_manager *mixer_manager_open(const unsigned int *cards, unsigned int num_cards);
+
+void mixer_manager_close(struct mixer_manager *mm);
+
+unsigned int mixer_manager_get_num_mixers(const struct mixer_manager *mm);
+
+struct mixer *mixer_manager_get_mixer(struct mixer_manager *mm, unsigned int id);
+
+struct mixer *mixer_manager_get_mixer_by_id(struct mixer_manager *mm, const char *card_id);
+
+struct mixer_ctl *mixer_manager_get_ctl(struct mixer_manager *mm, const char *card_id,
+                                        const char *name, unsigned int index);
+
+unsigned int mixer_manager_get_ctls(struct mixer_manager *mm, const char *card_id,
+                                    const char *const *names, struct mixer_ctl **ctls,
+                                    unsigned int count);
+
+int mixer_manager_update(struct mixer_manager *mm);
+
 #if defined(__cplusplus)
 }  /* extern "C" */
 #endif
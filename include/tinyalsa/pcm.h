@@ -37,6 +37,7 @@
 
 #include <tinyalsa/attributes.h>
 
+#include <poll.h>
 #include <sys/time.h>
 #include <stddef.h>
 
@@ -353,6 +354,10 @@ int pcm_mmap_get_hw_ptr(struct pcm* pcm, unsigned int *hw_ptr, struct timespec *
 
 int pcm_get_poll_fd(struct pcm *pcm);
 
+int pcm_poll_descriptor(struct pcm *pcm, struct pollfd *pfd);
+
+int pcm_poll_revents(struct pcm *pcm, const struct pollfd *pfd, short *revents);
+
 int pcm_link(struct pcm *pcm1, struct pcm *pcm2);
 
 int pcm_unlink(struct pcm *pcm);
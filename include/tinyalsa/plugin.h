@@ -112,7 +112,10 @@ struct pcm_plugin_ops {
     /** Synchronize the pointer */
     int (*sync_ptr) (struct pcm_plugin *plugin,
                      struct snd_pcm_sync_ptr *sync_ptr);
-    /** Write frames to plugin to be rendered to output */
+    /** Write frames to plugin to be rendered to output.
+     *  Plugins whose transfers block can set the "async-queue-frames"
+     *  property of the device, for transfers to be made on a worker
+     *  thread through a queue of that many frames. */
     int (*writei_frames) (struct pcm_plugin *plugin,
                           struct snd_xferi *x);
     /** Read frames from plugin captured from input */
@@ -133,8 +136,20 @@ struct pcm_plugin_ops {
     /** Any custom or alsa specific ioctl implementation */
     int (*ioctl) (struct pcm_plugin *plugin,
                   int cmd, void *arg);
+    /** Map the PCM buffer, once the hardware parameters are set.
+     *  If the plugin sets @ref PCM_PLUGIN_SHARED_PTRS in its
+     *  pcm_plugin_ext_ops, also called when the PCM is opened with the
+     *  SNDRV_PCM_MMAP_OFFSET_STATUS and SNDRV_PCM_MMAP_OFFSET_CONTROL
+     *  offsets. The plugin may then return a struct snd_pcm_mmap_status and a
+     *  struct snd_pcm_mmap_control that it shares with the core for as
+     *  long as the PCM is open. The core then reads the state and the
+     *  pointers from them instead of calling sync_ptr: the plugin keeps
+     *  hw_ptr and tstamp current and follows appl_ptr and avail_min,
+     *  while the core sets the state. Returning MAP_FAILED for either
+     *  page keeps the PCM on sync_ptr. */
     void *(*mmap) (struct pcm_plugin *plugin, void *addr, size_t length,
                    int prot, int flags, off_t offset);
+    /** Unmap the PCM buffer, or a status or control page */
     int (*munmap) (struct pcm_plugin *plugin, void *addr, size_t length);
     int (*poll) (struct pcm_plugin *plugin, struct pollfd *pfd, nfds_t nfds,
                  int timeout);
@@ -171,12 +186,37 @@ struct pcm_plugin_hw_constraints {
     struct pcm_plugin_min_max period_bytes;
 };
 
+/** A discrete list of values for a hardware parameter.
+ * @ingroup libtinyalsa-pcm
+ */
+struct pcm_plugin_hw_list {
+    /** Number of values, 0 if the parameter is only constrained by its range */
+    unsigned int count;
+    /** The values, in any order */
+    const unsigned int *values;
+};
+
+/** Encapsulate the discrete hardware parameter constraints.
+ * They narrow the ranges of struct pcm_plugin_hw_constraints down
+ * to the values the plugin supports.
+ * @ingroup libtinyalsa-pcm
+ */
+struct pcm_plugin_hw_lists {
+    /** Values for SNDRV_PCM_HW_PARAM_RATE param */
+    struct pcm_plugin_hw_list rate;
+    /** Values for SNDRV_PCM_HW_PARAM_CHANNELS param */
+    struct pcm_plugin_hw_list channels;
+    /** Values for SNDRV_PCM_HW_PARAM_PERIOD_SIZE param, in frames */
+    struct pcm_plugin_hw_list period_size;
+};
+
 struct pcm_plugin {
     /** Card number for the pcm device */
     unsigned int card;
     /** device number for the pcm device */
     unsigned int device;
-    /** pointer to the contraints registered by the plugin */
+    /** pointer to the contraints registered by the plugin,
+     *  read once when the plugin is opened */
     struct pcm_plugin_hw_constraints *constraints;
     /** Indicates read/write mode, etc.. */
     int mode;
@@ -186,6 +226,62 @@ struct pcm_plugin {
     unsigned int state;
 };
 
+/** The plugin's mmap op shares status and control pages with the core
+ * @ingroup libtinyalsa-pcm
+ */
+#define PCM_PLUGIN_SHARED_PTRS 0x00000001
+
+/** Called by a PCM plugin when its stream progresses.
+ * @ingroup libtinyalsa-pcm
+ */
+typedef void (*pcm_event_callback)(void *data);
+
+/** Optional operations, exported by the plugin as "pcm_plugin_ext_ops".
+ * An operation is only used when the size the plugin was built with
+ * covers it, so that new operations do not break existing plugins.
+ * @ingroup libtinyalsa-pcm
+ */
+struct pcm_plugin_ext_ops {
+    /** Set to sizeof(struct pcm_plugin_ext_ops) */
+    size_t size;
+    /** Features the plugin opts in to, such as @ref PCM_PLUGIN_SHARED_PTRS */
+    unsigned int flags;
+    /** Get the discrete constraints of the plugin, once it is opened */
+    const struct pcm_plugin_hw_lists *(*hw_lists) (struct pcm_plugin *plugin);
+    /** Register the callback to call with data, from any thread, whenever
+     *  frames are played or captured or the stream stops. This lets the
+     *  stream be polled as soon as it is ready; without it, the stream is
+     *  only checked once a period. The callback is NULL when unsubscribing. */
+    int (*subscribe_events) (struct pcm_plugin *plugin,
+                             pcm_event_callback event_cb, void *data);
+};
+
+/** Operations of a processing stage, exported as "pcm_plugin_stage_ops".
+ * A device whose "chain" property lists stage libraries, separated by
+ * commas, is stacked on top of the PCM of its "slave-card" and
+ * "slave-device" properties, a hardware PCM or another plugin. Chains
+ * stacked on one another in a loop fail to open with -ELOOP.
+ * Stages process frames in place, in the order of the list when
+ * playing and in the reverse order when capturing. They keep the
+ * number and the format of frames.
+ * @ingroup libtinyalsa-pcm
+ */
+struct pcm_plugin_stage_ops {
+    /** Set to sizeof(struct pcm_plugin_stage_ops) */
+    size_t size;
+    /** Open the stage for a stream of the chained device */
+    int (*open) (void **stage, unsigned int card, unsigned int device,
+                 unsigned int flags);
+    /** Close the stage */
+    void (*close) (void *stage);
+    /** Set up the stage for the hardware parameters of the stream, optional */
+    int (*hw_params) (void *stage, struct snd_pcm_hw_params *params);
+    /** Process frames in place */
+    int (*process) (void *stage, void *buf, unsigned int frames);
+    /** Reset the state of the stage when the stream is prepared, optional */
+    void (*reset) (void *stage);
+};
+
 typedef void (*mixer_event_callback)(struct mixer_plugin *);
 
 struct mixer_plugin_ops {
@@ -0,0 +1,319 @@
+/* card_list.c
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are met:
+**     * Redistributions of source code must retain the above copyright
+**       notice, this list of conditions and the following disclaimer.
+**     * Redistributions in binary form must reproduce the above copyright
+**       notice, this list of conditions and the following disclaimer in the
+**       documentation and/or other materials provided with the distribution.
+**     * Neither the name of The Android Open Source Project nor the names of
+**       its contributors may be used to endorse or promote products derived
+**       from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY The Android Open Source Project ``AS IS'' AND
+** ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+** IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+** ARE DISCLAIMED. IN NO EVENT SHALL The Android Open Source Project BE LIABLE
+** FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+** DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+** SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+** CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+** LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+** OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+** DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#include <sys/ioctl.h>
+
+#include <sound/asound.h>
+
+#include <tinyalsa/card.h>
+
+#ifdef TINYALSA_USES_PLUGINS
+#include "snd_card_plugin.h"
+#endif
+
+/* the number of cards the kernel supports by default */
+#define CARD_LIST_MAX_CARDS 32
+
+/** A card list and the storage of its cards and devices */
+struct card_list_data {
+    struct card_list list;
+    /** The number of references, including the one of the cache */
+    unsigned int refs;
+    struct card_desc cards[];
+};
+
+static pthread_mutex_t card_list_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct card_list_data *card_list_cache;
+
+static void card_list_copy(char *dest, const unsigned char *src, size_t size)
+{
+    memcpy(dest, src, size);
+    dest[size - 1] = '\0';
+}
+
+/* Fills in a card and allocates its devices, using the control device */
+static int card_list_read_card(int fd, struct card_desc *desc)
+{
+    struct snd_ctl_card_info card_info;
+    struct snd_pcm_info pcm_info;
+    struct card_pcm *pcms = NULL, *pcm, *tmp;
+    unsigned int num_pcms = 0, max_pcms = 0;
+    int device = -1, stream;
+
+    memset(&card_info, 0, sizeof(card_info));
+    if (ioctl(fd, SNDRV_CTL_IOCTL_CARD_INFO, &card_info) < 0)
+        return -errno;
+
+    card_list_copy(desc->id, card_info.id, sizeof(desc->id));
+    card_list_copy(desc->driver, card_info.driver, sizeof(desc->driver));
+    card_list_copy(desc->name, card_info.name, sizeof(desc->name));
+    card_list_copy(desc->long_name, card_info.longname, sizeof(desc->long_name));
+
+    while (ioctl(fd, SNDRV_CTL_IOCTL_PCM_NEXT_DEVICE, &device) == 0 && device >= 0) {
+        if (num_pcms == max_pcms) {
+            max_pcms = max_pcms ? max_pcms * 2 : 8;
+            tmp = realloc(pcms, max_pcms * sizeof(*pcms));
+            if (!tmp) {
+                free(pcms);
+                return -ENOMEM;
+            }
+            pcms = tmp;
+        }
+
+        pcm = &pcms[num_pcms];
+        memset(pcm, 0, sizeof(*pcm));
+        pcm->device = device;
+
+        /* a direction the device lacks fails with ENOENT */
+        for (stream = SNDRV_PCM_STREAM_PLAYBACK; stream <= SNDRV_PCM_STREAM_CAPTURE; stream++) {
+            memset(&pcm_info, 0, sizeof(pcm_info));
+            pcm_info.device = device;
+            pcm_info.stream = stream;
+            if (ioctl(fd, SNDRV_CTL_IOCTL_PCM_INFO, &pcm_info) < 0)
+                continue;
+
+            card_list_copy(pcm->id, pcm_info.id, sizeof(pcm->id));
+            card_list_copy(pcm->name, pcm_info.name, sizeof(pcm->name));
+            if (stream == SNDRV_PCM_STREAM_PLAYBACK)
+                pcm->playback_subdevices = pcm_info.subdevices_count;
+            else
+                pcm->capture_subdevices = pcm_info.subdevices_count;
+        }
+
+        if (pcm->playback_subdevices || pcm->capture_subdevices)
+            num_pcms++;
+    }
+
+    desc->num_pcms = num_pcms;
+    desc->pcms = pcms;
+    return 0;
+}
+
+/* Checks that a card still has the given identifier */
+static int card_list_check_id(unsigned int card, const char *id)
+{
+    struct snd_ctl_card_info card_info;
+    char path[32];
+    int fd, ret;
+
+    snprintf(path, sizeof(path), "/dev/snd/controlC%u", card);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return 0;
+
+    memset(&card_info, 0, sizeof(card_info));
+    ret = ioctl(fd, SNDRV_CTL_IOCTL_CARD_INFO, &card_info) == 0 &&
+            !strncmp((const char *)card_info.id, id, sizeof(card_info.id));
+    close(fd);
+    return ret;
+}
+
+static void card_list_release(struct card_list_data *data)
+{
+    unsigned int n;
+
+    if (--data->refs)
+        return;
+
+    for (n = 0; n < data->list.num_cards; n++)
+        free((void *)data->cards[n].pcms);
+    free(data);
+}
+
+static struct card_list_data *card_list_read(void)
+{
+    struct card_list_data *data;
+    char path[32];
+    unsigned int card;
+    int fd;
+
+    data = calloc(1, sizeof(*data) + CARD_LIST_MAX_CARDS * sizeof(data->cards[0]));
+    if (!data)
+        return NULL;
+
+    data->refs = 1;
+    data->list.cards = data->cards;
+
+    for (card = 0; card < CARD_LIST_MAX_CARDS; card++) {
+        snprintf(path, sizeof(path), "/dev/snd/controlC%u", card);
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+
+        data->cards[data->list.num_cards].card = card;
+        if (card_list_read_card(fd, &data->cards[data->list.num_cards]) == 0)
+            data->list.num_cards++;
+        else
+            fprintf(stderr, "%s: failed to read card %u\n", __func__, card);
+        close(fd);
+    }
+
+    return data;
+}
+
+/** Lists the sound cards and their PCM devices.
+ * Each card is read in a single pass over its control device, so that
+ * devices do not need to be probed with pcm_open() or pcm_params_get().
+ * Only the cards of the kernel are listed, not the plugin cards.
+ * @param flags Zero for a fresh list, or @ref CARD_LIST_CACHED to share
+ *  the list read by an earlier call, until card_list_invalidate().
+ * @returns The list, to be released with card_list_free(), or NULL on failure.
+ * @ingroup libtinyalsa-card
+ */
+const struct card_list *card_list_get(unsigned int flags)
+{
+    struct card_list_data *data;
+
+    if (!(flags & CARD_LIST_CACHED)) {
+        data = card_list_read();
+        return data ? &data->list : NULL;
+    }
+
+    pthread_mutex_lock(&card_list_lock);
+    if (!card_list_cache)
+        card_list_cache = card_list_read();
+    data = card_list_cache;
+    if (data)
+        data->refs++;
+    pthread_mutex_unlock(&card_list_lock);
+
+    return data ? &data->list : NULL;
+}
+
+/** Releases a card list.
+ * @param list A list returned by card_list_get(), may be NULL.
+ * @ingroup libtinyalsa-card
+ */
+void card_list_free(const struct card_list *list)
+{
+    if (!list)
+        return;
+
+    pthread_mutex_lock(&card_list_lock);
+    card_list_release((struct card_list_data *)list);
+    pthread_mutex_unlock(&card_list_lock);
+}
+
+/* Drops the cached card list, but not the definitions of the plugin cards */
+static void card_list_drop_cache(void)
+{
+    pthread_mutex_lock(&card_list_lock);
+    if (card_list_cache)
+        card_list_release(card_list_cache);
+    card_list_cache = NULL;
+    pthread_mutex_unlock(&card_list_lock);
+}
+
+/** Drops the cached card list.
+ * The next cached card_list_get() reads the cards again. A card monitor
+ * calls it before reporting that a device node came or went.
+ * Lists already returned remain valid until they are released.
+ * The cached definitions of the plugin cards are dropped as well, so
+ * that they are parsed again when their devices are next opened.
+ * @ingroup libtinyalsa-card
+ */
+void card_list_invalidate(void)
+{
+    card_list_drop_cache();
+
+#ifdef TINYALSA_USES_PLUGINS
+    snd_utils_flush_card_defs();
+#endif
+}
+
+/** Finds a card of the list by its identifier.
+ * @param list An initialized card list.
+ * @param id The identifier of the card, as in the "hw:CARD" notation.
+ * @returns The card, or NULL if no card matches.
+ * @ingroup libtinyalsa-card
+ */
+const struct card_desc *card_list_find(const struct card_list *list, const char *id)
+{
+    unsigned int n;
+
+    if (!list || !id)
+        return NULL;
+
+    for (n = 0; n < list->num_cards; n++) {
+        if (!strcmp(list->cards[n].id, id))
+            return &list->cards[n];
+    }
+
+    return NULL;
+}
+
+/** Resolves a card, given by number or by identifier.
+ * Identifiers are looked up in the cached card list. The card found is
+ * checked against its control device, and the list is read again once
+ * when the identifier is not found or the card has changed since, in
+ * case cards were added, removed or renumbered.
+ * @param name The number of the card, or its identifier,
+ *  optionally prefixed with "CARD=".
+ * @returns The number of the card, or -ENODEV if no card matches.
+ * @ingroup libtinyalsa-card
+ */
+int card_get_index(const char *name)
+{
+    const struct card_list *list;
+    const struct card_desc *desc;
+    const char *pos;
+    int retry, card = -ENODEV;
+
+    if (!name)
+        return -EINVAL;
+
+    if (!strncmp(name, "CARD=", 5))
+        name += 5;
+
+    for (pos = name; isdigit((unsigned char)*pos); pos++)
+        ;
+    if (pos != name && !*pos)
+        return atoi(name);
+
+    for (retry = 0; retry < 2 && card < 0; retry++) {
+        if (retry)
+            card_list_drop_cache();
+
+        list = card_list_get(CARD_LIST_CACHED);
+        desc = card_list_find(list, name);
+        if (desc && card_list_check_id(desc->card, name))
+            card = desc->card;
+        card_list_free(list);
+    }
+
+    return card;
+}
@@ -0,0 +1,250 @@
+/* card_monitor.c
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are met:
+**     * Redistributions of source code must retain the above copyright
+**       notice, this list of conditions and the following disclaimer.
+**     * Redistributions in binary form must reproduce the above copyright
+**       notice, this list of conditions and the following disclaimer in the
+**       documentation and/or other materials provided with the distribution.
+**     * Neither the name of The Android Open Source Project nor the names of
+**       its contributors may be used to endorse or promote products derived
+**       from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY The Android Open Source Project ``AS IS'' AND
+** ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+** IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+** ARE DISCLAIMED. IN NO EVENT SHALL The Android Open Source Project BE LIABLE
+** FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+** DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+** SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+** CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+** LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+** OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+** DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+
+#include <sys/inotify.h>
+
+#include <tinyalsa/card.h>
+
+/* the number of cards the kernel supports (SNDRV_CARDS) */
+#define CARD_MONITOR_MAX_CARDS 32
+
+/** Watches a directory of sound device nodes.
+ * @ingroup libtinyalsa-card
+ */
+struct card_monitor {
+    int fd;
+    card_event_callback callback;
+    void *data;
+    /** The identifiers of the cards seen so far, indexed by card */
+    char ids[CARD_MONITOR_MAX_CARDS][16];
+};
+
+/* Parses the name of a device node, returns zero if it is not reported */
+static int card_monitor_parse(const char *name, struct card_event *event)
+{
+    size_t len = strlen(name);
+    char dir;
+    int n = 0;
+
+    if (sscanf(name, "controlC%u%n", &event->card, &n) == 1 && (size_t)n == len) {
+        event->device_type = CARD_DEVICE_CONTROL;
+        event->device = 0;
+        return 1;
+    }
+
+    n = 0;
+    if (sscanf(name, "pcmC%uD%u%c%n", &event->card, &event->device, &dir, &n) == 3 &&
+            (size_t)n == len && (dir == 'p' || dir == 'c')) {
+        event->device_type = dir == 'p' ? CARD_DEVICE_PCM_PLAYBACK : CARD_DEVICE_PCM_CAPTURE;
+        return 1;
+    }
+
+    n = 0;
+    if (sscanf(name, "comprC%uD%u%n", &event->card, &event->device, &n) == 2 &&
+            (size_t)n == len) {
+        event->device_type = CARD_DEVICE_COMPRESS;
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Gets the identifier of a card, from procfs while the card is present */
+static void card_monitor_resolve_id(struct card_monitor *monitor, struct card_event *event)
+{
+    char path[64];
+    FILE *file;
+    size_t len;
+
+    if (event->type == CARD_EVENT_ADD && !monitor->ids[event->card][0]) {
+        snprintf(path, sizeof(path), "/proc/asound/card%u/id", event->card);
+        file = fopen(path, "r");
+        if (file) {
+            if (fgets(monitor->ids[event->card], sizeof(monitor->ids[0]), file)) {
+                len = strcspn(monitor->ids[event->card], "\n");
+                monitor->ids[event->card][len] = '\0';
+            }
+            fclose(file);
+        }
+    }
+
+    strcpy(event->id, monitor->ids[event->card]);
+
+    /* the card is gone along with its control device */
+    if (event->type == CARD_EVENT_REMOVE && event->device_type == CARD_DEVICE_CONTROL)
+        monitor->ids[event->card][0] = '\0';
+}
+
+/** Opens a monitor of the sound device nodes.
+ * Device nodes created or removed in the directory are reported through
+ * @p callback, from card_monitor_process(). A card is added and removed
+ * along with its control device. Once a card is removed, its mixers must
+ * be closed and its open PCMs, whose pcm_wait() then returns -ENODEV,
+ * must be closed as well. The cached card list and card definitions are
+ * dropped before each event is reported, see card_list_invalidate().
+ * Nodes of cards numbered beyond the kernel limit of 32 are ignored.
+ * @param dir The directory to watch, NULL for @ref CARD_DEFAULT_DIR.
+ * @param callback The function receiving the events.
+ * @param data Passed to @p callback.
+ * @returns A monitor on success, NULL on failure.
+ * @ingroup libtinyalsa-card
+ */
+struct card_monitor *card_monitor_open(const char *dir, card_event_callback callback,
+                                       void *data)
+{
+    struct card_monitor *monitor;
+
+    if (!callback)
+        return NULL;
+
+    monitor = calloc(1, sizeof(*monitor));
+    if (!monitor)
+        return NULL;
+
+    monitor->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (monitor->fd < 0) {
+        fprintf(stderr, "%s: inotify_init1 failed: %s\n", __func__, strerror(errno));
+        free(monitor);
+        return NULL;
+    }
+
+    if (inotify_add_watch(monitor->fd, dir ? dir : CARD_DEFAULT_DIR,
+                          IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO) < 0) {
+        fprintf(stderr, "%s: cannot watch %s: %s\n", __func__,
+                dir ? dir : CARD_DEFAULT_DIR, strerror(errno));
+        close(monitor->fd);
+        free(monitor);
+        return NULL;
+    }
+
+    monitor->callback = callback;
+    monitor->data = data;
+    return monitor;
+}
+
+/** Closes a card monitor.
+ * @param monitor A card monitor, may be NULL.
+ * @ingroup libtinyalsa-card
+ */
+void card_monitor_close(struct card_monitor *monitor)
+{
+    if (!monitor)
+        return;
+
+    close(monitor->fd);
+    free(monitor);
+}
+
+/** Gets the file descriptor of a card monitor.
+ * It becomes readable when card_monitor_process() has events to report,
+ * so that it can be polled along with other file descriptors.
+ * @param monitor An initialized card monitor.
+ * @returns The file descriptor, or -EINVAL.
+ * @ingroup libtinyalsa-card
+ */
+int card_monitor_get_fd(const struct card_monitor *monitor)
+{
+    if (!monitor)
+        return -EINVAL;
+
+    return monitor->fd;
+}
+
+/** Reports the pending events of a card monitor.
+ * @param monitor An initialized card monitor.
+ * @param timeout The time to wait for an event, in milliseconds.
+ *  Zero returns immediately and a negative value waits indefinitely.
+ * @returns The number of events reported, zero if the timeout expired.
+ *  If the watched directory was removed, -ENODEV.
+ *  On other failures, a negative errno value.
+ * @ingroup libtinyalsa-card
+ */
+int card_monitor_process(struct card_monitor *monitor, int timeout)
+{
+    union {
+        struct inotify_event event;
+        char buf[4096];
+    } u;
+    const struct inotify_event *ie;
+    struct card_event event;
+    struct pollfd pfd;
+    ssize_t len;
+    char *pos;
+    int count = 0;
+
+    if (!monitor)
+        return -EINVAL;
+
+    pfd.fd = monitor->fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, timeout) < 0)
+        return -errno;
+
+    for (;;) {
+        len = read(monitor->fd, u.buf, sizeof(u.buf));
+        if (len < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            if (errno == EINTR)
+                continue;
+            return -errno;
+        }
+
+        for (pos = u.buf; pos < u.buf + len; pos += sizeof(*ie) + ie->len) {
+            ie = (const struct inotify_event *)pos;
+
+            if (ie->mask & IN_IGNORED)
+                return -ENODEV;
+            if (ie->mask & IN_Q_OVERFLOW)
+                fprintf(stderr, "%s: events were lost\n", __func__);
+            if (!ie->len || !card_monitor_parse(ie->name, &event))
+                continue;
+            /* no kernel card has a higher number, the node is not a sound device */
+            if (event.card >= CARD_MONITOR_MAX_CARDS)
+                continue;
+
+            event.type = ie->mask & (IN_CREATE | IN_MOVED_TO) ?
+                    CARD_EVENT_ADD : CARD_EVENT_REMOVE;
+            card_monitor_resolve_id(monitor, &event);
+            /* the callback sees the cards and definitions as they are now */
+            card_list_invalidate();
+            monitor->callback(&event, monitor->data);
+            count++;
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,65 @@
+/* fnv_hash.h
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are met:
+**     * Redistributions of source code must retain the above copyright
+**       notice, this list of conditions and the following disclaimer.
+**     * Redistributions in binary form must reproduce the above copyright
+**       notice, this list of conditions and the following disclaimer in the
+**       documentation and/or other materials provided with the distribution.
+**     * Neither the name of The Android Open Source Project nor the names of
+**       its contributors may be used to endorse or promote products derived
+**       from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY The Android Open Source Project ``AS IS'' AND
+** ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+** IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+** ARE DISCLAIMED. IN NO EVENT SHALL The Android Open Source Project BE LIABLE
+** FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+** DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+** SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+** CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+** LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+** OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+** DAMAGE.
+*/
+
+#ifndef TINYALSA_SRC_FNV_HASH_H
+#define TINYALSA_SRC_FNV_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The 32-bit FNV-1a hash, used by the name lookups of the library */
+#define FNV_HASH_INIT 2166136261u
+
+static inline uint32_t fnv_hash_add(uint32_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+
+    while (size--) {
+        hash ^= *bytes++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static inline uint32_t fnv_hash_add_string(uint32_t hash, const char *s)
+{
+    while (*s) {
+        hash ^= (unsigned char)*s++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static inline uint32_t fnv_hash(const char *s)
+{
+    return fnv_hash_add_string(FNV_HASH_INIT, s);
+}
+
+#endif /* TINYALSA_SRC_FNV_HASH_H */
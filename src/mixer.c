@@ -38,6 +38,10 @@
 #include <limits.h>
 #include <time.h>
 #include <poll.h>
+#include <math.h>
+#include <pthread.h>
+#include <fnmatch.h>
+#include <regex.h>
 
 #include <sys/ioctl.h>
 
@@ -58,30 +62,166 @@
 #include <time.h>
 #include <sound/asound.h>
 
+#include <tinyalsa/card.h>
 #include <tinyalsa/mixer.h>
 #include <tinyalsa/plugin.h>
 
+#include "fnv_hash.h"
 #include "mixer_io.h"
 
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/* TLV types, from sound/tlv.h */
+#define MIXER_TLVT_CONTAINER 0
+#define MIXER_TLVT_DB_SCALE 1
+#define MIXER_TLVT_DB_LINEAR 2
+#define MIXER_TLVT_DB_RANGE 3
+#define MIXER_TLVT_DB_MINMAX 4
+#define MIXER_TLVT_DB_MINMAX_MUTE 5
+
+/* the largest dB description read from a control, in bytes */
+#define MIXER_TLV_MAX_SIZE 4096
+/* the most segments of a DB_RANGE description */
+#define MIXER_DB_MAX_SEGMENTS 16
+/* controls with at most that many values get a lookup table */
+#define MIXER_DB_MAX_TABLE_SIZE 1024
+
+/** A segment of the dB description of a control */
+struct mixer_db_segment {
+    /** The range of the control values covered by the segment */
+    long min;
+    long max;
+    /** One of the MIXER_TLVT_DB_* types */
+    unsigned int type;
+    /** The TLV parameters, in 0.01 dB or steps of 0.01 dB */
+    int param[2];
+};
+
+/** The dB description of a control, parsed from its TLV data */
+struct mixer_ctl_db {
+    /** The range of the control values */
+    long min;
+    long max;
+    /** The dB values of each control value from min to max, or NULL */
+    int *table;
+    unsigned int num_segments;
+    struct mixer_db_segment segments[];
+};
+
+/** The names of the items of an enumerated control.
+ * The structure, the name pointers, the lookup table and the names
+ * themselves are stored in a single allocation.
+ */
+struct mixer_ctl_enums {
+    /** The number of items */
+    unsigned int count;
+    /** The size of the lookup table minus one, the size being a power of two */
+    unsigned int mask;
+    /** Open addressed hash table of item index + 1, zero for empty */
+    unsigned int *table;
+    /** The name of each item */
+    char *names[];
+};
+
+/** The parts of a control's info that may change while the control is in use,
+ * as mixer_ctl_update() reads it again or the driver removes the control
+ * and adds it back. They are written with the mixer locked, while the
+ * info_seq of the control is odd, and copied without locking by
+ * mixer_ctl_get_info(), which retries until it reads them between two updates.
+ */
+struct mixer_ctl_info {
+    unsigned int numid;
+    /** The SNDRV_CTL_ELEM_ACCESS_* flags */
+    unsigned int access;
+    /** The SNDRV_CTL_ELEM_TYPE_* type of the values */
+    int type;
+    /** The number of values */
+    unsigned int count;
+    /** The range of the values of integer controls */
+    long min;
+    long max;
+    /** The number of items of enumerated controls */
+    unsigned int items;
+    /** Whether the driver removed the control, which is then left out of its group */
+    bool removed;
+};
+
 /** A mixer control.
+ * Only the parts of the control's info that the interface exposes are
+ * kept, the name being shared with the other controls of the same name.
  * @ingroup libtinyalsa-mixer
  */
 struct mixer_ctl {
     /** The mixer that the mixer control belongs to */
     struct mixer *mixer;
-    /** Information on the control's value (i.e. type, number of values) */
-    struct snd_ctl_elem_info info;
-    /** A list of string representations of enumerated values (only valid for enumerated controls) */
-    char **ename;
     /** Pointer to the group that the control belongs to */
     struct mixer_ctl_group *grp;
+    /** The name of the control, stored in a chunk of its group */
+    const char *name;
+    /** The hash of the name, to skip most string comparisons */
+    uint32_t name_hash;
+    unsigned int device;
+    /** The other parts of the id, to recognize a removed control that is added back */
+    snd_ctl_elem_iface_t iface;
+    unsigned int subdevice;
+    unsigned int index;
+    /** Incremented before and after each update of the info */
+    unsigned int info_seq;
+    struct mixer_ctl_info info;
+    /** Whether the events of the control pass the event filter */
+    bool event_wanted;
+    /** String representations of enumerated values (only valid for enumerated controls) */
+    struct mixer_ctl_enums *enums;
+    /** Called by mixer_dispatch_events() for the events of the control */
+    mixer_ctl_event_callback event_cb;
+    /** Passed to the event callback */
+    void *event_data;
+    /** The dB description of the control, parsed on first use */
+    struct mixer_ctl_db *db;
 };
 
-struct mixer_ctl_group {
-    /** A continuous array of mixer controls */
-    struct mixer_ctl *ctl;
-    /** The number of mixer controls */
+/** An allocation holding mixer controls, followed by their new names.
+ * Controls are never moved once added, so their handles stay valid
+ * until the mixer is closed.
+ */
+struct mixer_ctl_chunk {
+    /** The previously allocated chunk */
+    struct mixer_ctl_chunk *next;
+    /** The number of mixer controls in the chunk */
+    unsigned int count;
+    struct mixer_ctl ctl[];
+};
+
+/** An allocation that lock-free readers may still be using */
+struct mixer_retired {
+    struct mixer_retired *next;
+    void *ptr;
+};
+
+/** Pointers to the mixer controls of a group, in the order of the driver.
+ * Controls are appended in place while there is room. The index is
+ * replaced when it needs to grow or when controls are removed, the
+ * old one being freed once no lookup is in progress.
+ */
+struct mixer_ctl_index {
+    /** The number of pointers that ctl can hold */
+    unsigned int capacity;
+    /** The number of mixer controls, published after the pointers */
     unsigned int count;
+    /** The hashes of the names of the controls, stored apart from the
+     * controls so that name lookups scan them without following pointers
+     */
+    uint32_t *name_hash;
+    struct mixer_ctl *ctl[];
+};
+
+struct mixer_ctl_group {
+    /** The current index of the mixer controls, NULL until some are added */
+    struct mixer_ctl_index *index;
+    /** The chunks holding the mixer controls, including the removed ones */
+    struct mixer_ctl_chunk *chunks;
+    /** The number of removed controls, which come back if the driver adds them again */
+    unsigned int num_removed;
     /** The number of events associated with this group */
     unsigned int event_cnt;
     /** The operations corresponding to this group */
@@ -102,38 +242,297 @@ struct mixer {
     struct mixer_ctl_group *h_grp;
     /* Virtual (Plugin interface) mixer control group */
     struct mixer_ctl_group *v_grp;
-    /* Total count of mixer controls from both  groups */
-    unsigned int total_count;
     /* Flag to track if card information is already retrieved */
     bool is_card_info_retrieved;
+    /* Serializes the addition of controls and the loading of their data */
+    pthread_mutex_t lock;
+    /* Allocations that lock-free readers may still be using */
+    struct mixer_retired *retired;
+    /* Replaced indexes, freed once no lookup is in progress */
+    struct mixer_retired *reclaimable;
+    /* The number of lookups in progress, see mixer_read_begin() */
+    unsigned int readers;
+    /* The controls sorted by name, built on first search */
+    struct mixer_name_index *name_index;
+    /* Incremented whenever controls are added or removed */
+    unsigned int generation;
+    /* Whether mixer_subscribe_events() subscribed, apart from the filter */
+    bool events_subscribed;
+    /* The number of controls whose events pass the filter, zero if unfiltered */
+    unsigned int num_event_ctls;
+    /* Filtered events waiting to be read, a ring of MIXER_EVENT_QUEUE_SIZE.
+     * Once allocated, it is kept until the mixer is closed. */
+    struct mixer_queued_event *event_queue;
+    unsigned int event_head;
+    unsigned int event_count;
+};
+
+/* the number of filtered events held before reading from the driver stops */
+#define MIXER_EVENT_QUEUE_SIZE 64
+
+/** An event that passed the filter */
+struct mixer_queued_event {
+    struct mixer_ctl_event event;
+    /** The group of the control, whose numids may overlap with the other group */
+    struct mixer_ctl_group *grp;
+};
 
+/** The controls of a mixer, sorted by name */
+struct mixer_name_index {
+    /** The generation of the mixer's controls, the index is rebuilt when it changes */
+    unsigned int generation;
+    /** The number of controls */
+    unsigned int count;
+    struct mixer_ctl *ctl[];
 };
 
-static void mixer_cleanup_control(struct mixer_ctl *ctl)
+/* Frees an allocation once the mixer is closed, as readers may still use it */
+static void mixer_retire(struct mixer *mixer, void *ptr)
+{
+    struct mixer_retired *retired;
+
+    if (!ptr)
+        return;
+
+    retired = malloc(sizeof(*retired));
+    if (!retired)
+        return; /* leak rather than free memory in use */
+
+    retired->ptr = ptr;
+    retired->next = mixer->retired;
+    mixer->retired = retired;
+}
+
+/* Marks the start of a lock-free lookup in the indexes of a mixer */
+static void mixer_read_begin(const struct mixer *mixer)
+{
+    __atomic_add_fetch(&((struct mixer *)mixer)->readers, 1, __ATOMIC_RELAXED);
+    /* orders the count before the loads of the indexes, see mixer_reclaim() */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static void mixer_read_end(const struct mixer *mixer)
+{
+    __atomic_sub_fetch(&((struct mixer *)mixer)->readers, 1, __ATOMIC_RELEASE);
+}
+
+/* Frees an index once replaced, with the mixer locked.
+ * The replacement must be published first: a lookup that starts after
+ * the fence loads it, so the replaced indexes are freed as soon as no
+ * lookup is in progress. Otherwise they are kept until a later call.
+ */
+static void mixer_reclaim(struct mixer *mixer, void *ptr)
+{
+    struct mixer_retired *retired;
+
+    if (ptr) {
+        retired = malloc(sizeof(*retired));
+        if (!retired)
+            return; /* leak rather than free memory in use */
+
+        retired->ptr = ptr;
+        retired->next = mixer->reclaimable;
+        mixer->reclaimable = retired;
+    }
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&mixer->readers, __ATOMIC_ACQUIRE))
+        return;
+
+    while (mixer->reclaimable) {
+        retired = mixer->reclaimable;
+        mixer->reclaimable = retired->next;
+        free(retired->ptr);
+        free(retired);
+    }
+}
+
+/* Converts the parts of an element info that may change */
+static void mixer_ctl_info_from_elem(struct mixer_ctl_info *info,
+                                     const struct snd_ctl_elem_info *elem)
+{
+    memset(info, 0, sizeof(*info));
+    info->numid = elem->id.numid;
+    info->access = elem->access;
+    info->type = elem->type;
+    info->count = elem->count;
+
+    if (elem->type == SNDRV_CTL_ELEM_TYPE_INTEGER) {
+        info->min = elem->value.integer.min;
+        info->max = elem->value.integer.max;
+    } else if (elem->type == SNDRV_CTL_ELEM_TYPE_ENUMERATED) {
+        info->items = elem->value.enumerated.items;
+    }
+}
+
+/* Copies an info field by field, for the copy to race with an update without tearing */
+static void mixer_ctl_info_copy(struct mixer_ctl_info *dst, const struct mixer_ctl_info *src)
+{
+    __atomic_store_n(&dst->numid, __atomic_load_n(&src->numid, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&dst->access, __atomic_load_n(&src->access, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&dst->type, __atomic_load_n(&src->type, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&dst->count, __atomic_load_n(&src->count, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&dst->min, __atomic_load_n(&src->min, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&dst->max, __atomic_load_n(&src->max, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&dst->items, __atomic_load_n(&src->items, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&dst->removed, __atomic_load_n(&src->removed, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+}
+
+/* Gets a consistent copy of the info of a control, without locking */
+static void mixer_ctl_get_info(const struct mixer_ctl *ctl, struct mixer_ctl_info *info)
+{
+    unsigned int seq;
+
+    do {
+        seq = __atomic_load_n(&ctl->info_seq, __ATOMIC_ACQUIRE);
+        mixer_ctl_info_copy(info, &ctl->info);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&ctl->info_seq, __ATOMIC_RELAXED));
+}
+
+/* Replaces the info of a control that may be in use, with the mixer locked */
+static void mixer_ctl_set_info(struct mixer_ctl *ctl, const struct mixer_ctl_info *info)
+{
+    unsigned int seq = ctl->info_seq;
+
+    __atomic_store_n(&ctl->info_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    mixer_ctl_info_copy(&ctl->info, info);
+    __atomic_store_n(&ctl->info_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/* Gets the numid of a control, without locking */
+static unsigned int mixer_ctl_numid(const struct mixer_ctl *ctl)
+{
+    return __atomic_load_n(&ctl->info.numid, __ATOMIC_RELAXED);
+}
+
+static struct mixer_ctl_index *mixer_ctl_index_alloc(unsigned int capacity)
+{
+    struct mixer_ctl_index *index;
+
+    index = malloc(sizeof(*index) +
+                   capacity * (sizeof(index->ctl[0]) + sizeof(index->name_hash[0])));
+    if (!index)
+        return NULL;
+
+    index->capacity = capacity;
+    index->name_hash = (uint32_t *)&index->ctl[capacity];
+    return index;
+}
+
+/* Gets the index of a group, without locking */
+static const struct mixer_ctl_index *mixer_grp_get_index(const struct mixer_ctl_group *grp,
+                                                         unsigned int *count)
+{
+    struct mixer_ctl_index *index = grp ? __atomic_load_n(&grp->index, __ATOMIC_ACQUIRE) : NULL;
+
+    if (!index) {
+        *count = 0;
+        return NULL;
+    }
+
+    /* the count is published after the pointers and hashes it covers */
+    *count = __atomic_load_n(&index->count, __ATOMIC_ACQUIRE);
+    return index;
+}
+
+/* Checks whether two infos of a control differ */
+static bool mixer_ctl_info_differs(const struct mixer_ctl_info *a,
+                                   const struct mixer_ctl_info *b)
+{
+    return a->numid != b->numid || a->access != b->access || a->type != b->type ||
+           a->count != b->count || a->min != b->min || a->max != b->max ||
+           a->items != b->items || a->removed != b->removed;
+}
+
+/* Gets the controls of a group, without locking */
+static struct mixer_ctl **mixer_grp_get_ctls(const struct mixer_ctl_group *grp,
+                                             unsigned int *count)
+{
+    const struct mixer_ctl_index *index = mixer_grp_get_index(grp, count);
+
+    return index ? (struct mixer_ctl **)index->ctl : NULL;
+}
+
+/* Checks whether the control at a position of an index goes by a name */
+static bool mixer_ctl_index_match(const struct mixer_ctl_index *index, unsigned int n,
+                                  uint32_t hash, const char *name)
+{
+    return index->name_hash[n] == hash && !strcmp(name, index->ctl[n]->name);
+}
+
+static unsigned int mixer_grp_get_count(const struct mixer_ctl_group *grp)
+{
+    unsigned int count;
+
+    mixer_grp_get_ctls(grp, &count);
+    return count;
+}
+
+static struct mixer_ctl *mixer_grp_get_ctl_by_numid(struct mixer *mixer,
+                                                    struct mixer_ctl_group *grp,
+                                                    unsigned int numid)
 {
-    unsigned int m;
+    struct mixer_ctl **ctl, *found = NULL;
+    unsigned int n, count;
+
+    mixer_read_begin(mixer);
+    ctl = mixer_grp_get_ctls(grp, &count);
 
-    if (ctl->ename) {
-        unsigned int max = ctl->info.value.enumerated.items;
-        for (m = 0; m < max; m++)
-            free(ctl->ename[m]);
-        free(ctl->ename);
+    /* numids are usually contiguous, starting at 1 for hardware controls
+     * and at 0 for plugin controls
+     */
+    if (numid < count && mixer_ctl_numid(ctl[numid]) == numid) {
+        found = ctl[numid];
+    } else if (numid > 0 && numid - 1 < count && mixer_ctl_numid(ctl[numid - 1]) == numid) {
+        found = ctl[numid - 1];
+    } else {
+        for (n = 0; n < count && !found; n++)
+            if (mixer_ctl_numid(ctl[n]) == numid)
+                found = ctl[n];
     }
+    mixer_read_end(mixer);
+
+    return found;
+}
+
+static void mixer_cleanup_control(struct mixer_ctl *ctl)
+{
+    free(ctl->enums);
+    ctl->enums = NULL;
+
+    if (ctl->db)
+        free(ctl->db->table);
+    free(ctl->db);
+    ctl->db = NULL;
 }
 
 static void mixer_grp_close(struct mixer *mixer, struct mixer_ctl_group *grp)
 {
+    struct mixer_ctl_chunk *chunk;
     unsigned int n;
 
     if (!grp)
         return;
 
-    if (grp->ctl) {
-        for (n = 0; n < grp->count; n++)
-            mixer_cleanup_control(&grp->ctl[n]);
-        free(grp->ctl);
+    while (grp->chunks) {
+        chunk = grp->chunks;
+        grp->chunks = chunk->next;
+        for (n = 0; n < chunk->count; n++)
+            mixer_cleanup_control(&chunk->ctl[n]);
+        free(chunk);
     }
 
+    free(grp->index);
     free(grp);
 
     mixer->is_card_info_retrieved = false;
@@ -145,6 +544,8 @@ static void mixer_grp_close(struct mixer *mixer, struct mixer_ctl_group *grp)
  */
 void mixer_close(struct mixer *mixer)
 {
+    struct mixer_retired *retired;
+
     if (!mixer)
         return;
 
@@ -158,94 +559,510 @@ void mixer_close(struct mixer *mixer)
     mixer_grp_close(mixer, mixer->v_grp);
 #endif
 
+    while (mixer->retired) {
+        retired = mixer->retired;
+        mixer->retired = retired->next;
+        free(retired->ptr);
+        free(retired);
+    }
+    mixer_reclaim(mixer, NULL);
+
+    free(mixer->name_index);
+    free(mixer->event_queue);
+    pthread_mutex_destroy(&mixer->lock);
     free(mixer);
 
     /* TODO: verify frees */
 }
 
-static void *mixer_realloc_z(void *ptr, size_t curnum, size_t newnum, size_t size)
+static bool mixer_ctl_db_is_current(const struct mixer_ctl *ctl, const struct mixer_ctl_db *db);
+
+/* Replaces the info of a control and what is derived from it, with the mixer locked.
+ * Other threads may be reading the info, they see either version.
+ */
+static void mixer_ctl_replace_info(struct mixer_ctl *ctl, const struct mixer_ctl_info *info)
+{
+    struct mixer_ctl_db *db;
+    bool items_changed;
+
+    if (mixer_ctl_info_differs(info, &ctl->info)) {
+        items_changed = info->type != ctl->info.type || info->items != ctl->info.items;
+        mixer_ctl_set_info(ctl, info);
+
+        /* the names of the enumerated items change along with their number,
+         * other threads may still be reading the previous ones
+         */
+        if (items_changed)
+            mixer_retire(ctl->mixer, __atomic_exchange_n(&ctl->enums, NULL, __ATOMIC_ACQ_REL));
+    }
+
+    /* most info changes, such as the access flags of inactive controls,
+     * leave the dB scale alone and the parsed one is kept
+     */
+    db = ctl->db;
+    if (db && !mixer_ctl_db_is_current(ctl, db)) {
+        __atomic_store_n(&ctl->db, NULL, __ATOMIC_RELEASE);
+        mixer_retire(ctl->mixer, db->table);
+        mixer_retire(ctl->mixer, db);
+    }
+}
+
+/* Reads controls new to a group into a chunk, with the mixer locked.
+ * The names the group already uses are shared, the others are stored
+ * after the controls of the chunk.
+ */
+static struct mixer_ctl_chunk *mixer_grp_read_ctls(struct mixer *mixer,
+                                                   struct mixer_ctl_group *grp,
+                                                   const struct snd_ctl_elem_info *infos,
+                                                   unsigned int count)
+{
+    struct mixer_ctl_chunk *chunk = NULL;
+    struct mixer_ctl **ctls;
+    struct mixer_ctl *ctl;
+    const char **names = NULL;
+    unsigned int *slots = NULL;
+    unsigned int old_count;
+    unsigned int n, slot, mask = 15;
+    size_t names_size = 0, len;
+    char *dest;
+
+    slots = calloc(count, sizeof(*slots));
+    if (!slots)
+        goto exit;
+
+    /* intern the names, those already known are shared and the others
+     * are stored after the controls of the chunk
+     */
+    ctls = mixer_grp_get_ctls(grp, &old_count);
+    while (mask < 2 * (old_count + count))
+        mask = mask * 2 + 1;
+    names = calloc(mask + 1, sizeof(*names));
+    if (!names)
+        goto exit;
+
+    for (n = 0; n < old_count + count; n++) {
+        const char *name = n < old_count ? ctls[n]->name : (const char *)infos[n - old_count].id.name;
+
+        for (slot = fnv_hash(name) & mask; names[slot]; slot = (slot + 1) & mask) {
+            if (!strcmp(names[slot], name))
+                break;
+        }
+        if (!names[slot]) {
+            names[slot] = name;
+            if (n >= old_count)
+                names_size += strlen(name) + 1;
+        }
+        if (n >= old_count)
+            slots[n - old_count] = slot;
+    }
+
+    chunk = calloc(1, sizeof(*chunk) + count * sizeof(chunk->ctl[0]) + names_size);
+    if (!chunk)
+        goto exit;
+
+    dest = (char *)&chunk->ctl[count];
+    for (n = 0; n < count; n++) {
+        ctl = &chunk->ctl[n];
+        slot = slots[n];
+        /* the first control of a new name moves it into the chunk */
+        if (names[slot] == (const char *)infos[n].id.name) {
+            len = strlen(names[slot]) + 1;
+            memcpy(dest, names[slot], len);
+            names[slot] = dest;
+            dest += len;
+        }
+        /* the chunk is not published yet */
+        ctl->device = infos[n].id.device;
+        ctl->iface = infos[n].id.iface;
+        ctl->subdevice = infos[n].id.subdevice;
+        ctl->index = infos[n].id.index;
+        mixer_ctl_info_from_elem(&ctl->info, &infos[n]);
+        ctl->name = names[slot];
+        ctl->name_hash = fnv_hash(ctl->name);
+        ctl->mixer = mixer;
+        ctl->grp = grp;
+    }
+    chunk->count = count;
+
+exit:
+    free(names);
+    free(slots);
+    return chunk;
+}
+
+/* Finds the removed controls of a group that the driver added back, with the mixer locked.
+ * Each of them takes the info it is added back with, and is stored in
+ * ctls at the position of that info. Returns the number of controls found.
+ */
+static unsigned int mixer_grp_revive_ctls(struct mixer_ctl_group *grp,
+                                          const struct snd_ctl_elem_info *infos,
+                                          unsigned int count, struct mixer_ctl **ctls)
+{
+    struct mixer_ctl_chunk *chunk;
+    struct mixer_ctl_info info;
+    struct mixer_ctl **table;
+    struct mixer_ctl *ctl;
+    const struct snd_ctl_elem_id *id;
+    unsigned int n, slot, mask = 15, revived = 0;
+
+    if (!grp->num_removed)
+        return 0;
+
+    while (mask < 2 * grp->num_removed)
+        mask = mask * 2 + 1;
+    table = calloc(mask + 1, sizeof(*table));
+    if (!table)
+        return 0; /* the controls are then added as new ones */
+
+    for (chunk = grp->chunks; chunk; chunk = chunk->next) {
+        for (n = 0; n < chunk->count; n++) {
+            ctl = &chunk->ctl[n];
+            if (!ctl->info.removed)
+                continue;
+
+            for (slot = ctl->name_hash & mask; table[slot]; slot = (slot + 1) & mask)
+                ;
+            table[slot] = ctl;
+        }
+    }
+
+    for (n = 0; n < count; n++) {
+        id = &infos[n].id;
+        for (slot = fnv_hash((const char *)id->name) & mask; (ctl = table[slot]);
+                slot = (slot + 1) & mask) {
+            if (ctl->info.removed && ctl->device == id->device &&
+                    ctl->subdevice == id->subdevice && ctl->iface == id->iface &&
+                    ctl->index == id->index && !strcmp(ctl->name, (const char *)id->name))
+                break;
+        }
+        if (!ctl)
+            continue;
+
+        /* handles of the removed control work again, with the new numid */
+        mixer_ctl_info_from_elem(&info, &infos[n]);
+        mixer_ctl_replace_info(ctl, &info);
+        grp->num_removed--;
+        ctls[n] = ctl;
+        revived++;
+    }
+
+    free(table);
+    return revived;
+}
+
+/* Appends controls to a group, with the mixer locked.
+ * The positions of ctls left NULL take the controls of the chunk, in order.
+ */
+static int mixer_grp_append(struct mixer *mixer, struct mixer_ctl_group *grp,
+                            struct mixer_ctl **ctls, unsigned int num_ctls,
+                            struct mixer_ctl_chunk *chunk)
+{
+    struct mixer_ctl_index *index = grp->index, *grown = index;
+    unsigned int n, i = 0, count = index ? index->count : 0;
+    unsigned int capacity = index ? index->capacity : 64;
+    struct mixer_ctl *ctl;
+
+    /* existing controls stay where they are, only the pointers are copied */
+    if (!index || count + num_ctls > capacity) {
+        while (capacity < count + num_ctls)
+            capacity *= 2;
+
+        grown = mixer_ctl_index_alloc(capacity);
+        if (!grown)
+            return -ENOMEM;
+        if (count) {
+            memcpy(grown->ctl, index->ctl, count * sizeof(grown->ctl[0]));
+            memcpy(grown->name_hash, index->name_hash, count * sizeof(grown->name_hash[0]));
+        }
+    }
+
+    for (n = 0; n < num_ctls; n++) {
+        ctl = ctls[n] ? ctls[n] : &chunk->ctl[i++];
+        grown->ctl[count + n] = ctl;
+        grown->name_hash[count + n] = ctl->name_hash;
+    }
+
+    if (grown != index) {
+        grown->count = count + num_ctls;
+        __atomic_store_n(&grp->index, grown, __ATOMIC_RELEASE);
+        mixer_reclaim(mixer, index);
+    } else {
+        __atomic_store_n(&index->count, count + num_ctls, __ATOMIC_RELEASE);
+    }
+
+    if (chunk) {
+        chunk->next = grp->chunks;
+        grp->chunks = chunk;
+    }
+    __atomic_store_n(&mixer->generation, mixer->generation + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static int mixer_grp_subscribe_events(struct mixer *mixer, int subscribe);
+
+/* Flags a control the driver removed, with the mixer locked.
+ * A control removed while subscribed no longer counts towards the filter.
+ */
+static void mixer_ctl_set_removed(struct mixer *mixer, struct mixer_ctl *ctl)
+{
+    struct mixer_ctl_info info = ctl->info;
+
+    info.removed = true;
+    mixer_ctl_set_info(ctl, &info);
+    ctl->grp->num_removed++;
+    if (!ctl->event_wanted)
+        return;
+
+    ctl->event_wanted = false;
+    if (--mixer->num_event_ctls == 0 && !mixer->events_subscribed)
+        mixer_grp_subscribe_events(mixer, 0);
+}
+
+/* Adds the controls of some ids to a group, with the mixer locked.
+ * Removed controls that the driver added back come back in place, the
+ * others are read into a new chunk. Controls whose info cannot be read
+ * are left out. Returns the number of controls added, or a negative errno.
+ */
+static int mixer_grp_add_ctls(struct mixer *mixer, struct mixer_ctl_group *grp,
+                              const struct snd_ctl_elem_id *ids, unsigned int count)
+{
+    struct snd_ctl_elem_info *infos;
+    struct mixer_ctl_chunk *chunk = NULL;
+    struct mixer_ctl **ctls = NULL;
+    unsigned int n, added = 0, fresh = 0;
+    int ret = -ENOMEM;
+
+    infos = calloc(count, sizeof(*infos));
+    if (!infos)
+        return -ENOMEM;
+
+    for (n = 0; n < count; n++) {
+        infos[added].id = ids[n];
+        if (grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_ELEM_INFO, &infos[added]) < 0)
+            continue; /* keep the controls we successfully read */
+        infos[added].id.name[sizeof(infos[added].id.name) - 1] = '\0';
+        added++;
+    }
+
+    ret = added;
+    if (!added)
+        goto exit;
+
+    ret = -ENOMEM;
+    ctls = calloc(added, sizeof(*ctls));
+    if (!ctls)
+        goto exit;
+
+    if (mixer_grp_revive_ctls(grp, infos, added, ctls) < added) {
+        for (n = 0; n < added; n++) {
+            if (!ctls[n])
+                infos[fresh++] = infos[n];
+        }
+        chunk = mixer_grp_read_ctls(mixer, grp, infos, fresh);
+        if (!chunk)
+            goto undo;
+    }
+
+    if (mixer_grp_append(mixer, grp, ctls, added, chunk) < 0)
+        goto undo;
+
+    ret = added;
+    goto exit;
+
+undo:
+    free(chunk);
+    for (n = 0; n < added; n++) {
+        if (ctls[n])
+            mixer_ctl_set_removed(mixer, ctls[n]);
+    }
+exit:
+    free(ctls);
+    free(infos);
+    return ret;
+}
+
+/* Leaves the controls flagged as removed out of a group, with the mixer locked.
+ * The controls themselves are kept until the mixer is closed, as their
+ * handles may still be in use.
+ */
+static int mixer_grp_drop_removed(struct mixer *mixer, struct mixer_ctl_group *grp)
 {
-        int8_t *newp;
+    struct mixer_ctl_index *index = grp->index, *kept;
+    unsigned int n, count = 0;
+
+    kept = mixer_ctl_index_alloc(index->capacity);
+    if (!kept)
+        return -ENOMEM;
 
-        newp = realloc(ptr, size * newnum);
-        if (!newp)
-            return NULL;
+    for (n = 0; n < index->count; n++) {
+        if (!index->ctl[n]->info.removed) {
+            kept->ctl[count] = index->ctl[n];
+            kept->name_hash[count++] = index->name_hash[n];
+        }
+    }
+    kept->count = count;
+
+    __atomic_store_n(&grp->index, kept, __ATOMIC_RELEASE);
+    mixer_reclaim(mixer, index);
+    __atomic_store_n(&mixer->generation, mixer->generation + 1, __ATOMIC_RELEASE);
+    return 0;
+}
 
-        memset(newp + (curnum * size), 0, (newnum - curnum) * size);
-        return newp;
+static uint32_t mixer_numid_hash(unsigned int numid)
+{
+    return numid * 2654435761u;
 }
 
+/* Brings the controls of a group in line with the driver's, with the mixer locked.
+ * Only the ids of the controls are listed, the info being read for the
+ * new controls alone.
+ */
 static int add_controls(struct mixer *mixer, struct mixer_ctl_group *grp)
 {
     struct snd_ctl_elem_list elist;
     struct snd_ctl_elem_id *eid = NULL;
-    struct mixer_ctl *ctl;
-    const unsigned int old_count = grp->count;
-    unsigned int new_count;
-    unsigned int n;
+    struct mixer_ctl **ctls;
+    unsigned int *table = NULL;
+    bool *known = NULL;
+    unsigned int old_count, listed, added = 0, removed = 0;
+    unsigned int n, slot, mask = 15;
+    int ret = -1;
 
     memset(&elist, 0, sizeof(elist));
     if (grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_ELEM_LIST, &elist) < 0)
-        goto fail;
+        return -1;
 
-    if (old_count == elist.count)
-        return 0; /* no new controls return unchanged */
+    ctls = mixer_grp_get_ctls(grp, &old_count);
+    if (!elist.count && !old_count)
+        return 0;
 
-    if (old_count > elist.count)
-        return -1; /* driver has removed controls - this is bad */
+    if (elist.count) {
+        eid = calloc(elist.count, sizeof(*eid));
+        if (!eid)
+            return -1;
 
-    ctl = mixer_realloc_z(grp->ctl, old_count, elist.count,
-                          sizeof(struct mixer_ctl));
-    if (!ctl)
-        goto fail;
+        elist.space = elist.count;
+        elist.pids = eid;
+        if (grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_ELEM_LIST, &elist) < 0)
+            goto exit;
+    }
+    /* controls may have been removed since they were counted */
+    listed = elist.used < elist.space ? elist.used : elist.space;
+
+    while (mask < 2 * listed)
+        mask = mask * 2 + 1;
+    table = calloc(mask + 1, sizeof(*table));
+    known = calloc(listed + 1, sizeof(*known));
+    if (!table || !known)
+        goto exit;
 
-    grp->ctl = ctl;
+    /* table holds the position + 1 of each listed numid */
+    for (n = 0; n < listed; n++) {
+        for (slot = mixer_numid_hash(eid[n].numid) & mask; table[slot];
+                slot = (slot + 1) & mask)
+            ;
+        table[slot] = n + 1;
+    }
 
-    /* ALSA drivers are not supposed to remove or re-order controls that
-     * have already been created so we know that any new controls must
-     * be after the ones we have already collected
-     */
-    new_count = elist.count;
-    elist.space = new_count - old_count; /* controls we haven't seen before */
-    elist.offset = old_count; /* first control we haven't seen */
+    for (n = 0; n < old_count; n++) {
+        for (slot = mixer_numid_hash(ctls[n]->info.numid) & mask; table[slot];
+                slot = (slot + 1) & mask) {
+            if (eid[table[slot] - 1].numid == ctls[n]->info.numid)
+                break;
+        }
+        if (table[slot]) {
+            known[table[slot] - 1] = true;
+        } else {
+            mixer_ctl_set_removed(mixer, ctls[n]);
+            removed++;
+        }
+    }
 
-    eid = calloc(elist.space, sizeof(struct snd_ctl_elem_id));
-    if (!eid)
-        goto fail;
+    if (removed && mixer_grp_drop_removed(mixer, grp) < 0)
+        goto exit;
 
-    elist.pids = eid;
+    /* new controls come after the known ones, in the driver's order */
+    for (n = 0; n < listed; n++) {
+        if (!known[n])
+            eid[added++] = eid[n];
+    }
 
-    if (grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_ELEM_LIST, &elist) < 0)
-        goto fail;
+    ret = 0;
+    if (added && mixer_grp_add_ctls(mixer, grp, eid, added) != (int)added)
+        ret = -1;
+
+exit:
+    free(known);
+    free(table);
+    free(eid);
+    return ret;
+}
+
+/* Keeps the controls of a group in line with the events read from it.
+ * On failure, the next call to mixer_add_new_ctls() catches up.
+ */
+static void mixer_grp_apply_events(struct mixer *mixer, struct mixer_ctl_group *grp,
+                                   const struct mixer_ctl_event *events, unsigned int count)
+{
+    struct snd_ctl_elem_id *ids = NULL, *grown;
+    struct mixer_ctl *ctl;
+    unsigned int n, i, mask, numid, num_ids = 0, removed = 0;
 
-    for (n = old_count; n < new_count; n++) {
-        struct snd_ctl_elem_info *ei = &grp->ctl[n].info;
-        ei->id.numid = eid[n - old_count].numid;
-        if (grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_ELEM_INFO, ei) < 0)
-            goto fail_extend;
-        ctl[n].mixer = mixer;
-        ctl[n].grp = grp;
+    /* most events only report new values */
+    for (n = 0; n < count; n++) {
+        mask = events[n].data.element.mask;
+        if (events[n].type == SNDRV_CTL_EVENT_ELEM &&
+                (mask == SNDRV_CTL_EVENT_MASK_REMOVE || (mask & SNDRV_CTL_EVENT_MASK_ADD)))
+            break;
     }
+    if (n == count)
+        return;
 
-    grp->count = new_count;
-    mixer->total_count += (new_count - old_count);
+    pthread_mutex_lock(&mixer->lock);
 
-    free(eid);
-    return 0;
+    for (; n < count; n++) {
+        if (events[n].type != SNDRV_CTL_EVENT_ELEM)
+            continue;
 
-fail_extend:
-    /* cleanup the control we failed on but leave the ones that were already
-     * added. Also no advantage to shrinking the resized memory block, we
-     * might want to extend the controls again later
-     */
-    mixer_cleanup_control(&ctl[n]);
+        mask = events[n].data.element.mask;
+        numid = events[n].data.element.id.numid;
+        for (i = 0; i < num_ids && ids[i].numid != numid; i++)
+            ;
 
-    grp->count = n;   /* keep controls we successfully added */
-    mixer->total_count += (n - old_count);
-    /* fall through... */
-fail:
-    free(eid);
-    return -1;
+        if (mask == SNDRV_CTL_EVENT_MASK_REMOVE) {
+            /* a control added and removed within the batch is not added */
+            if (i < num_ids) {
+                memmove(&ids[i], &ids[i + 1], (num_ids - i - 1) * sizeof(ids[0]));
+                num_ids--;
+                continue;
+            }
+            ctl = mixer_grp_get_ctl_by_numid(mixer, grp, numid);
+            if (ctl && !ctl->info.removed) {
+                mixer_ctl_set_removed(mixer, ctl);
+                removed++;
+            }
+        } else if (mask & SNDRV_CTL_EVENT_MASK_ADD) {
+            ctl = mixer_grp_get_ctl_by_numid(mixer, grp, numid);
+            if (i < num_ids || (ctl && !ctl->info.removed))
+                continue;
+
+            grown = realloc(ids, (num_ids + 1) * sizeof(ids[0]));
+            if (!grown)
+                break;
+            ids = grown;
+            memcpy(&ids[num_ids++], &events[n].data.element.id, sizeof(ids[0]));
+        }
+    }
+
+    /* removed numids may come back, so the old controls are dropped first */
+    if (removed)
+        mixer_grp_drop_removed(mixer, grp);
+
+    if (num_ids)
+        mixer_grp_add_ctls(mixer, grp, ids, num_ids);
+
+    pthread_mutex_unlock(&mixer->lock);
+    free(ids);
 }
 
 static int mixer_grp_open(struct mixer *mixer, unsigned int card, bool is_hw)
@@ -296,6 +1113,14 @@ static int mixer_grp_open(struct mixer *mixer, unsigned int card, bool is_hw)
 
 err_card_info:
     grp->ops->close(grp->data);
+    if (is_hw) {
+        mixer->fd = -1;
+        mixer->h_grp = NULL;
+    } else {
+        mixer->v_grp = NULL;
+    }
+    mixer_grp_close(mixer, grp);
+    return ret;
 
 err_open:
     free(grp);
@@ -304,6 +1129,10 @@ err_open:
 }
 
 /** Opens a mixer for a given card.
+ * A mixer may be used from several threads. Control handles stay valid
+ * until the mixer is closed, and lookups and value accesses never wait
+ * for each other. The event functions are meant to be used from a
+ * single thread.
  * @param card The card to open the mixer for.
  * @returns An initialized mixer handle.
  * @ingroup libtinyalsa-mixer
@@ -317,6 +1146,8 @@ struct mixer *mixer_open(unsigned int card)
     if (!mixer)
         goto fail;
 
+    pthread_mutex_init(&mixer->lock, NULL);
+
     h_status = mixer_grp_open(mixer, card, true);
 
 #ifdef TINYALSA_USES_PLUGINS
@@ -336,20 +1167,54 @@ fail:
     return NULL;
 }
 
+/** Opens a mixer by the name of its card.
+ * @param name The name of the card, in the format <i>hw</i>:<b>card</b>.
+ *  The card may be given by number or by identifier, see @ref card_get_index.
+ * @returns An initialized mixer handle, or NULL on failure.
+ * @ingroup libtinyalsa-mixer
+ */
+struct mixer *mixer_open_by_name(const char *name)
+{
+    int card;
+
+    if (!name || strncmp(name, "hw:", 3))
+        return NULL;
+
+    card = card_get_index(&name[3]);
+    if (card < 0)
+        return NULL;
+
+    return mixer_open(card);
+}
+
 /** Some controls may not be present at boot time, e.g. controls from runtime
  * loadable DSP firmware. This function adds any new controls that have appeared
- * since mixer_open() or the last call to this function. This assumes a well-
- * behaved codec driver that does not delete controls that already exists, so
- * any added controls must be after the last one we already saw. Scanning only
- * the new controls is much faster than calling mixer_close() then mixer_open()
- * to re-scan all controls.
+ * since mixer_open() or the last call to this function, and leaves out those
+ * the driver has removed. Only the info of the new controls is read, which is
+ * much faster than calling mixer_close() then mixer_open() to re-scan all controls.
+ *
+ * Once the mixer is subscribed to events, this is also done as the events
+ * announcing added or removed controls are read, by mixer_read_event(),
+ * mixer_read_events(), mixer_dispatch_events() and mixer_wait_event() when
+ * events are filtered, so calling this function is then only needed to
+ * catch up after a failure.
  *
- * NOTE: this invalidates any struct mixer_ctl pointers previously obtained
- * from mixer_get_ctl() and mixer_get_ctl_by_name(). Either refresh all your
- * stored pointers after calling mixer_update_ctls(), or (better) do not
- * store struct mixer_ctl pointers, instead lookup the control by name or
- * id only when you are about to use it. The overhead of lookup by id
- * using mixer_get_ctl() is negligible.
+ * The struct mixer_ctl pointers previously obtained from mixer_get_ctl()
+ * and mixer_get_ctl_by_name() remain valid, and other threads may keep
+ * using the mixer while the controls are added. The handles of removed
+ * controls remain valid too, until the mixer is closed, but their values
+ * can no longer be accessed until the driver adds the same control back,
+ * when the handle works again. Control ids, as used by mixer_get_ctl(),
+ * change when controls are removed.
+ *
+ * As handles stay valid, a removed control keeps its memory, about 140
+ * bytes and its name on 64-bit systems, until the mixer is closed or the
+ * control is added back. A driver that removes and adds the same controls
+ * again, as DSP firmware reloads do, thus leaves the memory of the mixer
+ * unchanged, while each control added with a new id takes more. The lists
+ * of controls that additions and removals replace are freed once no other
+ * thread is looking controls up. Item names and dB scales that change are
+ * kept until the mixer is closed, as they may still be in use.
  * @param mixer An initialized mixer handle.
  * @returns 0 on success, -1 on failure
  */
@@ -360,6 +1225,8 @@ int mixer_add_new_ctls(struct mixer *mixer)
     if (!mixer)
         return 0;
 
+    pthread_mutex_lock(&mixer->lock);
+
     /* add the h_grp controls */
     if (mixer->h_grp)
         rc1 = add_controls(mixer, mixer->h_grp);
@@ -370,6 +1237,8 @@ int mixer_add_new_ctls(struct mixer *mixer)
         rc2 = add_controls(mixer, mixer->v_grp);
 #endif
 
+    pthread_mutex_unlock(&mixer->lock);
+
     if (rc1 < 0)
         return rc1;
     if (rc2 < 0)
@@ -392,6 +1261,22 @@ const char *mixer_get_name(const struct mixer *mixer)
     return (const char *)mixer->card_info.name;
 }
 
+/** Gets the identifier of the mixer's card.
+ * This is the short, stable name of the card, such as the one used
+ * in the "hw:CARD" notation.
+ * @param mixer An initialized mixer handle.
+ * @returns The identifier of the mixer's card.
+ * @ingroup libtinyalsa-mixer
+ */
+const char *mixer_get_id(const struct mixer *mixer)
+{
+    if (!mixer) {
+        return NULL;
+    }
+
+    return (const char *)mixer->card_info.id;
+}
+
 /** Gets the number of mixer controls for a given mixer.
  * @param mixer An initialized mixer handle.
  * @returns The number of mixer controls for the given mixer.
@@ -399,10 +1284,16 @@ const char *mixer_get_name(const struct mixer *mixer)
  */
 unsigned int mixer_get_num_ctls(const struct mixer *mixer)
 {
+    unsigned int count;
+
     if (!mixer)
         return 0;
 
-    return mixer->total_count;
+    mixer_read_begin(mixer);
+    count = mixer_grp_get_count(mixer->h_grp) + mixer_grp_get_count(mixer->v_grp);
+    mixer_read_end(mixer);
+
+    return count;
 }
 
 /** Gets the number of mixer controls, that go by a specified name, for a given mixer.
@@ -413,52 +1304,44 @@ unsigned int mixer_get_num_ctls(const struct mixer *mixer)
  */
 unsigned int mixer_get_num_ctls_by_name(const struct mixer *mixer, const char *name)
 {
-    struct mixer_ctl_group *grp;
-    unsigned int n;
+    unsigned int n, num_ctls;
     unsigned int count = 0;
-    struct mixer_ctl *ctl;
+    const struct mixer_ctl_index *index;
+    uint32_t hash;
 
     if (!mixer || !name) {
         return 0;
     }
 
+    hash = fnv_hash(name);
+    mixer_read_begin(mixer);
+
     if (mixer->h_grp) {
-        grp = mixer->h_grp;
-        ctl = grp->ctl;
+        index = mixer_grp_get_index(mixer->h_grp, &num_ctls);
 
-        for (n = 0; n < grp->count; n++)
-            if (!strcmp(name, (char*) ctl[n].info.id.name))
+        for (n = 0; n < num_ctls; n++)
+            if (mixer_ctl_index_match(index, n, hash, name))
                 count++;
     }
 #ifdef TINYALSA_USES_PLUGINS
     if (mixer->v_grp) {
-        grp = mixer->v_grp;
-        ctl = grp->ctl;
+        index = mixer_grp_get_index(mixer->v_grp, &num_ctls);
 
-        for (n = 0; n < grp->count; n++)
-            if (!strcmp(name, (char*) ctl[n].info.id.name))
+        for (n = 0; n < num_ctls; n++)
+            if (mixer_ctl_index_match(index, n, hash, name))
                 count++;
     }
 #endif
 
+    mixer_read_end(mixer);
     return count;
 }
 
-/** Subscribes for the mixer events.
- * @param mixer A mixer handle.
- * @param subscribe value indicating subscribe or unsubscribe for events
- * @returns On success, zero.
- *  On failure, non-zero.
- * @ingroup libtinyalsa-mixer
- */
-int mixer_subscribe_events(struct mixer *mixer, int subscribe)
+/* Subscribes the control devices, with the mixer locked */
+static int mixer_grp_subscribe_events(struct mixer *mixer, int subscribe)
 {
     struct mixer_ctl_group *grp;
 
-    if (!mixer) {
-        return -EINVAL;
-    }
-
     if (mixer->h_grp) {
         grp = mixer->h_grp;
         if (grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_SUBSCRIBE_EVENTS, &subscribe) < 0)
@@ -475,6 +1358,201 @@ int mixer_subscribe_events(struct mixer *mixer, int subscribe)
     return 0;
 }
 
+/** Subscribes for the mixer events.
+ * While controls are subscribed with @ref mixer_ctl_subscribe_events,
+ * the control devices stay subscribed and unsubscribing only takes
+ * effect once the last of them is unsubscribed.
+ * @param mixer A mixer handle.
+ * @param subscribe value indicating subscribe or unsubscribe for events
+ * @returns On success, zero.
+ *  On failure, non-zero.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_subscribe_events(struct mixer *mixer, int subscribe)
+{
+    int ret = 0;
+
+    if (!mixer) {
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&mixer->lock);
+    if (!mixer->num_event_ctls)
+        ret = mixer_grp_subscribe_events(mixer, subscribe);
+    if (ret == 0)
+        mixer->events_subscribed = subscribe != 0;
+    pthread_mutex_unlock(&mixer->lock);
+    return ret;
+}
+
+/** Subscribes for the events of a single control.
+ * Once a control is subscribed this way, the events of the mixer are
+ * filtered: the events of the other controls are dropped by the library,
+ * so that @ref mixer_wait_event does not return for them. The driver has
+ * no per control subscription, so they are still read from it.
+ * Filtering stops when the last such control is unsubscribed. Events
+ * that passed the filter before remain to be read. The subscription made
+ * with @ref mixer_subscribe_events, if any, is kept.
+ * Events announcing added or removed controls always pass the filter.
+ * @param ctl An initialized control handle.
+ * @param subscribe Non-zero to subscribe, zero to unsubscribe.
+ * @returns On success, zero.
+ *  On failure, a negative errno value.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_ctl_subscribe_events(struct mixer_ctl *ctl, int subscribe)
+{
+    struct mixer *mixer;
+    int ret = 0;
+
+    if (!ctl)
+        return -EINVAL;
+
+    mixer = ctl->mixer;
+    pthread_mutex_lock(&mixer->lock);
+    if (!subscribe == !ctl->event_wanted)
+        goto exit;
+
+    if (subscribe) {
+        if (!mixer->event_queue) {
+            mixer->event_queue = calloc(MIXER_EVENT_QUEUE_SIZE, sizeof(*mixer->event_queue));
+            if (!mixer->event_queue) {
+                ret = -ENOMEM;
+                goto exit;
+            }
+        }
+        if (!mixer->num_event_ctls && !mixer->events_subscribed) {
+            ret = mixer_grp_subscribe_events(mixer, 1);
+            if (ret < 0)
+                goto exit;
+        }
+        mixer->num_event_ctls++;
+    } else if (--mixer->num_event_ctls == 0 && !mixer->events_subscribed) {
+        mixer_grp_subscribe_events(mixer, 0);
+    }
+
+    ctl->event_wanted = subscribe != 0;
+exit:
+    pthread_mutex_unlock(&mixer->lock);
+    return ret;
+}
+
+/** Subscribes for the events of the controls whose names match a pattern.
+ * See @ref mixer_ctl_subscribe_events and @ref mixer_find_ctls.
+ * @param mixer A mixer handle.
+ * @param pattern The pattern the names of the controls must match.
+ * @param mode How @p pattern is matched against the names.
+ * @param subscribe Non-zero to subscribe, zero to unsubscribe.
+ * @returns On success, the number of matching controls.
+ *  On failure, a negative errno value.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_subscribe_events_by_name(struct mixer *mixer, const char *pattern,
+                                   enum mixer_find_mode mode, int subscribe)
+{
+    struct mixer_ctl **ctls;
+    int n, count, ret = 0;
+
+    count = mixer_find_ctls(mixer, pattern, mode, NULL, 0);
+    if (count <= 0)
+        return count;
+
+    ctls = calloc(count, sizeof(*ctls));
+    if (!ctls)
+        return -ENOMEM;
+
+    count = mixer_find_ctls(mixer, pattern, mode, ctls, count);
+    for (n = 0; n < count && ret == 0; n++)
+        ret = mixer_ctl_subscribe_events(ctls[n], subscribe);
+
+    free(ctls);
+    return ret < 0 ? ret : count;
+}
+
+static bool mixer_event_is_wanted(struct mixer *mixer, struct mixer_ctl_group *grp,
+                                  const struct mixer_ctl_event *event)
+{
+    const struct mixer_ctl *ctl;
+
+    if (event->type != SNDRV_CTL_EVENT_ELEM ||
+            event->data.element.mask == SNDRV_CTL_EVENT_MASK_REMOVE ||
+            (event->data.element.mask & SNDRV_CTL_EVENT_MASK_ADD))
+        return true;
+
+    ctl = mixer_grp_get_ctl_by_numid(mixer, grp, event->data.element.id.numid);
+    return ctl && ctl->event_wanted;
+}
+
+static int mixer_grp_read_events(struct mixer *mixer, struct mixer_ctl_group *grp,
+                                 struct mixer_ctl_event *events, unsigned int count);
+
+/* Moves the pending events that pass the filter into the queue */
+static int mixer_fill_event_queue(struct mixer *mixer)
+{
+    struct mixer_ctl_group *grps[2] = { mixer->h_grp, mixer->v_grp };
+    struct mixer_ctl_event events[MIXER_EVENT_QUEUE_SIZE];
+    struct mixer_queued_event *queued;
+    unsigned int g, i, n;
+    int count;
+
+    for (g = 0; g < ARRAY_SIZE(grps); g++) {
+        do {
+            count = mixer_grp_read_events(mixer, grps[g], events,
+                                          MIXER_EVENT_QUEUE_SIZE - mixer->event_count);
+            if (count < 0)
+                return count;
+
+            for (n = 0; n < (unsigned int)count; n++) {
+                if (!mixer_event_is_wanted(mixer, grps[g], &events[n]))
+                    continue;
+
+                /* an event still queued for the control already reports the change */
+                for (i = 0; i < mixer->event_count; i++) {
+                    queued = &mixer->event_queue[(mixer->event_head + i) % MIXER_EVENT_QUEUE_SIZE];
+                    if (queued->grp == grps[g] &&
+                            !memcmp(&queued->event, &events[n], sizeof(events[n])))
+                        break;
+                }
+                if (i < mixer->event_count)
+                    continue;
+
+                queued = &mixer->event_queue[(mixer->event_head + mixer->event_count) %
+                                             MIXER_EVENT_QUEUE_SIZE];
+                queued->event = events[n];
+                queued->grp = grps[g];
+                mixer->event_count++;
+            }
+        } while (count > 0 && mixer->event_count < MIXER_EVENT_QUEUE_SIZE);
+    }
+
+    return mixer->event_count;
+}
+
+/* Takes up to count events from the queue */
+static int mixer_pop_events(struct mixer *mixer, struct mixer_ctl_event *events,
+                            struct mixer_ctl_group **grps, unsigned int count)
+{
+    unsigned int n;
+
+    for (n = 0; n < count && mixer->event_count; n++) {
+        events[n] = mixer->event_queue[mixer->event_head].event;
+        if (grps)
+            grps[n] = mixer->event_queue[mixer->event_head].grp;
+        mixer->event_head = (mixer->event_head + 1) % MIXER_EVENT_QUEUE_SIZE;
+        mixer->event_count--;
+    }
+
+    return n;
+}
+
+static int64_t mixer_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 /** Wait for mixer events.
  * @param mixer A mixer handle.
  * @param timeout timeout value
@@ -485,25 +1563,22 @@ int mixer_subscribe_events(struct mixer *mixer, int subscribe)
  */
 int mixer_wait_event(struct mixer *mixer, int timeout)
 {
-    struct pollfd *pfd;
+    /* one for the hardware controls, one for the plugin controls */
+    struct pollfd pfd[2];
     struct mixer_ctl_group *grp;
-    int count = 0, num_fds = 0, i, ret = 0;
+    int count = 0, i, ret = 0;
+    int64_t deadline = 0;
 
     if (!mixer) {
         return -EINVAL;
     }
 
-    if (mixer->fd >= 0)
-        num_fds++;
+    if (mixer->event_count)
+        return 1;
+    if (mixer->num_event_ctls && timeout > 0)
+        deadline = mixer_now_ms() + timeout;
 
-#ifdef TINYALSA_USES_PLUGINS
-    if (mixer->v_grp)
-        num_fds++;
-#endif
-
-    pfd = (struct pollfd *)calloc(num_fds, sizeof(struct pollfd));
-    if (!pfd)
-        return -ENOMEM;
+    memset(pfd, 0, sizeof(pfd));
 
     if (mixer->fd >= 0) {
         pfd[count].fd = mixer->fd;
@@ -551,89 +1626,317 @@ int mixer_wait_event(struct mixer *mixer, int timeout)
                 }
 #endif
                 ret = 1;
+                break;
+            }
+        }
+
+        if (ret && mixer->num_event_ctls) {
+            /* keep waiting if every event was filtered out */
+            ret = mixer_fill_event_queue(mixer);
+            if (ret < 0)
                 goto exit;
+            if (!ret) {
+                if (timeout > 0) {
+                    timeout = deadline - mixer_now_ms();
+                    if (timeout <= 0)
+                        goto exit;
+                }
+                continue;
             }
+            ret = 1;
         }
+        if (ret)
+            goto exit;
     }
 exit:
-    free(pfd);
     return ret;
 }
 
-/** Consume a mixer event.
- * If mixer_subscribe_events has been called,
- * mixer_wait_event will identify when a control value has changed.
- * This function will clear a single event from the mixer so that
- * further events can be alerted.
- *
- * @param mixer A mixer handle.
- * @returns 1 on success. 0, if no pending event. -errno on failure.
- * @ingroup libtinyalsa-mixer
- */
-int mixer_consume_event(struct mixer *mixer)
+/** Consume a mixer event.
+ * If mixer_subscribe_events has been called,
+ * mixer_wait_event will identify when a control value has changed.
+ * This function will clear a single event from the mixer so that
+ * further events can be alerted.
+ *
+ * @param mixer A mixer handle.
+ * @returns 1 on success. 0, if no pending event. -errno on failure.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_consume_event(struct mixer *mixer)
+{
+    struct mixer_ctl_event ev;
+    if (!mixer) {
+        return -EINVAL;
+    }
+
+    return mixer_read_event(mixer, &ev);
+}
+
+/** Read a mixer control event.
+ * Try to read an control event from mixer.
+ *
+ * @param mixer A mixer handle.
+ * @param event Output parameter. If there is an event read form the mixer, this function will fill
+ * the event data into it.
+ * @returns 1 on success. 0, if no pending event. -errno on failure.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_read_event(struct mixer *mixer, struct mixer_ctl_event *event)
+{
+    struct mixer_ctl_group *grp = NULL;
+    struct snd_ctl_event ev;
+    ssize_t bytes = 0;
+
+    if (!mixer || !event) {
+        return -EINVAL;
+    }
+
+    if (mixer->num_event_ctls) {
+        if (!mixer->event_count) {
+            int ret = mixer_fill_event_queue(mixer);
+            if (ret < 0)
+                return ret;
+        }
+        return mixer_pop_events(mixer, event, NULL, 1);
+    }
+
+    /* the events that passed the filter before it was removed come first */
+    if (mixer->event_count)
+        return mixer_pop_events(mixer, event, NULL, 1);
+
+    if (mixer->h_grp) {
+        if (mixer->h_grp->event_cnt > 0) {
+            grp = mixer->h_grp;
+        }
+    }
+#ifdef TINYALSA_USES_PLUGINS
+    if (mixer->v_grp) {
+        if (mixer->v_grp->event_cnt > 0) {
+            grp = mixer->v_grp;
+        }
+    }
+#endif
+    if (grp) {
+        grp->event_cnt--;
+        bytes = grp->ops->read_event(grp->data, &ev, sizeof(ev));
+
+        if (bytes < 0) {
+            return -errno;
+        }
+
+        if (bytes == sizeof(*event)) {
+            memcpy(event, &ev, sizeof(*event));
+            mixer_grp_apply_events(mixer, grp, event, 1);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Reads up to count pending events of a group, without blocking */
+static int mixer_grp_read_events(struct mixer *mixer, struct mixer_ctl_group *grp,
+                                 struct mixer_ctl_event *events, unsigned int count)
+{
+    struct pollfd pfd;
+    ssize_t bytes;
+
+    if (!grp || !count)
+        return 0;
+
+    /* the plugin group never blocks, but the control device does, and
+     * event_cnt counts wakeups whose events may have been read already
+     */
+    if (grp == mixer->h_grp) {
+        pfd.fd = mixer->fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 0) <= 0 || !(pfd.revents & POLLIN)) {
+            grp->event_cnt = 0;
+            return 0;
+        }
+    }
+
+    bytes = grp->ops->read_event(grp->data, (struct snd_ctl_event *)events,
+                                 count * sizeof(*events));
+    if (bytes < 0)
+        return -errno;
+
+    /* the events the last wait reported are drained with the batch */
+    grp->event_cnt = 0;
+    mixer_grp_apply_events(mixer, grp, events, bytes / sizeof(*events));
+    return bytes / sizeof(*events);
+}
+
+/** Reads all pending mixer control events, up to the size of a buffer.
+ * Unlike @ref mixer_read_event, the events of each control device are read
+ * with a single call and this function does not block, whether or not
+ * @ref mixer_wait_event has reported pending events.
+ *
+ * @param mixer A mixer handle.
+ * @param events Output parameter. Receives the events read from the mixer.
+ * @param count The number of events that @p events can hold.
+ * @returns The number of events read. -errno on failure.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_read_events(struct mixer *mixer, struct mixer_ctl_event *events,
+                      unsigned int count)
+{
+    int q_count, h_count = 0, v_count = 0;
+
+    if (!mixer || !events) {
+        return -EINVAL;
+    }
+
+    if (mixer->num_event_ctls) {
+        h_count = mixer_fill_event_queue(mixer);
+        if (h_count < 0)
+            return h_count;
+        return mixer_pop_events(mixer, events, NULL, count);
+    }
+
+    /* the events that passed the filter before it was removed come first */
+    q_count = mixer_pop_events(mixer, events, NULL, count);
+    events += q_count;
+    count -= q_count;
+
+    if (mixer->h_grp) {
+        h_count = mixer_grp_read_events(mixer, mixer->h_grp, events, count);
+        if (h_count < 0)
+            return h_count;
+    }
+
+#ifdef TINYALSA_USES_PLUGINS
+    if (mixer->v_grp) {
+        v_count = mixer_grp_read_events(mixer, mixer->v_grp, events + h_count,
+                                        count - h_count);
+        if (v_count < 0)
+            return v_count;
+    }
+#endif
+
+    return q_count + h_count + v_count;
+}
+
+/** Registers a function to be called by @ref mixer_dispatch_events
+ * for the events of a control.
+ * @param ctl An initialized control handle.
+ * @param callback The function to call, or NULL to unregister the current one.
+ * @param data Passed to the callback as is.
+ * @returns On success, zero. On failure, -EINVAL.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_ctl_set_event_callback(struct mixer_ctl *ctl,
+                                 mixer_ctl_event_callback callback, void *data)
+{
+    if (!ctl) {
+        return -EINVAL;
+    }
+
+    ctl->event_cb = callback;
+    ctl->event_data = data;
+    return 0;
+}
+
+static int mixer_grp_dispatch_events(struct mixer *mixer, struct mixer_ctl_group *grp)
+{
+    struct mixer_ctl_event events[32];
+    struct mixer_ctl *ctl;
+    int count, n, total = 0;
+
+    do {
+        count = mixer_grp_read_events(mixer, grp, events, ARRAY_SIZE(events));
+        if (count < 0)
+            return count;
+
+        for (n = 0; n < count; n++) {
+            if (events[n].type != SNDRV_CTL_EVENT_ELEM)
+                continue;
+
+            ctl = mixer_grp_get_ctl_by_numid(mixer, grp, events[n].data.element.id.numid);
+            if (ctl && ctl->event_cb)
+                ctl->event_cb(ctl, &events[n], ctl->event_data);
+        }
+
+        total += count;
+    } while (count == (int)ARRAY_SIZE(events));
+
+    return total;
+}
+
+/* Dispatches the queued events, each to the control of its numid */
+static int mixer_dispatch_queued_events(struct mixer *mixer)
+{
+    struct mixer_ctl_event event;
+    struct mixer_ctl_group *grp;
+    struct mixer_ctl *ctl;
+    int total = 0;
+
+    while (mixer_pop_events(mixer, &event, &grp, 1)) {
+        total++;
+        if (event.type != SNDRV_CTL_EVENT_ELEM)
+            continue;
+        ctl = mixer_grp_get_ctl_by_numid(mixer, grp, event.data.element.id.numid);
+        if (ctl && ctl->event_cb)
+            ctl->event_cb(ctl, &event, ctl->event_data);
+    }
+
+    return total;
+}
+
+/* Dispatches the events that pass the filter */
+static int mixer_dispatch_filtered_events(struct mixer *mixer)
 {
-    struct mixer_ctl_event ev;
-    if (!mixer) {
-        return -EINVAL;
-    }
+    int ret, total = 0;
 
-    return mixer_read_event(mixer, &ev);
+    for (;;) {
+        ret = mixer_fill_event_queue(mixer);
+        if (ret <= 0)
+            return ret < 0 ? ret : total;
+
+        total += mixer_dispatch_queued_events(mixer);
+    }
 }
 
-/** Read a mixer control event.
- * Try to read an control event from mixer.
+/** Reads all pending mixer control events and calls the callbacks
+ * registered with @ref mixer_ctl_set_event_callback for them.
+ * Events of controls without a callback are dropped.
+ * This function does not block.
  *
  * @param mixer A mixer handle.
- * @param event Output parameter. If there is an event read form the mixer, this function will fill
- * the event data into it.
- * @returns 1 on success. 0, if no pending event. -errno on failure.
+ * @returns The number of events read. -errno on failure.
  * @ingroup libtinyalsa-mixer
  */
-int mixer_read_event(struct mixer *mixer, struct mixer_ctl_event *event)
+int mixer_dispatch_events(struct mixer *mixer)
 {
-    struct mixer_ctl_group *grp = NULL;
-    struct snd_ctl_event ev;
-    ssize_t bytes = 0;
+    int q_count, h_count = 0, v_count = 0;
 
-    if (!mixer || !event) {
+    if (!mixer) {
         return -EINVAL;
     }
 
+    if (mixer->num_event_ctls) {
+        return mixer_dispatch_filtered_events(mixer);
+    }
+
+    /* the events that passed the filter before it was removed come first */
+    q_count = mixer_dispatch_queued_events(mixer);
+
     if (mixer->h_grp) {
-        if (mixer->h_grp->event_cnt > 0) {
-            grp = mixer->h_grp;
-        }
+        h_count = mixer_grp_dispatch_events(mixer, mixer->h_grp);
+        if (h_count < 0)
+            return h_count;
     }
+
 #ifdef TINYALSA_USES_PLUGINS
     if (mixer->v_grp) {
-        if (mixer->v_grp->event_cnt > 0) {
-            grp = mixer->v_grp;
-        }
+        v_count = mixer_grp_dispatch_events(mixer, mixer->v_grp);
+        if (v_count < 0)
+            return v_count;
     }
 #endif
-    if (grp) {
-        grp->event_cnt--;
-        bytes = grp->ops->read_event(grp->data, &ev, sizeof(ev));
-
-        if (bytes < 0) {
-            return -errno;
-        }
-
-        if (bytes == sizeof(*event)) {
-            memcpy(event, &ev, sizeof(*event));
-            return 1;
-        }
-    }
-
-    return 0;
-}
 
-static unsigned int mixer_grp_get_count(struct mixer_ctl_group *grp)
-{
-    if (!grp)
-        return 0;
-
-    return grp->count;
+    return q_count + h_count + v_count;
 }
 
 /** Gets a mixer control handle, by the mixer control's id.
@@ -645,24 +1948,7 @@ static unsigned int mixer_grp_get_count(struct mixer_ctl_group *grp)
  */
 const struct mixer_ctl *mixer_get_ctl_const(const struct mixer *mixer, unsigned int id)
 {
-    unsigned int h_count;
-
-    if (!mixer || (id >= mixer->total_count))
-        return NULL;
-
-    h_count = mixer_grp_get_count(mixer->h_grp);
-
-    if (id < h_count)
-        return mixer->h_grp->ctl + id;
-#ifdef TINYALSA_USES_PLUGINS
-    else {
-        unsigned int v_count = mixer_grp_get_count(mixer->v_grp);
-	    if ((id - h_count) < v_count)
-            return mixer->v_grp->ctl + (id - h_count);
-    }
-#endif
-
-    return NULL;
+    return mixer_get_ctl((struct mixer *)mixer, id);
 }
 
 /** Gets a mixer control handle, by the mixer control's id.
@@ -674,23 +1960,28 @@ const struct mixer_ctl *mixer_get_ctl_const(const struct mixer *mixer, unsigned
  */
 struct mixer_ctl *mixer_get_ctl(struct mixer *mixer, unsigned int id)
 {
+    struct mixer_ctl **ctl, *found = NULL;
     unsigned int h_count;
 
-    if (!mixer || (id >= mixer->total_count))
+    if (!mixer)
         return NULL;
 
-    h_count = mixer_grp_get_count(mixer->h_grp);
+    mixer_read_begin(mixer);
+    ctl = mixer_grp_get_ctls(mixer->h_grp, &h_count);
 
     if (id < h_count)
-        return mixer->h_grp->ctl + id;
+        found = ctl[id];
 #ifdef TINYALSA_USES_PLUGINS
     else {
-        unsigned int v_count = mixer_grp_get_count(mixer->v_grp);
-	    if ((id - h_count) < v_count)
-            return mixer->v_grp->ctl + (id - h_count);
+        unsigned int v_count;
+        ctl = mixer_grp_get_ctls(mixer->v_grp, &v_count);
+        if ((id - h_count) < v_count)
+            found = ctl[id - h_count];
     }
 #endif
-    return NULL;
+    mixer_read_end(mixer);
+
+    return found;
 }
 
 /** Gets the first instance of mixer control handle, by the mixer control's name.
@@ -720,22 +2011,25 @@ struct mixer_ctl *mixer_get_ctl_by_name_and_index(struct mixer *mixer,
                                                   const char *name,
                                                   unsigned int index)
 {
-    struct mixer_ctl_group *grp;
-    unsigned int n;
-    struct mixer_ctl *ctl;
+    unsigned int n, num_ctls;
+    const struct mixer_ctl_index *ctls;
+    struct mixer_ctl *found = NULL;
+    uint32_t hash;
 
     if (!mixer || !name) {
         return NULL;
     }
 
+    hash = fnv_hash(name);
+    mixer_read_begin(mixer);
+
     if (mixer->h_grp) {
-        grp = mixer->h_grp;
-        ctl = grp->ctl;
+        ctls = mixer_grp_get_index(mixer->h_grp, &num_ctls);
 
-        for (n = 0; n < grp->count; n++)
-            if (!strcmp(name, (char*) ctl[n].info.id.name)) {
+        for (n = 0; n < num_ctls && !found; n++)
+            if (mixer_ctl_index_match(ctls, n, hash, name)) {
                 if (index == 0) {
-                    return ctl + n;
+                    found = ctls->ctl[n];
                 } else {
                     index--;
                 }
@@ -744,20 +2038,20 @@ struct mixer_ctl *mixer_get_ctl_by_name_and_index(struct mixer *mixer,
 
 #ifdef TINYALSA_USES_PLUGINS
     if (mixer->v_grp) {
-        grp = mixer->v_grp;
-        ctl = grp->ctl;
+        ctls = mixer_grp_get_index(mixer->v_grp, &num_ctls);
 
-        for (n = 0; n < grp->count; n++)
-            if (!strcmp(name, (char*) ctl[n].info.id.name)) {
+        for (n = 0; n < num_ctls && !found; n++)
+            if (mixer_ctl_index_match(ctls, n, hash, name)) {
                 if (index == 0) {
-                    return ctl + n;
+                    found = ctls->ctl[n];
                 } else {
                     index--;
                 }
             }
     }
 #endif
-    return NULL;
+    mixer_read_end(mixer);
+    return found;
 }
 
 /** Gets an instance of mixer control handle, by the mixer control's name and device.
@@ -773,40 +2067,190 @@ struct mixer_ctl *mixer_get_ctl_by_name_and_device(struct mixer *mixer,
                                                    const char *name,
                                                    unsigned int device)
 {
-    struct mixer_ctl_group *grp;
-    unsigned int n;
-    struct mixer_ctl *ctl;
+    unsigned int n, num_ctls;
+    const struct mixer_ctl_index *index;
+    struct mixer_ctl *found = NULL;
+    uint32_t hash;
 
     if (!mixer || !name) {
         return NULL;
     }
 
+    hash = fnv_hash(name);
+    mixer_read_begin(mixer);
+
     if (mixer->h_grp) {
-        grp = mixer->h_grp;
-        ctl = grp->ctl;
+        index = mixer_grp_get_index(mixer->h_grp, &num_ctls);
 
-        for (n = 0; n < grp->count; n++) {
-            if (!strcmp(name, (char*) ctl[n].info.id.name) &&
-                    device == ctl[n].info.id.device) {
-                return ctl + n;
+        for (n = 0; n < num_ctls && !found; n++) {
+            if (mixer_ctl_index_match(index, n, hash, name) &&
+                    device == index->ctl[n]->device) {
+                found = index->ctl[n];
             }
         }
     }
 
 #ifdef TINYALSA_USES_PLUGINS
     if (mixer->v_grp) {
-        grp = mixer->v_grp;
-        ctl = grp->ctl;
+        index = mixer_grp_get_index(mixer->v_grp, &num_ctls);
 
-        for (n = 0; n < grp->count; n++) {
-            if (!strcmp(name, (char*) ctl[n].info.id.name) &&
-                    device == ctl[n].info.id.device) {
-                return ctl + n;
+        for (n = 0; n < num_ctls && !found; n++) {
+            if (mixer_ctl_index_match(index, n, hash, name) &&
+                    device == index->ctl[n]->device) {
+                found = index->ctl[n];
             }
         }
     }
 #endif
-    return NULL;
+    mixer_read_end(mixer);
+    return found;
+}
+
+static int mixer_name_index_compare(const void *a, const void *b)
+{
+    const struct mixer_ctl *ctl_a = *(struct mixer_ctl *const *)a;
+    const struct mixer_ctl *ctl_b = *(struct mixer_ctl *const *)b;
+    int ret;
+
+    ret = strcmp(ctl_a->name, ctl_b->name);
+    if (ret)
+        return ret;
+
+    /* keep the order of mixer_get_ctl() among controls of the same name */
+    if (ctl_a->grp != ctl_b->grp)
+        return ctl_a->grp == ctl_a->mixer->h_grp ? -1 : 1;
+
+    return ctl_a->info.numid < ctl_b->info.numid ? -1 : ctl_a->info.numid > ctl_b->info.numid;
+}
+
+/* Gets the name index, building it if controls were added or removed since */
+static struct mixer_name_index *mixer_get_name_index(struct mixer *mixer)
+{
+    struct mixer_name_index *index, *old;
+    unsigned int n, count, generation;
+
+    generation = __atomic_load_n(&mixer->generation, __ATOMIC_ACQUIRE);
+    index = __atomic_load_n(&mixer->name_index, __ATOMIC_ACQUIRE);
+    if (index && index->generation == generation)
+        return index;
+
+    pthread_mutex_lock(&mixer->lock);
+    index = mixer->name_index;
+    if (!index || index->generation != mixer->generation) {
+        count = mixer_get_num_ctls(mixer);
+        index = malloc(sizeof(*index) + count * sizeof(index->ctl[0]));
+        if (index) {
+            index->generation = mixer->generation;
+            index->count = count;
+            for (n = 0; n < count; n++)
+                index->ctl[n] = mixer_get_ctl(mixer, n);
+            qsort(index->ctl, count, sizeof(index->ctl[0]), mixer_name_index_compare);
+
+            old = mixer->name_index;
+            __atomic_store_n(&mixer->name_index, index, __ATOMIC_RELEASE);
+            mixer_reclaim(mixer, old);
+        }
+    }
+    pthread_mutex_unlock(&mixer->lock);
+
+    return index;
+}
+
+/* Finds the first control whose name is not before the prefix */
+static unsigned int mixer_name_index_lower_bound(const struct mixer_name_index *index,
+                                                 const char *prefix)
+{
+    unsigned int low = 0, high = index->count, mid;
+
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (strcmp(index->ctl[mid]->name, prefix) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+/** Finds the controls whose name matches a pattern.
+ * The controls are searched through an index sorted by name, which is
+ * built on the first search and again once controls are added or removed. Prefixes,
+ * and the literal start of glob patterns, are looked up by binary search,
+ * so only the controls sharing that start are compared.
+ * @param mixer An initialized mixer handle.
+ * @param pattern The prefix, glob pattern or regular expression to match.
+ * @param mode How @p pattern is matched against the names.
+ * @param ctls Receives the matching controls, sorted by name.
+ *  Controls of the same name are in the order of mixer_get_ctl().
+ * @param size The number of controls that @p ctls can hold.
+ * @returns The number of matching controls, which may exceed @p size.
+ *  If @p pattern is not a valid regular expression, -EINVAL.
+ *  On other failures, a negative errno value.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_find_ctls(struct mixer *mixer, const char *pattern, enum mixer_find_mode mode,
+                    struct mixer_ctl **ctls, unsigned int size)
+{
+    struct mixer_name_index *index;
+    char prefix[sizeof(((struct snd_ctl_elem_id *)0)->name)];
+    unsigned int n, count = 0;
+    size_t len = 0;
+    regex_t regex;
+    bool match;
+
+    if (!mixer || !pattern || (size && !ctls))
+        return -EINVAL;
+
+    if (mode == MIXER_FIND_PREFIX)
+        len = strlen(pattern);
+    else if (mode == MIXER_FIND_GLOB)
+        len = strcspn(pattern, "*?[\\");
+    else if (mode != MIXER_FIND_REGEX)
+        return -EINVAL;
+
+    /* no name is as long as the prefix */
+    if (len >= sizeof(prefix))
+        return 0;
+    memcpy(prefix, pattern, len);
+    prefix[len] = '\0';
+
+    if (mode == MIXER_FIND_REGEX &&
+            regcomp(&regex, pattern, REG_EXTENDED | REG_NOSUB) != 0)
+        return -EINVAL;
+
+    mixer_read_begin(mixer);
+    index = mixer_get_name_index(mixer);
+    if (!index) {
+        mixer_read_end(mixer);
+        if (mode == MIXER_FIND_REGEX)
+            regfree(&regex);
+        return -ENOMEM;
+    }
+
+    for (n = mixer_name_index_lower_bound(index, prefix); n < index->count; n++) {
+        if (strncmp(index->ctl[n]->name, prefix, len))
+            break;
+
+        if (mode == MIXER_FIND_PREFIX)
+            match = true;
+        else if (mode == MIXER_FIND_GLOB)
+            match = fnmatch(pattern, index->ctl[n]->name, 0) == 0;
+        else
+            match = regexec(&regex, index->ctl[n]->name, 0, NULL, 0) == 0;
+
+        if (match) {
+            if (count < size)
+                ctls[count] = index->ctl[n];
+            count++;
+        }
+    }
+    mixer_read_end(mixer);
+
+    if (mode == MIXER_FIND_REGEX)
+        regfree(&regex);
+
+    return count;
 }
 
 /** Updates the control's info.
@@ -817,12 +2261,27 @@ struct mixer_ctl *mixer_get_ctl_by_name_and_device(struct mixer *mixer,
 void mixer_ctl_update(struct mixer_ctl *ctl)
 {
     struct mixer_ctl_group *grp;
+    struct snd_ctl_elem_info elem;
+    struct mixer_ctl_info info;
 
     if (!ctl)
         return;
 
     grp  = ctl->grp;
-    grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_ELEM_INFO, &ctl->info);
+    memset(&elem, 0, sizeof(elem));
+
+    pthread_mutex_lock(&ctl->mixer->lock);
+    /* the numid of a removed control may already be another control's */
+    if (!ctl->info.removed) {
+        elem.id.numid = ctl->info.numid;
+        if (grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_ELEM_INFO, &elem) == 0)
+            mixer_ctl_info_from_elem(&info, &elem);
+        else
+            info = ctl->info;
+
+        mixer_ctl_replace_info(ctl, &info);
+    }
+    pthread_mutex_unlock(&ctl->mixer->lock);
 }
 
 /** Checks the control for TLV Read/Write access.
@@ -833,11 +2292,14 @@ void mixer_ctl_update(struct mixer_ctl *ctl)
  */
 int mixer_ctl_is_access_tlv_rw(const struct mixer_ctl *ctl)
 {
+    struct mixer_ctl_info info;
+
     if (!ctl) {
         return 0;
     }
 
-    return (ctl->info.access & SNDRV_CTL_ELEM_ACCESS_TLV_READWRITE);
+    mixer_ctl_get_info(ctl, &info);
+    return (info.access & SNDRV_CTL_ELEM_ACCESS_TLV_READWRITE);
 }
 
 /** Gets the control's ID.
@@ -854,7 +2316,7 @@ unsigned int mixer_ctl_get_id(const struct mixer_ctl *ctl)
     /* numid values start at 1, return a 0-base value that
      * can be passed to mixer_get_ctl()
      */
-    return ctl->info.id.numid - 1;
+    return mixer_ctl_numid(ctl) - 1;
 }
 
 /** Gets the name of the control.
@@ -868,7 +2330,7 @@ const char *mixer_ctl_get_name(const struct mixer_ctl *ctl)
     if (!ctl)
         return NULL;
 
-    return (const char *)ctl->info.id.name;
+    return ctl->name;
 }
 
 unsigned int mixer_ctl_get_device(const struct mixer_ctl *ctl)
@@ -876,7 +2338,7 @@ unsigned int mixer_ctl_get_device(const struct mixer_ctl *ctl)
     if (!ctl)
         return UINT_MAX;
 
-    return ctl->info.id.device;
+    return ctl->device;
 }
 
 /** Gets the value type of the control.
@@ -887,10 +2349,13 @@ unsigned int mixer_ctl_get_device(const struct mixer_ctl *ctl)
  */
 enum mixer_ctl_type mixer_ctl_get_type(const struct mixer_ctl *ctl)
 {
+    struct mixer_ctl_info info;
+
     if (!ctl)
         return MIXER_CTL_TYPE_UNKNOWN;
 
-    switch (ctl->info.type) {
+    mixer_ctl_get_info(ctl, &info);
+    switch (info.type) {
     case SNDRV_CTL_ELEM_TYPE_BOOLEAN:    return MIXER_CTL_TYPE_BOOL;
     case SNDRV_CTL_ELEM_TYPE_INTEGER:    return MIXER_CTL_TYPE_INT;
     case SNDRV_CTL_ELEM_TYPE_ENUMERATED: return MIXER_CTL_TYPE_ENUM;
@@ -908,10 +2373,13 @@ enum mixer_ctl_type mixer_ctl_get_type(const struct mixer_ctl *ctl)
  */
 const char *mixer_ctl_get_type_string(const struct mixer_ctl *ctl)
 {
+    struct mixer_ctl_info info;
+
     if (!ctl)
         return "";
 
-    switch (ctl->info.type) {
+    mixer_ctl_get_info(ctl, &info);
+    switch (info.type) {
     case SNDRV_CTL_ELEM_TYPE_BOOLEAN:    return "BOOL";
     case SNDRV_CTL_ELEM_TYPE_INTEGER:    return "INT";
     case SNDRV_CTL_ELEM_TYPE_ENUMERATED: return "ENUM";
@@ -929,88 +2397,449 @@ const char *mixer_ctl_get_type_string(const struct mixer_ctl *ctl)
  */
 unsigned int mixer_ctl_get_num_values(const struct mixer_ctl *ctl)
 {
+    struct mixer_ctl_info info;
+
+    if (!ctl)
+        return 0;
+
+    mixer_ctl_get_info(ctl, &info);
+    return info.count;
+}
+
+static int percent_to_int(const struct mixer_ctl_info *info, int percent)
+{
+    if ((percent > 100) || (percent < 0)) {
+        return -EINVAL;
+    }
+
+    int range = (info->max - info->min);
+
+    return info->min + (range * percent) / 100;
+}
+
+static int int_to_percent(const struct mixer_ctl_info *info, int value)
+{
+    int range = (info->max - info->min);
+
+    if (range == 0)
+        return 0;
+
+    return ((value - info->min) * 100) / range;
+}
+
+/** Gets a percentage representation of a specified control value.
+ * @param ctl An initialized control handle.
+ * @param id The index of the value within the control.
+ * @returns On success, the percentage representation of the control value.
+ *  If the driver removed the control, -ENODEV.
+ *  On other failures, -EINVAL is returned.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_ctl_get_percent(const struct mixer_ctl *ctl, unsigned int id)
+{
+    struct mixer_ctl_info info;
+
+    if (!ctl)
+        return -EINVAL;
+
+    mixer_ctl_get_info(ctl, &info);
+    if (info.type != SNDRV_CTL_ELEM_TYPE_INTEGER)
+        return -EINVAL;
+
+    if (info.removed)
+        return -ENODEV;
+
+    return int_to_percent(&info, mixer_ctl_get_value(ctl, id));
+}
+
+/** Sets the value of a control by percent, specified by the value index.
+ * @param ctl An initialized control handle.
+ * @param id The index of the value to set
+ * @param percent A percentage value between 0 and 100.
+ * @returns On success, zero is returned.
+ *  On failure, non-zero is returned.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_ctl_set_percent(struct mixer_ctl *ctl, unsigned int id, int percent)
+{
+    struct mixer_ctl_info info;
+
     if (!ctl)
+        return -EINVAL;
+
+    mixer_ctl_get_info(ctl, &info);
+    if (info.type != SNDRV_CTL_ELEM_TYPE_INTEGER)
+        return -EINVAL;
+
+    return mixer_ctl_set_value(ctl, id, percent_to_int(&info, percent));
+}
+
+/* Appends the dB segments described by a TLV, for control values from min to max */
+static int mixer_db_parse(const unsigned int *tlv, size_t size, long min, long max,
+                          struct mixer_db_segment *segments, unsigned int *count)
+{
+    size_t len, pos, sub_len;
+    unsigned int n;
+
+    if (size < 2)
+        return -EINVAL;
+
+    len = tlv[1] / sizeof(*tlv);
+    if (len > size - 2)
+        return -EINVAL;
+
+    switch (tlv[0]) {
+    case MIXER_TLVT_CONTAINER:
+        /* use the first dB description of the container */
+        for (pos = 2; pos + 2 <= len + 2; pos += sub_len) {
+            sub_len = tlv[pos + 1] / sizeof(*tlv) + 2;
+            if (mixer_db_parse(tlv + pos, len + 2 - pos, min, max, segments, count) == 0)
+                return 0;
+        }
+        return -EINVAL;
+
+    case MIXER_TLVT_DB_RANGE:
+        /* (min, max, dB description) triplets */
+        n = *count;
+        for (pos = 2; pos + 4 <= len + 2; pos += sub_len + 2) {
+            sub_len = tlv[pos + 3] / sizeof(*tlv) + 2;
+            if (mixer_db_parse(tlv + pos + 2, len - pos, (int)tlv[pos], (int)tlv[pos + 1],
+                               segments, count) < 0)
+                return -EINVAL;
+        }
+        return *count > n ? 0 : -EINVAL;
+
+    case MIXER_TLVT_DB_SCALE:
+    case MIXER_TLVT_DB_LINEAR:
+    case MIXER_TLVT_DB_MINMAX:
+    case MIXER_TLVT_DB_MINMAX_MUTE:
+        if (len < 2 || *count >= MIXER_DB_MAX_SEGMENTS)
+            return -EINVAL;
+        segments[*count].min = min;
+        segments[*count].max = max;
+        segments[*count].type = tlv[0];
+        segments[*count].param[0] = (int)tlv[2];
+        segments[*count].param[1] = (int)tlv[3];
+        (*count)++;
+        return 0;
+
+    default:
+        return -EINVAL;
+    }
+}
+
+/* Converts a control value to 0.01 dB, the way alsa-lib does */
+static int mixer_db_from_value(const struct mixer_ctl_db *db, long value)
+{
+    const struct mixer_db_segment *seg = &db->segments[0];
+    unsigned int n;
+    double ratio, lmin, lmax;
+    int step;
+
+    for (n = 0; n < db->num_segments; n++) {
+        seg = &db->segments[n];
+        if (value <= seg->max)
+            break;
+    }
+
+    if (value < seg->min)
+        value = seg->min;
+    if (value > seg->max)
+        value = seg->max;
+
+    switch (seg->type) {
+    case MIXER_TLVT_DB_SCALE:
+        step = seg->param[1] & 0xffff;
+        if ((seg->param[1] & 0x10000) && value == seg->min)
+            return MIXER_CTL_DB_MUTE;
+        return seg->param[0] + step * (value - seg->min);
+
+    case MIXER_TLVT_DB_MINMAX:
+    case MIXER_TLVT_DB_MINMAX_MUTE:
+        if (seg->type == MIXER_TLVT_DB_MINMAX_MUTE && value == seg->min)
+            return MIXER_CTL_DB_MUTE;
+        if (seg->max <= seg->min)
+            return seg->param[1];
+        return seg->param[0] + (long long)(seg->param[1] - seg->param[0]) *
+                (value - seg->min) / (seg->max - seg->min);
+
+    default: /* MIXER_TLVT_DB_LINEAR */
+        if (value <= seg->min || seg->max <= seg->min)
+            return seg->param[0];
+        if (value >= seg->max)
+            return seg->param[1];
+        ratio = (double)(value - seg->min) / (seg->max - seg->min);
+        if (seg->param[0] <= MIXER_CTL_DB_MUTE)
+            return (int)(2000.0 * log10(ratio)) + seg->param[1];
+        lmin = pow(10.0, seg->param[0] / 2000.0);
+        lmax = pow(10.0, seg->param[1] / 2000.0);
+        return (int)(2000.0 * log10((lmax - lmin) * ratio + lmin));
+    }
+}
+
+static int mixer_ctl_db_lookup(const struct mixer_ctl_db *db, long value)
+{
+    if (!db->table)
+        return mixer_db_from_value(db, value);
+
+    if (value < db->min)
+        value = db->min;
+    if (value > db->max)
+        value = db->max;
+
+    return db->table[value - db->min];
+}
+
+/* Reads and parses the dB description of a control */
+static int mixer_ctl_read_db(const struct mixer_ctl *ctl, struct mixer_db_segment *segments,
+                             unsigned int *count)
+{
+    struct mixer_ctl_group *grp = ctl->grp;
+    struct snd_ctl_tlv *tlv;
+    int ret;
+
+    /* TLV bytes controls carry a payload, not a dB description */
+    if (!(ctl->info.access & SNDRV_CTL_ELEM_ACCESS_TLV_READ) ||
+            (ctl->info.access & SNDRV_CTL_ELEM_ACCESS_TLV_READWRITE) ==
+                    SNDRV_CTL_ELEM_ACCESS_TLV_READWRITE)
+        return -ENOENT;
+
+    tlv = calloc(1, sizeof(*tlv) + MIXER_TLV_MAX_SIZE);
+    if (!tlv)
+        return -ENOMEM;
+
+    *count = 0;
+    tlv->numid = ctl->info.numid;
+    tlv->length = MIXER_TLV_MAX_SIZE;
+    ret = grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_TLV_READ, tlv);
+    if (ret < 0 || mixer_db_parse(tlv->tlv, MIXER_TLV_MAX_SIZE / sizeof(tlv->tlv[0]),
+                                  ctl->info.min,
+                                  ctl->info.max, segments, count) < 0)
+        ret = -ENOENT;
+    free(tlv);
+
+    return ret < 0 ? ret : 0;
+}
+
+/* Checks whether the parsed dB description of a control still matches the driver's */
+static bool mixer_ctl_db_is_current(const struct mixer_ctl *ctl, const struct mixer_ctl_db *db)
+{
+    struct mixer_db_segment segments[MIXER_DB_MAX_SEGMENTS];
+    unsigned int n, count;
+
+    if (db->min != ctl->info.min || db->max != ctl->info.max ||
+            mixer_ctl_read_db(ctl, segments, &count) < 0 || count != db->num_segments)
+        return false;
+
+    for (n = 0; n < count; n++) {
+        if (segments[n].min != db->segments[n].min ||
+                segments[n].max != db->segments[n].max ||
+                segments[n].type != db->segments[n].type ||
+                segments[n].param[0] != db->segments[n].param[0] ||
+                segments[n].param[1] != db->segments[n].param[1])
+            return false;
+    }
+
+    return true;
+}
+
+static int mixer_ctl_load_db(struct mixer_ctl *ctl)
+{
+    struct mixer_db_segment segments[MIXER_DB_MAX_SEGMENTS];
+    struct mixer_ctl_db *db;
+    unsigned int count = 0;
+    long value, range;
+    int ret;
+
+    ret = mixer_ctl_read_db(ctl, segments, &count);
+    if (ret < 0)
+        return ret;
+
+    db = calloc(1, sizeof(*db) + count * sizeof(db->segments[0]));
+    if (!db)
+        return -ENOMEM;
+
+    db->min = ctl->info.min;
+    db->max = ctl->info.max;
+    db->num_segments = count;
+    memcpy(db->segments, segments, count * sizeof(segments[0]));
+
+    range = db->max - db->min;
+    if (range >= 0 && range < MIXER_DB_MAX_TABLE_SIZE) {
+        db->table = malloc((range + 1) * sizeof(*db->table));
+        for (value = db->min; db->table && value <= db->max; value++)
+            db->table[value - db->min] = mixer_db_from_value(db, value);
+    }
+
+    __atomic_store_n(&ctl->db, db, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static int mixer_ctl_fill_db(struct mixer_ctl *ctl, struct mixer_ctl_db **db)
+{
+    int ret = 0;
+
+    *db = __atomic_load_n(&ctl->db, __ATOMIC_ACQUIRE);
+    if (*db)
         return 0;
 
-    return ctl->info.count;
+    pthread_mutex_lock(&ctl->mixer->lock);
+    if (!ctl->db)
+        ret = mixer_ctl_load_db(ctl);
+    *db = ctl->db;
+    pthread_mutex_unlock(&ctl->mixer->lock);
+
+    return ret;
 }
 
-static int percent_to_int(const struct snd_ctl_elem_info *ei, int percent)
+/** Gets the gain of a control value, in hundredths of a dB.
+ * The gain is derived from the TLV dB description of the control,
+ * which is read and parsed once.
+ * @param ctl An initialized integer control handle.
+ * @param id The index of the value within the control.
+ * @param db Receives the gain, or @ref MIXER_CTL_DB_MUTE if the value mutes.
+ * @returns On success, zero.
+ *  If the control has no dB description, -ENOENT.
+ *  On other failures, a negative errno value.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_ctl_get_db(struct mixer_ctl *ctl, unsigned int id, int *db)
 {
-    if ((percent > 100) || (percent < 0)) {
+    struct mixer_ctl_group *grp;
+    struct mixer_ctl_db *scale;
+    struct mixer_ctl_info info;
+    struct snd_ctl_elem_value ev;
+    int ret;
+
+    if (!ctl || !db)
         return -EINVAL;
-    }
 
-    int range = (ei->value.integer.max - ei->value.integer.min);
+    mixer_ctl_get_info(ctl, &info);
+    if (id >= info.count || info.type != SNDRV_CTL_ELEM_TYPE_INTEGER)
+        return -EINVAL;
 
-    return ei->value.integer.min + (range * percent) / 100;
-}
+    if (info.removed)
+        return -ENODEV;
 
-static int int_to_percent(const struct snd_ctl_elem_info *ei, int value)
-{
-    int range = (ei->value.integer.max - ei->value.integer.min);
+    ret = mixer_ctl_fill_db(ctl, &scale);
+    if (ret < 0)
+        return ret;
 
-    if (range == 0)
-        return 0;
+    grp = ctl->grp;
+    memset(&ev, 0, sizeof(ev));
+    ev.id.numid = info.numid;
+    ret = grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_ELEM_READ, &ev);
+    if (ret < 0)
+        return ret;
 
-    return ((value - ei->value.integer.min) * 100) / range;
+    *db = mixer_ctl_db_lookup(scale, ev.value.integer.value[id]);
+    return 0;
 }
 
-/** Gets a percentage representation of a specified control value.
- * @param ctl An initialized control handle.
- * @param id The index of the value within the control.
- * @returns On success, the percentage representation of the control value.
- *  On failure, -EINVAL is returned.
+/** Gets the gain range of a control, in hundredths of a dB.
+ * @param ctl An initialized integer control handle.
+ * @param min_db Receives the gain of the smallest value of the control,
+ *  or @ref MIXER_CTL_DB_MUTE if it mutes.
+ * @param max_db Receives the gain of the largest value of the control.
+ * @returns On success, zero.
+ *  If the control has no dB description, -ENOENT.
+ *  On other failures, a negative errno value.
  * @ingroup libtinyalsa-mixer
  */
-int mixer_ctl_get_percent(const struct mixer_ctl *ctl, unsigned int id)
+int mixer_ctl_get_db_range(struct mixer_ctl *ctl, int *min_db, int *max_db)
 {
-    if (!ctl || (ctl->info.type != SNDRV_CTL_ELEM_TYPE_INTEGER))
+    struct mixer_ctl_db *scale;
+    int ret;
+
+    if (!ctl || !min_db || !max_db ||
+            mixer_ctl_get_type(ctl) != MIXER_CTL_TYPE_INT)
         return -EINVAL;
 
-    return int_to_percent(&ctl->info, mixer_ctl_get_value(ctl, id));
+    ret = mixer_ctl_fill_db(ctl, &scale);
+    if (ret < 0)
+        return ret;
+
+    *min_db = mixer_ctl_db_lookup(scale, scale->min);
+    *max_db = mixer_ctl_db_lookup(scale, scale->max);
+    return 0;
 }
 
-/** Sets the value of a control by percent, specified by the value index.
- * @param ctl An initialized control handle.
- * @param id The index of the value to set
- * @param percent A percentage value between 0 and 100.
- * @returns On success, zero is returned.
- *  On failure, non-zero is returned.
+/** Sets the gain of a control value, in hundredths of a dB.
+ * The control is set to the largest value whose gain does not exceed
+ * @p db, or to its smallest value if every gain does.
+ * @param ctl An initialized integer control handle.
+ * @param id The index of the value within the control.
+ * @param db The gain to set. @ref MIXER_CTL_DB_MUTE selects the smallest value.
+ * @returns On success, zero.
+ *  If the control has no dB description, -ENOENT.
+ *  On other failures, a negative errno value.
  * @ingroup libtinyalsa-mixer
  */
-int mixer_ctl_set_percent(struct mixer_ctl *ctl, unsigned int id, int percent)
+int mixer_ctl_set_db(struct mixer_ctl *ctl, unsigned int id, int db)
 {
-    if (!ctl || (ctl->info.type != SNDRV_CTL_ELEM_TYPE_INTEGER))
+    struct mixer_ctl_db *scale;
+    struct mixer_ctl_info info;
+    long low, high, mid;
+    int ret;
+
+    if (!ctl)
+        return -EINVAL;
+
+    mixer_ctl_get_info(ctl, &info);
+    if (id >= info.count || info.type != SNDRV_CTL_ELEM_TYPE_INTEGER)
         return -EINVAL;
 
-    return mixer_ctl_set_value(ctl, id, percent_to_int(&ctl->info, percent));
+    ret = mixer_ctl_fill_db(ctl, &scale);
+    if (ret < 0)
+        return ret;
+
+    /* gains never decrease as the control value increases */
+    low = scale->min;
+    high = scale->max;
+    while (low < high) {
+        mid = low + (high - low + 1) / 2;
+        if (mixer_ctl_db_lookup(scale, mid) <= db)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+
+    return mixer_ctl_set_value(ctl, id, low);
 }
 
 /** Gets the value of a control.
  * @param ctl An initialized control handle.
  * @param id The index of the control value.
  * @returns On success, the specified value is returned.
- *  On failure, -EINVAL is returned.
+ *  If the driver removed the control, -ENODEV.
+ *  On other failures, -EINVAL is returned.
  * @ingroup libtinyalsa-mixer
  */
 int mixer_ctl_get_value(const struct mixer_ctl *ctl, unsigned int id)
 {
     struct mixer_ctl_group *grp;
+    struct mixer_ctl_info info;
     struct snd_ctl_elem_value ev;
     int ret;
 
-    if (!ctl || (id >= ctl->info.count))
+    if (!ctl)
+        return -EINVAL;
+
+    mixer_ctl_get_info(ctl, &info);
+    if (id >= info.count)
         return -EINVAL;
 
+    if (info.removed)
+        return -ENODEV;
+
     grp = ctl->grp;
     memset(&ev, 0, sizeof(ev));
-    ev.id.numid = ctl->info.id.numid;
+    ev.id.numid = info.numid;
     ret = grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_ELEM_READ, &ev);
     if (ret < 0)
         return ret;
 
-    switch (ctl->info.type) {
+    switch (info.type) {
     case SNDRV_CTL_ELEM_TYPE_BOOLEAN:
         return !!ev.value.integer.value[id];
 
@@ -1039,12 +2868,14 @@ int mixer_ctl_get_value(const struct mixer_ctl *ctl, unsigned int id)
  *  This parameter must match the number of items in the control.
  *  The number of items in the control may be accessed via @ref mixer_ctl_get_num_values
  * @returns On success, zero.
- *  On failure, non-zero.
+ *  If the driver removed the control, -ENODEV.
+ *  On other failures, non-zero.
  * @ingroup libtinyalsa-mixer
  */
 int mixer_ctl_get_array(const struct mixer_ctl *ctl, void *array, size_t count)
 {
     struct mixer_ctl_group *grp;
+    struct mixer_ctl_info info;
     struct snd_ctl_elem_value ev;
     int ret = 0;
     size_t size;
@@ -1056,13 +2887,17 @@ int mixer_ctl_get_array(const struct mixer_ctl *ctl, void *array, size_t count)
 
     grp = ctl->grp;
 
-    if (count > ctl->info.count)
+    mixer_ctl_get_info(ctl, &info);
+    if (count > info.count)
         return -EINVAL;
 
+    if (info.removed)
+        return -ENODEV;
+
     memset(&ev, 0, sizeof(ev));
-    ev.id.numid = ctl->info.id.numid;
+    ev.id.numid = info.numid;
 
-    switch (ctl->info.type) {
+    switch (info.type) {
     case SNDRV_CTL_ELEM_TYPE_BOOLEAN:
     case SNDRV_CTL_ELEM_TYPE_INTEGER:
         ret = grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_ELEM_READ, &ev);
@@ -1072,9 +2907,17 @@ int mixer_ctl_get_array(const struct mixer_ctl *ctl, void *array, size_t count)
         source = ev.value.integer.value;
         break;
 
+    case SNDRV_CTL_ELEM_TYPE_ENUMERATED:
+        ret = grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_ELEM_READ, &ev);
+        if (ret < 0)
+            return ret;
+        size = sizeof(ev.value.enumerated.item[0]);
+        source = ev.value.enumerated.item;
+        break;
+
     case SNDRV_CTL_ELEM_TYPE_BYTES:
         /* check if this is new bytes TLV */
-        if (mixer_ctl_is_access_tlv_rw(ctl)) {
+        if (info.access & SNDRV_CTL_ELEM_ACCESS_TLV_READWRITE) {
             struct snd_ctl_tlv *tlv;
             int ret;
 
@@ -1085,7 +2928,7 @@ int mixer_ctl_get_array(const struct mixer_ctl *ctl, void *array, size_t count)
             if (!tlv)
                 return -ENOMEM;
 
-            tlv->numid = ctl->info.id.numid;
+            tlv->numid = info.numid;
             tlv->length = count;
             ret = grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_TLV_READ, tlv);
 
@@ -1128,27 +2971,36 @@ int mixer_ctl_get_array(const struct mixer_ctl *ctl, void *array, size_t count)
  *  This must be in a range specified by @ref mixer_ctl_get_range_min
  *  and @ref mixer_ctl_get_range_max.
  * @returns On success, zero is returned.
- *  On failure, non-zero is returned.
+ *  If the driver removed the control, -ENODEV.
+ *  On other failures, non-zero is returned.
  * @ingroup libtinyalsa-mixer
  */
 int mixer_ctl_set_value(struct mixer_ctl *ctl, unsigned int id, int value)
 {
     struct mixer_ctl_group *grp;
+    struct mixer_ctl_info info;
     struct snd_ctl_elem_value ev;
     int ret;
 
-    if (!ctl || id >= ctl->info.count) {
+    if (!ctl) {
         return -EINVAL;
     }
 
+    mixer_ctl_get_info(ctl, &info);
+    if (id >= info.count)
+        return -EINVAL;
+
+    if (info.removed)
+        return -ENODEV;
+
     grp = ctl->grp;
     memset(&ev, 0, sizeof(ev));
-    ev.id.numid = ctl->info.id.numid;
+    ev.id.numid = info.numid;
     ret = grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_ELEM_READ, &ev);
     if (ret < 0)
         return ret;
 
-    switch (ctl->info.type) {
+    switch (info.type) {
     case SNDRV_CTL_ELEM_TYPE_BOOLEAN:
         ev.value.integer.value[id] = !!value;
         break;
@@ -1179,12 +3031,14 @@ int mixer_ctl_set_value(struct mixer_ctl *ctl, unsigned int id, int value)
  *  This must match the number of values in the control.
  *  The number of values in a control may be accessed via @ref mixer_ctl_get_num_values
  * @returns On success, zero.
- *  On failure, non-zero.
+ *  If the driver removed the control, -ENODEV.
+ *  On other failures, non-zero.
  * @ingroup libtinyalsa-mixer
  */
 int mixer_ctl_set_array(struct mixer_ctl *ctl, const void *array, size_t count)
 {
     struct mixer_ctl_group *grp;
+    struct mixer_ctl_info info;
     struct snd_ctl_elem_value ev;
     size_t size;
     void *dest;
@@ -1195,22 +3049,31 @@ int mixer_ctl_set_array(struct mixer_ctl *ctl, const void *array, size_t count)
 
     grp = ctl->grp;
 
-    if (count > ctl->info.count)
+    mixer_ctl_get_info(ctl, &info);
+    if (count > info.count)
         return -EINVAL;
 
+    if (info.removed)
+        return -ENODEV;
+
     memset(&ev, 0, sizeof(ev));
-    ev.id.numid = ctl->info.id.numid;
+    ev.id.numid = info.numid;
 
-    switch (ctl->info.type) {
+    switch (info.type) {
     case SNDRV_CTL_ELEM_TYPE_BOOLEAN:
     case SNDRV_CTL_ELEM_TYPE_INTEGER:
         size = sizeof(ev.value.integer.value[0]);
         dest = ev.value.integer.value;
         break;
 
+    case SNDRV_CTL_ELEM_TYPE_ENUMERATED:
+        size = sizeof(ev.value.enumerated.item[0]);
+        dest = ev.value.enumerated.item;
+        break;
+
     case SNDRV_CTL_ELEM_TYPE_BYTES:
         /* check if this is new bytes TLV */
-        if (mixer_ctl_is_access_tlv_rw(ctl)) {
+        if (info.access & SNDRV_CTL_ELEM_ACCESS_TLV_READWRITE) {
             struct snd_ctl_tlv *tlv;
             int ret = 0;
 
@@ -1221,7 +3084,7 @@ int mixer_ctl_set_array(struct mixer_ctl *ctl, const void *array, size_t count)
             if (!tlv)
                 return -ENOMEM;
 
-            tlv->numid = ctl->info.id.numid;
+            tlv->numid = info.numid;
             tlv->length = count;
             memcpy(tlv->tlv, array, count);
 
@@ -1259,11 +3122,18 @@ int mixer_ctl_set_array(struct mixer_ctl *ctl, const void *array, size_t count)
  */
 int mixer_ctl_get_range_min(const struct mixer_ctl *ctl)
 {
-    if (!ctl || ctl->info.type != SNDRV_CTL_ELEM_TYPE_INTEGER) {
+    struct mixer_ctl_info info;
+
+    if (!ctl) {
+        return -EINVAL;
+    }
+
+    mixer_ctl_get_info(ctl, &info);
+    if (info.type != SNDRV_CTL_ELEM_TYPE_INTEGER) {
         return -EINVAL;
     }
 
-    return ctl->info.value.integer.min;
+    return info.min;
 }
 
 /** Gets the maximum value of an control.
@@ -1276,11 +3146,18 @@ int mixer_ctl_get_range_min(const struct mixer_ctl *ctl)
  */
 int mixer_ctl_get_range_max(const struct mixer_ctl *ctl)
 {
-    if (!ctl || ctl->info.type != SNDRV_CTL_ELEM_TYPE_INTEGER) {
+    struct mixer_ctl_info info;
+
+    if (!ctl) {
+        return -EINVAL;
+    }
+
+    mixer_ctl_get_info(ctl, &info);
+    if (info.type != SNDRV_CTL_ELEM_TYPE_INTEGER) {
         return -EINVAL;
     }
 
-    return ctl->info.value.integer.max;
+    return info.max;
 }
 
 /** Get the number of enumerated items in the control.
@@ -1290,52 +3167,98 @@ int mixer_ctl_get_range_max(const struct mixer_ctl *ctl)
  */
 unsigned int mixer_ctl_get_num_enums(const struct mixer_ctl *ctl)
 {
+    struct mixer_ctl_info info;
+
     if (!ctl) {
         return 0;
     }
 
-    return ctl->info.value.enumerated.items;
+    mixer_ctl_get_info(ctl, &info);
+    return info.items;
 }
 
-static int mixer_ctl_fill_enum_string(struct mixer_ctl *ctl)
+/* Reads the enumerated item names, with the mixer locked */
+static int mixer_ctl_load_enums(struct mixer_ctl *ctl)
 {
     struct mixer_ctl_group *grp = ctl->grp;
+    struct mixer_ctl_enums *enums;
     struct snd_ctl_elem_info tmp;
-    unsigned int m;
-    char **enames;
+    unsigned int m, slot, table_size = 1;
+    unsigned int items = ctl->info.items;
+    size_t names_size = 0, len;
+    char (*names)[sizeof(tmp.value.enumerated.name)];
+    char *dest;
 
-    if (ctl->ename) {
-        return 0;
-    }
+    if (!items)
+        return -1;
 
-    enames = calloc(ctl->info.value.enumerated.items, sizeof(char*));
-    if (!enames)
-        goto fail;
-    for (m = 0; m < ctl->info.value.enumerated.items; m++) {
+    names = calloc(items, sizeof(*names));
+    if (!names)
+        return -1;
+
+    for (m = 0; m < items; m++) {
         memset(&tmp, 0, sizeof(tmp));
-        tmp.id.numid = ctl->info.id.numid;
+        tmp.id.numid = ctl->info.numid;
         tmp.value.enumerated.item = m;
         if (grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_ELEM_INFO, &tmp) < 0)
             goto fail;
-        enames[m] = strdup(tmp.value.enumerated.name);
-        if (!enames[m])
-            goto fail;
+        tmp.value.enumerated.name[sizeof(tmp.value.enumerated.name) - 1] = '\0';
+        strcpy(names[m], tmp.value.enumerated.name);
+        names_size += strlen(names[m]) + 1;
     }
-    ctl->ename = enames;
+
+    while (table_size < 2 * items)
+        table_size *= 2;
+
+    enums = malloc(sizeof(*enums) + items * sizeof(enums->names[0]) +
+                   table_size * sizeof(enums->table[0]) + names_size);
+    if (!enums)
+        goto fail;
+
+    enums->count = items;
+    enums->mask = table_size - 1;
+    enums->table = (unsigned int *)&enums->names[items];
+    memset(enums->table, 0, table_size * sizeof(enums->table[0]));
+
+    dest = (char *)&enums->table[table_size];
+    for (m = 0; m < items; m++) {
+        len = strlen(names[m]) + 1;
+        memcpy(dest, names[m], len);
+        enums->names[m] = dest;
+        dest += len;
+
+        slot = fnv_hash(names[m]) & enums->mask;
+        while (enums->table[slot])
+            slot = (slot + 1) & enums->mask;
+        enums->table[slot] = m + 1;
+    }
+
+    free(names);
+    __atomic_store_n(&ctl->enums, enums, __ATOMIC_RELEASE);
     return 0;
 
 fail:
-    if (enames) {
-        for (m = 0; m < ctl->info.value.enumerated.items; m++) {
-            if (enames[m]) {
-                free(enames[m]);
-            }
-        }
-        free(enames);
-    }
+    free(names);
     return -1;
 }
 
+static struct mixer_ctl_enums *mixer_ctl_fill_enum_string(struct mixer_ctl *ctl)
+{
+    struct mixer_ctl_enums *enums;
+
+    enums = __atomic_load_n(&ctl->enums, __ATOMIC_ACQUIRE);
+    if (enums)
+        return enums;
+
+    pthread_mutex_lock(&ctl->mixer->lock);
+    if (!ctl->enums)
+        mixer_ctl_load_enums(ctl);
+    enums = ctl->enums;
+    pthread_mutex_unlock(&ctl->mixer->lock);
+
+    return enums;
+}
+
 /** Gets the string representation of an enumerated item.
  * @param ctl An initialized control handle.
  * @param enum_id The index of the enumerated value.
@@ -1345,16 +3268,24 @@ fail:
 const char *mixer_ctl_get_enum_string(struct mixer_ctl *ctl,
                                       unsigned int enum_id)
 {
-    if (!ctl || ctl->info.type != SNDRV_CTL_ELEM_TYPE_ENUMERATED ||
-            enum_id >= ctl->info.value.enumerated.items) {
+    struct mixer_ctl_enums *enums;
+    struct mixer_ctl_info info;
+
+    if (!ctl) {
+        return NULL;
+    }
+
+    mixer_ctl_get_info(ctl, &info);
+    if (info.type != SNDRV_CTL_ELEM_TYPE_ENUMERATED || enum_id >= info.items) {
         return NULL;
     }
 
-    if (mixer_ctl_fill_enum_string(ctl) < 0) {
+    enums = mixer_ctl_fill_enum_string(ctl);
+    if (!enums || enum_id >= enums->count) {
         return NULL;
     }
 
-    return (const char *)ctl->ename[enum_id];
+    return (const char *)enums->names[enum_id];
 }
 
 /** Set an enumeration value by string value.
@@ -1367,25 +3298,37 @@ const char *mixer_ctl_get_enum_string(struct mixer_ctl *ctl,
 int mixer_ctl_set_enum_by_string(struct mixer_ctl *ctl, const char *string)
 {
     struct mixer_ctl_group *grp;
-    unsigned int i, num_enums;
+    struct mixer_ctl_enums *enums;
+    struct mixer_ctl_info info;
+    unsigned int i, slot;
     struct snd_ctl_elem_value ev;
     int ret;
 
-    if (!ctl || !string || ctl->info.type != SNDRV_CTL_ELEM_TYPE_ENUMERATED) {
+    if (!ctl || !string) {
         return -EINVAL;
     }
 
-    if (mixer_ctl_fill_enum_string(ctl) < 0) {
+    mixer_ctl_get_info(ctl, &info);
+    if (info.type != SNDRV_CTL_ELEM_TYPE_ENUMERATED) {
         return -EINVAL;
     }
 
-    grp = ctl->grp;
-    num_enums = ctl->info.value.enumerated.items;
-    for (i = 0; i < num_enums; i++) {
-        if (!strcmp(string, ctl->ename[i])) {
+    if (info.removed)
+        return -ENODEV;
+
+    enums = mixer_ctl_fill_enum_string(ctl);
+    if (!enums) {
+        return -EINVAL;
+    }
+
+    for (slot = fnv_hash(string) & enums->mask; enums->table[slot];
+            slot = (slot + 1) & enums->mask) {
+        i = enums->table[slot] - 1;
+        if (!strcmp(string, enums->names[i])) {
+            grp = ctl->grp;
             memset(&ev, 0, sizeof(ev));
             ev.value.enumerated.item[0] = i;
-            ev.id.numid = ctl->info.id.numid;
+            ev.id.numid = info.numid;
             ret = grp->ops->ioctl(grp->data, SNDRV_CTL_IOCTL_ELEM_WRITE, &ev);
             if (ret < 0)
                 return ret;
@@ -1395,3 +3338,397 @@ int mixer_ctl_set_enum_by_string(struct mixer_ctl *ctl, const char *string)
 
     return -EINVAL;
 }
+
+#define MIXER_SNAPSHOT_MAGIC 0x4e534154 /* "TASN" */
+#define MIXER_SNAPSHOT_VERSION 1
+
+/** Header of a mixer snapshot, followed by the entries */
+struct mixer_snapshot_header {
+    uint32_t magic;
+    uint32_t version;
+    /** The number of entries in the snapshot */
+    uint32_t count;
+    /** The size of the snapshot, including this header */
+    uint32_t size;
+};
+
+/** A control in a mixer snapshot, followed by its values.
+ * Boolean and integer values are stored as 32 bit integers,
+ * 64 bit integer values as 64 bit integers, enumerated values
+ * as 32 bit unsigned integers and bytes as is. The entries are
+ * padded to a multiple of 4 bytes.
+ */
+struct mixer_snapshot_entry {
+    /** The numid of the control */
+    uint32_t numid;
+    /** Hash of the name of the control */
+    uint32_t name_hash;
+    /** Zero for hardware controls, one for plugin controls */
+    uint8_t group;
+    /** The type of the control, from snd_ctl_elem_type_t */
+    uint8_t type;
+    uint16_t reserved;
+    /** The number of values */
+    uint32_t count;
+};
+
+static bool mixer_snapshot_is_rw(const struct mixer_ctl_info *info)
+{
+    return (info->access & SNDRV_CTL_ELEM_ACCESS_READWRITE) ==
+            SNDRV_CTL_ELEM_ACCESS_READWRITE &&
+            !(info->access & SNDRV_CTL_ELEM_ACCESS_INACTIVE);
+}
+
+/* Gets the size of a value of a type in a snapshot, zero if the type is not saved */
+static size_t mixer_snapshot_type_size(int type)
+{
+    switch (type) {
+    case SNDRV_CTL_ELEM_TYPE_BOOLEAN:
+    case SNDRV_CTL_ELEM_TYPE_INTEGER:
+        return sizeof(int32_t);
+    case SNDRV_CTL_ELEM_TYPE_INTEGER64:
+        return sizeof(int64_t);
+    case SNDRV_CTL_ELEM_TYPE_ENUMERATED:
+        return sizeof(uint32_t);
+    case SNDRV_CTL_ELEM_TYPE_BYTES:
+        return sizeof(uint8_t);
+    default:
+        return 0;
+    }
+}
+
+static size_t mixer_snapshot_value_size(const struct mixer_ctl_info *info)
+{
+    /* TLV bytes controls are not read through ELEM_READ */
+    if (info->type == SNDRV_CTL_ELEM_TYPE_BYTES &&
+            (info->access & SNDRV_CTL_ELEM_ACCESS_TLV_READWRITE))
+        return 0;
+
+    return mixer_snapshot_type_size(info->type);
+}
+
+static size_t mixer_snapshot_entry_size(size_t value_size, unsigned int count)
+{
+    size_t size = sizeof(struct mixer_snapshot_entry) + value_size * count;
+
+    return (size + 3) & ~(size_t)3;
+}
+
+/* Converts the value of a control into its snapshot representation */
+static void mixer_snapshot_pack(const struct mixer_ctl_info *info,
+                                const struct snd_ctl_elem_value *ev, uint8_t *values)
+{
+    unsigned int n, count = info->count;
+    int32_t i32;
+    int64_t i64;
+    uint32_t u32;
+
+    switch (info->type) {
+    case SNDRV_CTL_ELEM_TYPE_BOOLEAN:
+    case SNDRV_CTL_ELEM_TYPE_INTEGER:
+        for (n = 0; n < count; n++) {
+            i32 = ev->value.integer.value[n];
+            memcpy(values + n * sizeof(i32), &i32, sizeof(i32));
+        }
+        break;
+    case SNDRV_CTL_ELEM_TYPE_INTEGER64:
+        for (n = 0; n < count; n++) {
+            i64 = ev->value.integer64.value[n];
+            memcpy(values + n * sizeof(i64), &i64, sizeof(i64));
+        }
+        break;
+    case SNDRV_CTL_ELEM_TYPE_ENUMERATED:
+        for (n = 0; n < count; n++) {
+            u32 = ev->value.enumerated.item[n];
+            memcpy(values + n * sizeof(u32), &u32, sizeof(u32));
+        }
+        break;
+    default:
+        memcpy(values, ev->value.bytes.data, count);
+        break;
+    }
+}
+
+/* Converts the snapshot representation of a value back into an element value */
+static void mixer_snapshot_unpack(const struct mixer_ctl_info *info, const uint8_t *values,
+                                  struct snd_ctl_elem_value *ev)
+{
+    unsigned int n, count = info->count;
+    int32_t i32;
+    int64_t i64;
+    uint32_t u32;
+
+    switch (info->type) {
+    case SNDRV_CTL_ELEM_TYPE_BOOLEAN:
+    case SNDRV_CTL_ELEM_TYPE_INTEGER:
+        for (n = 0; n < count; n++) {
+            memcpy(&i32, values + n * sizeof(i32), sizeof(i32));
+            ev->value.integer.value[n] = i32;
+        }
+        break;
+    case SNDRV_CTL_ELEM_TYPE_INTEGER64:
+        for (n = 0; n < count; n++) {
+            memcpy(&i64, values + n * sizeof(i64), sizeof(i64));
+            ev->value.integer64.value[n] = i64;
+        }
+        break;
+    case SNDRV_CTL_ELEM_TYPE_ENUMERATED:
+        for (n = 0; n < count; n++) {
+            memcpy(&u32, values + n * sizeof(u32), sizeof(u32));
+            ev->value.enumerated.item[n] = u32;
+        }
+        break;
+    default:
+        memcpy(ev->value.bytes.data, values, count);
+        break;
+    }
+}
+
+/** Saves the values of the controls of a mixer into a snapshot.
+ * Every readable and writable control is saved, except TLV byte controls.
+ * The snapshot is only meant to be restored on the same card, by
+ * @ref mixer_snapshot_restore.
+ * @param mixer An initialized mixer handle.
+ * @param data Receives the snapshot, to be freed by the caller with free().
+ * @param size Receives the size of the snapshot, in bytes.
+ * @returns On success, zero. On failure, a negative errno value.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_snapshot_save(struct mixer *mixer, void **data, size_t *size)
+{
+    struct mixer_ctl_group *grps[2];
+    struct mixer_snapshot_header header;
+    struct mixer_snapshot_entry entry;
+    struct snd_ctl_elem_value ev;
+    struct mixer_ctl **grp_ctls[2], **ctls;
+    struct mixer_ctl_info *infos = NULL, *info;
+    struct mixer_ctl *ctl;
+    size_t value_size, total = sizeof(header);
+    unsigned int num_ctls[2];
+    unsigned int g, n, i, count = 0;
+    uint8_t *blob = NULL, *pos;
+    int ret = -ENOMEM;
+
+    if (!mixer || !data || !size)
+        return -EINVAL;
+
+    grps[0] = mixer->h_grp;
+    grps[1] = mixer->v_grp;
+
+    /* controls added meanwhile are left out of the snapshot */
+    mixer_read_begin(mixer);
+    for (g = 0; g < 2; g++)
+        grp_ctls[g] = mixer_grp_get_ctls(grps[g], &num_ctls[g]);
+
+    ctls = calloc(num_ctls[0] + num_ctls[1] + 1, sizeof(*ctls));
+    for (g = 0, i = 0; ctls && g < 2; g++) {
+        for (n = 0; n < num_ctls[g]; n++)
+            ctls[i++] = grp_ctls[g][n];
+    }
+    mixer_read_end(mixer);
+
+    /* the info the snapshot is sized with is the info it is filled with */
+    infos = calloc(num_ctls[0] + num_ctls[1] + 1, sizeof(*infos));
+    if (!ctls || !infos)
+        goto exit;
+
+    for (i = 0; i < num_ctls[0] + num_ctls[1]; i++) {
+        info = &infos[i];
+        mixer_ctl_get_info(ctls[i], info);
+        value_size = mixer_snapshot_value_size(info);
+        if (value_size && mixer_snapshot_is_rw(info) && !info->removed)
+            total += mixer_snapshot_entry_size(value_size, info->count);
+    }
+
+    ret = -EOVERFLOW;
+    if (total > UINT32_MAX)
+        goto exit;
+
+    ret = -ENOMEM;
+    blob = calloc(1, total);
+    if (!blob)
+        goto exit;
+
+    pos = blob + sizeof(header);
+    for (g = 0, i = 0; g < 2; g++) {
+        for (n = 0; n < num_ctls[g]; n++, i++) {
+            ctl = ctls[i];
+            info = &infos[i];
+            value_size = mixer_snapshot_value_size(info);
+            if (!value_size || !mixer_snapshot_is_rw(info) || info->removed)
+                continue;
+
+            memset(&ev, 0, sizeof(ev));
+            ev.id.numid = info->numid;
+            ret = grps[g]->ops->ioctl(grps[g]->data, SNDRV_CTL_IOCTL_ELEM_READ, &ev);
+            if (ret < 0) {
+                fprintf(stderr, "%s: failed to read control '%s'\n", __func__,
+                        ctl->name);
+                free(blob);
+                blob = NULL;
+                goto exit;
+            }
+
+            memset(&entry, 0, sizeof(entry));
+            entry.numid = info->numid;
+            entry.name_hash = ctl->name_hash;
+            entry.group = g;
+            entry.type = info->type;
+            entry.count = info->count;
+            memcpy(pos, &entry, sizeof(entry));
+            mixer_snapshot_pack(info, &ev, pos + sizeof(entry));
+
+            pos += mixer_snapshot_entry_size(value_size, info->count);
+            count++;
+        }
+    }
+    ret = 0;
+
+exit:
+    free(infos);
+    free(ctls);
+    if (ret < 0)
+        return ret;
+
+    header.magic = MIXER_SNAPSHOT_MAGIC;
+    header.version = MIXER_SNAPSHOT_VERSION;
+    header.count = count;
+    header.size = total;
+    memcpy(blob, &header, sizeof(header));
+
+    *data = blob;
+    *size = total;
+    return 0;
+}
+
+/* Walks the entries of a snapshot. With ctls set to NULL, only validates them. */
+static int mixer_snapshot_walk(struct mixer *mixer, const uint8_t *blob, size_t size,
+                               struct mixer_ctl **ctls)
+{
+    struct mixer_snapshot_header header;
+    struct mixer_snapshot_entry entry;
+    struct mixer_ctl_group *grp;
+    struct mixer_ctl_info info;
+    struct mixer_ctl *ctl;
+    size_t entry_size, offset = sizeof(header);
+    unsigned int n;
+
+    if (size < sizeof(header))
+        return -EINVAL;
+
+    memcpy(&header, blob, sizeof(header));
+    if (header.magic != MIXER_SNAPSHOT_MAGIC ||
+            header.version != MIXER_SNAPSHOT_VERSION || header.size != size)
+        return -EINVAL;
+
+    for (n = 0; n < header.count; n++) {
+        if (size - offset < sizeof(entry))
+            return -EINVAL;
+        memcpy(&entry, blob + offset, sizeof(entry));
+
+        grp = entry.group ? mixer->v_grp : mixer->h_grp;
+        ctl = mixer_grp_get_ctl_by_numid(mixer, grp, entry.numid);
+        if (ctl)
+            mixer_ctl_get_info(ctl, &info);
+        if (!ctl || info.type != entry.type || info.count != entry.count ||
+                ctl->name_hash != entry.name_hash) {
+            fprintf(stderr, "%s: control %u does not match the snapshot\n",
+                    __func__, entry.numid);
+            return -EINVAL;
+        }
+
+        if (!mixer_snapshot_value_size(&info))
+            return -EINVAL;
+
+        entry_size = mixer_snapshot_entry_size(mixer_snapshot_type_size(entry.type),
+                                               entry.count);
+        if (size - offset < entry_size)
+            return -EINVAL;
+
+        if (ctls)
+            ctls[n] = ctl;
+        offset += entry_size;
+    }
+
+    return offset == size ? (int)header.count : -EINVAL;
+}
+
+/** Restores the values of the controls of a mixer from a snapshot.
+ * The whole snapshot is validated against the controls of the mixer first,
+ * and nothing is written if any control does not match.
+ * Controls whose current values match the snapshot are not written,
+ * nor are controls that are no longer active.
+ * @param mixer An initialized mixer handle.
+ * @param data A snapshot returned by @ref mixer_snapshot_save.
+ * @param size The size of the snapshot, in bytes.
+ * @returns On success, the number of controls written.
+ *  On failure, a negative errno value.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_snapshot_restore(struct mixer *mixer, const void *data, size_t size)
+{
+    const uint8_t *blob = data, *values;
+    struct mixer_snapshot_entry entry;
+    struct mixer_ctl_info info;
+    struct mixer_ctl **ctls;
+    struct mixer_ctl *ctl;
+    struct snd_ctl_elem_value ev, cur;
+    size_t value_size, offset = sizeof(struct mixer_snapshot_header);
+    int count, n, ret = 0, written = 0;
+
+    if (!mixer || !data)
+        return -EINVAL;
+
+    count = mixer_snapshot_walk(mixer, blob, size, NULL);
+    if (count <= 0)
+        return count;
+
+    ctls = calloc(count, sizeof(*ctls));
+    if (!ctls)
+        return -ENOMEM;
+    mixer_snapshot_walk(mixer, blob, size, ctls);
+
+    for (n = 0; n < count; n++) {
+        ctl = ctls[n];
+        memcpy(&entry, blob + offset, sizeof(entry));
+        value_size = mixer_snapshot_type_size(entry.type);
+        values = blob + offset + sizeof(entry);
+        offset += mixer_snapshot_entry_size(value_size, entry.count);
+
+        /* the control may have been deactivated since the snapshot was saved */
+        mixer_ctl_get_info(ctl, &info);
+        if (!mixer_snapshot_is_rw(&info))
+            continue;
+
+        /* or changed since it was checked against the snapshot */
+        if (info.removed || info.type != entry.type || info.count != entry.count ||
+                !mixer_snapshot_value_size(&info)) {
+            fprintf(stderr, "%s: control '%s' changed\n", __func__, ctl->name);
+            ret = -EIO;
+            continue;
+        }
+
+        memset(&cur, 0, sizeof(cur));
+        cur.id.numid = info.numid;
+        if (ctl->grp->ops->ioctl(ctl->grp->data, SNDRV_CTL_IOCTL_ELEM_READ, &cur) == 0) {
+            memset(&ev, 0, sizeof(ev));
+            mixer_snapshot_pack(&info, &cur, (uint8_t *)&ev.value);
+            if (!memcmp(&ev.value, values, value_size * info.count))
+                continue;
+        }
+
+        memset(&ev, 0, sizeof(ev));
+        ev.id.numid = info.numid;
+        mixer_snapshot_unpack(&info, values, &ev);
+        if (ctl->grp->ops->ioctl(ctl->grp->data, SNDRV_CTL_IOCTL_ELEM_WRITE, &ev) < 0) {
+            fprintf(stderr, "%s: failed to write control '%s'\n", __func__,
+                    ctl->name);
+            ret = -EIO;
+            continue;
+        }
+        written++;
+    }
+
+    free(ctls);
+    return ret < 0 ? ret : written;
+}
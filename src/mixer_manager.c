@@ -0,0 +1,480 @@
+/* mixer_manager.c
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are met:
+**     * Redistributions of source code must retain the above copyright
+**       notice, this list of conditions and the following disclaimer.
+**     * Redistributions in binary form must reproduce the above copyright
+**       notice, this list of conditions and the following disclaimer in the
+**       documentation and/or other materials provided with the distribution.
+**     * Neither the name of The Android Open Source Project nor the names of
+**       its contributors may be used to endorse or promote products derived
+**       from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY The Android Open Source Project ``AS IS'' AND
+** ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+** IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+** ARE DISCLAIMED. IN NO EVENT SHALL The Android Open Source Project BE LIABLE
+** FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+** DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+** SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+** CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+** LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+** OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+** DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+
+#include <tinyalsa/card.h>
+
+#include "fnv_hash.h"
+
+/** A control in the index */
+struct mixer_manager_entry {
+    struct mixer_ctl *ctl;
+    /** The index of the control's mixer */
+    unsigned int mixer;
+    uint32_t hash;
+};
+
+/** Mixers of several cards, sharing one control namespace.
+ * @ingroup libtinyalsa-mixer
+ */
+struct mixer_manager {
+    /** The mixers, in the order of their cards */
+    struct mixer **mixers;
+    /** The card of each mixer */
+    unsigned int *cards;
+    unsigned int num_mixers;
+    /** Open addressed hash table of the controls, keyed by name */
+    struct mixer_manager_entry *table;
+    unsigned int mask;
+};
+
+/** A card being opened by a worker thread */
+struct mixer_manager_job {
+    pthread_t thread;
+    bool started;
+    unsigned int card;
+    struct mixer *mixer;
+};
+
+/* Lists the cards that have a control device, in card order */
+static unsigned int mixer_manager_scan_cards(unsigned int **cards)
+{
+    unsigned int *list = NULL, *grown;
+    unsigned int card, n, count = 0, max = 0;
+    struct dirent *entry;
+    DIR *dir;
+    char c;
+
+    dir = opendir(CARD_DEFAULT_DIR);
+    if (!dir)
+        return 0;
+
+    while ((entry = readdir(dir))) {
+        if (sscanf(entry->d_name, "controlC%u%c", &card, &c) != 1)
+            continue;
+
+        if (count == max) {
+            max = max ? 2 * max : 8;
+            grown = realloc(list, max * sizeof(*list));
+            if (!grown)
+                break;
+            list = grown;
+        }
+
+        for (n = count; n > 0 && list[n - 1] > card; n--)
+            list[n] = list[n - 1];
+        list[n] = card;
+        count++;
+    }
+
+    closedir(dir);
+    *cards = list;
+    return count;
+}
+
+static void *mixer_manager_open_card(void *arg)
+{
+    struct mixer_manager_job *job = arg;
+
+    job->mixer = mixer_open(job->card);
+    return NULL;
+}
+
+/* Indexes the controls of all mixers, in card order and then numid order.
+ * Controls sharing a name are therefore found in the order of their index,
+ * both within a card and across cards.
+ */
+static int mixer_manager_build_index(struct mixer_manager *mm)
+{
+    struct mixer_manager_entry *table;
+    struct mixer_ctl *ctl;
+    unsigned int total = 0, size = 16;
+    unsigned int m, n, count, slot;
+    uint32_t hash;
+
+    for (m = 0; m < mm->num_mixers; m++)
+        total += mixer_get_num_ctls(mm->mixers[m]);
+
+    while (size < 2 * total)
+        size *= 2;
+
+    table = calloc(size, sizeof(*table));
+    if (!table)
+        return -ENOMEM;
+
+    for (m = 0; m < mm->num_mixers; m++) {
+        count = mixer_get_num_ctls(mm->mixers[m]);
+        for (n = 0; n < count; n++) {
+            ctl = mixer_get_ctl(mm->mixers[m], n);
+            if (!ctl)
+                continue;
+
+            hash = fnv_hash(mixer_ctl_get_name(ctl));
+            for (slot = hash & (size - 1); table[slot].ctl; slot = (slot + 1) & (size - 1))
+                ;
+            table[slot].ctl = ctl;
+            table[slot].mixer = m;
+            table[slot].hash = hash;
+        }
+    }
+
+    free(mm->table);
+    mm->table = table;
+    mm->mask = size - 1;
+    return 0;
+}
+
+/** Opens the mixers of several cards and indexes their controls.
+ * The mixers are opened in parallel, one thread per card.
+ * Cards whose mixer fails to open are left out.
+ * @param cards The cards to open, or NULL for every card in /dev/snd.
+ * @param num_cards The number of cards in @p cards.
+ * @returns A manager on success, NULL if no mixer could be opened.
+ * @ingroup libtinyalsa-mixer
+ */
+struct mixer_manager *mixer_manager_open(const unsigned int *cards, unsigned int num_cards)
+{
+    struct mixer_manager_job *jobs = NULL;
+    struct mixer_manager *mm = NULL;
+    unsigned int *scanned = NULL;
+    unsigned int n;
+
+    if (!cards) {
+        num_cards = mixer_manager_scan_cards(&scanned);
+        cards = scanned;
+    }
+
+    if (!num_cards)
+        goto exit;
+
+    jobs = calloc(num_cards, sizeof(*jobs));
+    mm = calloc(1, sizeof(*mm));
+    if (!jobs || !mm)
+        goto fail;
+
+    mm->mixers = calloc(num_cards, sizeof(*mm->mixers));
+    mm->cards = calloc(num_cards, sizeof(*mm->cards));
+    if (!mm->mixers || !mm->cards)
+        goto fail;
+
+    for (n = 0; n < num_cards; n++)
+        jobs[n].card = cards[n];
+
+    for (n = 0; n < num_cards; n++) {
+        jobs[n].mixer = NULL;
+        jobs[n].started = pthread_create(&jobs[n].thread, NULL,
+                                         mixer_manager_open_card, &jobs[n]) == 0;
+        if (!jobs[n].started)
+            mixer_manager_open_card(&jobs[n]);
+    }
+
+    for (n = 0; n < num_cards; n++) {
+        if (jobs[n].started)
+            pthread_join(jobs[n].thread, NULL);
+        if (jobs[n].mixer) {
+            mm->mixers[mm->num_mixers] = jobs[n].mixer;
+            mm->cards[mm->num_mixers++] = jobs[n].card;
+        } else
+            fprintf(stderr, "%s: failed to open mixer of card %u\n", __func__, jobs[n].card);
+    }
+
+    if (mm->num_mixers && mixer_manager_build_index(mm) == 0)
+        goto exit;
+
+fail:
+    mixer_manager_close(mm);
+    mm = NULL;
+exit:
+    free(jobs);
+    free(scanned);
+    return mm;
+}
+
+/** Closes the manager and all its mixers.
+ * @param mm A manager, may be NULL.
+ * @ingroup libtinyalsa-mixer
+ */
+void mixer_manager_close(struct mixer_manager *mm)
+{
+    unsigned int n;
+
+    if (!mm)
+        return;
+
+    for (n = 0; n < mm->num_mixers; n++)
+        mixer_close(mm->mixers[n]);
+
+    free(mm->mixers);
+    free(mm->cards);
+    free(mm->table);
+    free(mm);
+}
+
+/** Gets the number of mixers of the manager.
+ * @param mm An initialized manager.
+ * @returns The number of mixers that were opened.
+ * @ingroup libtinyalsa-mixer
+ */
+unsigned int mixer_manager_get_num_mixers(const struct mixer_manager *mm)
+{
+    if (!mm)
+        return 0;
+
+    return mm->num_mixers;
+}
+
+/** Gets a mixer of the manager.
+ * @param mm An initialized manager.
+ * @param id The index of the mixer, in the order of the cards.
+ * @returns The mixer, owned by the manager, or NULL if @p id is out of range.
+ * @ingroup libtinyalsa-mixer
+ */
+struct mixer *mixer_manager_get_mixer(struct mixer_manager *mm, unsigned int id)
+{
+    if (!mm || id >= mm->num_mixers)
+        return NULL;
+
+    return mm->mixers[id];
+}
+
+static int mixer_manager_find_mixer(const struct mixer_manager *mm, const char *card_id)
+{
+    unsigned int n;
+
+    for (n = 0; n < mm->num_mixers; n++) {
+        if (!strcmp(card_id, mixer_get_id(mm->mixers[n])))
+            return n;
+    }
+
+    return -1;
+}
+
+/** Gets the mixer of a card, by the card's identifier.
+ * @param mm An initialized manager.
+ * @param card_id The identifier of the card, see mixer_get_id().
+ * @returns The mixer, owned by the manager, or NULL if no card matches.
+ * @ingroup libtinyalsa-mixer
+ */
+struct mixer *mixer_manager_get_mixer_by_id(struct mixer_manager *mm, const char *card_id)
+{
+    int m;
+
+    if (!mm || !card_id)
+        return NULL;
+
+    m = mixer_manager_find_mixer(mm, card_id);
+    return m < 0 ? NULL : mm->mixers[m];
+}
+
+/** Gets a control by card identifier, name and index.
+ * @param mm An initialized manager.
+ * @param card_id The identifier of the card, or NULL to search every card.
+ *  In that case, @p index counts the controls of the earlier cards first.
+ * @param name The name of the control.
+ * @param index The index of the control among those with the same name.
+ * @returns The control, or NULL if it was not found.
+ * @ingroup libtinyalsa-mixer
+ */
+struct mixer_ctl *mixer_manager_get_ctl(struct mixer_manager *mm, const char *card_id,
+                                        const char *name, unsigned int index)
+{
+    const struct mixer_manager_entry *entry;
+    unsigned int slot;
+    uint32_t hash;
+    int m = -1;
+
+    if (!mm || !name)
+        return NULL;
+
+    if (card_id) {
+        m = mixer_manager_find_mixer(mm, card_id);
+        if (m < 0)
+            return NULL;
+    }
+
+    hash = fnv_hash(name);
+    for (slot = hash & mm->mask; mm->table[slot].ctl; slot = (slot + 1) & mm->mask) {
+        entry = &mm->table[slot];
+        if (entry->hash != hash || (m >= 0 && entry->mixer != (unsigned int)m) ||
+                strcmp(name, mixer_ctl_get_name(entry->ctl)))
+            continue;
+        if (index == 0)
+            return entry->ctl;
+        index--;
+    }
+
+    return NULL;
+}
+
+/** Gets several controls by name, with an index of zero.
+ * @param mm An initialized manager.
+ * @param card_id The identifier of the card, or NULL to search every card.
+ * @param names The names of the controls.
+ * @param ctls Receives the controls, NULL for those that were not found.
+ * @param count The number of names.
+ * @returns The number of controls that were found.
+ * @ingroup libtinyalsa-mixer
+ */
+unsigned int mixer_manager_get_ctls(struct mixer_manager *mm, const char *card_id,
+                                    const char *const *names, struct mixer_ctl **ctls,
+                                    unsigned int count)
+{
+    unsigned int n, found = 0;
+
+    if (!mm || !names || !ctls)
+        return 0;
+
+    for (n = 0; n < count; n++) {
+        ctls[n] = mixer_manager_get_ctl(mm, card_id, names[n], 0);
+        if (ctls[n])
+            found++;
+    }
+
+    return found;
+}
+
+/** Adds the controls created since the mixers were opened, and leaves
+ * out those removed since.
+ * The index is rebuilt, so this must not run concurrently with lookups
+ * through the manager. Control handles remain valid.
+ * @param mm An initialized manager.
+ * @returns On success, zero.
+ *  If the controls of a mixer could not be added, -EIO, the others
+ *  are indexed nonetheless.
+ *  On other failures, a negative errno value.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_manager_update(struct mixer_manager *mm)
+{
+    unsigned int n;
+    int ret = 0;
+
+    if (!mm)
+        return -EINVAL;
+
+    for (n = 0; n < mm->num_mixers; n++) {
+        if (mixer_add_new_ctls(mm->mixers[n]) < 0)
+            ret = -EIO;
+    }
+
+    if (mixer_manager_build_index(mm) < 0)
+        return -ENOMEM;
+
+    return ret;
+}
+
+static int mixer_manager_add_card(struct mixer_manager *mm, unsigned int card)
+{
+    struct mixer **mixers;
+    unsigned int *cards;
+    struct mixer *mixer;
+    unsigned int n, pos;
+
+    for (pos = 0; pos < mm->num_mixers && mm->cards[pos] < card; pos++)
+        ;
+    if (pos < mm->num_mixers && mm->cards[pos] == card)
+        return 0;
+
+    mixers = realloc(mm->mixers, (mm->num_mixers + 1) * sizeof(*mixers));
+    if (!mixers)
+        return -ENOMEM;
+    mm->mixers = mixers;
+
+    cards = realloc(mm->cards, (mm->num_mixers + 1) * sizeof(*cards));
+    if (!cards)
+        return -ENOMEM;
+    mm->cards = cards;
+
+    mixer = mixer_open(card);
+    if (!mixer)
+        return -ENODEV;
+
+    for (n = mm->num_mixers; n > pos; n--) {
+        mm->mixers[n] = mm->mixers[n - 1];
+        mm->cards[n] = mm->cards[n - 1];
+    }
+    mm->mixers[pos] = mixer;
+    mm->cards[pos] = card;
+    mm->num_mixers++;
+    return 0;
+}
+
+static void mixer_manager_remove_card(struct mixer_manager *mm, unsigned int card)
+{
+    unsigned int n;
+
+    for (n = 0; n < mm->num_mixers && mm->cards[n] != card; n++)
+        ;
+    if (n == mm->num_mixers)
+        return;
+
+    mixer_close(mm->mixers[n]);
+    for (mm->num_mixers--; n < mm->num_mixers; n++) {
+        mm->mixers[n] = mm->mixers[n + 1];
+        mm->cards[n] = mm->cards[n + 1];
+    }
+}
+
+/** Opens or closes the mixer of a card that was added or removed.
+ * Only the events of control devices are relevant, the others are ignored.
+ * The index is rebuilt, so this must not run concurrently with lookups
+ * through the manager. The handles of a removed card become invalid.
+ * @param mm An initialized manager.
+ * @param event An event reported by a card monitor.
+ * @returns On success, zero.
+ *  On failure, a negative errno value.
+ * @ingroup libtinyalsa-card
+ */
+int mixer_manager_handle_card_event(struct mixer_manager *mm, const struct card_event *event)
+{
+    int ret;
+
+    if (!mm || !event)
+        return -EINVAL;
+
+    if (event->device_type != CARD_DEVICE_CONTROL)
+        return 0;
+
+    if (event->type == CARD_EVENT_ADD) {
+        ret = mixer_manager_add_card(mm, event->card);
+        if (ret < 0)
+            return ret;
+    } else {
+        mixer_manager_remove_card(mm, event->card);
+    }
+
+    return mixer_manager_build_index(mm);
+}
@@ -365,7 +365,8 @@ static void mixer_plug_close(void *data)
     }
 
     plug_data->ops->close(&plugin);
-    dlclose(plug_data->dl_hdl);
+    snd_utils_close_plugin(plug_data->dl_hdl);
+    snd_utils_close_dev_node(plug_data->mixer_node);
 
     free(plug_data);
     plug_data = NULL;
@@ -453,7 +454,7 @@ int mixer_plugin_open(unsigned int card, void **data,
 
     }
 
-    dl_hdl = dlopen(so_name, RTLD_NOW);
+    dl_hdl = snd_utils_open_plugin(plug_data->mixer_node, so_name);
     if (!dl_hdl) {
         fprintf(stderr, "%s: unable to open %s\n",
                 __func__, so_name);
@@ -487,7 +488,7 @@ int mixer_plugin_open(unsigned int card, void **data,
     return 0;
 
 err_ops:
-    dlclose(dl_hdl);
+    snd_utils_close_plugin(dl_hdl);
 err_dlopen:
 err_get_lib_name:
     snd_utils_close_dev_node(plug_data->mixer_node);
@@ -0,0 +1,420 @@
+/* mixer_ramp.c
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are met:
+**     * Redistributions of source code must retain the above copyright
+**       notice, this list of conditions and the following disclaimer.
+**     * Redistributions in binary form must reproduce the above copyright
+**       notice, this list of conditions and the following disclaimer in the
+**       documentation and/or other materials provided with the distribution.
+**     * Neither the name of The Android Open Source Project nor the names of
+**       its contributors may be used to endorse or promote products derived
+**       from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY The Android Open Source Project ``AS IS'' AND
+** ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+** IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+** ARE DISCLAIMED. IN NO EVENT SHALL The Android Open Source Project BE LIABLE
+** FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+** DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+** SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+** CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+** LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+** OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+** DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include <tinyalsa/mixer.h>
+
+/* the period of the ramp steps, in nanoseconds */
+#define MIXER_RAMP_PERIOD_NS 5000000LL
+
+/* the periods the final value of a ramp is retried for before giving up */
+#define MIXER_RAMP_MAX_RETRIES 20
+
+#define NSEC_PER_MSEC 1000000LL
+#define NSEC_PER_SEC 1000000000LL
+
+/** A control moving from one value to another */
+struct ramp {
+    struct mixer_ctl *ctl;
+    int from;
+    int to;
+    /** The value last written to the control */
+    int last;
+    /** The consecutive failures to write the final value */
+    unsigned int retries;
+    /** When the ramp started, in nanoseconds of CLOCK_MONOTONIC */
+    int64_t start;
+    /** How long the ramp lasts, in nanoseconds */
+    int64_t duration;
+};
+
+/** A ramp scheduler.
+ * @ingroup libtinyalsa-mixer
+ */
+struct mixer_ramp {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    /** Signalled by the worker when a ramp completes */
+    pthread_cond_t done;
+    /** Wakes up the worker when ramps are added or the scheduler closes */
+    int event_fd;
+    /** Paces the ramp steps while ramps are active */
+    int timer_fd;
+    bool closing;
+    /** The active ramps, at most one per control */
+    struct ramp *ramps;
+    unsigned int num_ramps;
+    unsigned int max_ramps;
+};
+
+static int64_t ramp_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static int ramp_write(struct ramp *ramp, int value)
+{
+    unsigned int n, count = mixer_ctl_get_num_values(ramp->ctl);
+    long values[128];
+    int ret;
+
+    if (value == ramp->last)
+        return 0;
+
+    for (n = 0; n < count; n++)
+        values[n] = value;
+
+    /* a value the control did not take is written again on the next step */
+    ret = mixer_ctl_set_array(ramp->ctl, values, count);
+    if (ret == 0)
+        ramp->last = value;
+    return ret;
+}
+
+static struct ramp *ramp_find(struct mixer_ramp *mr, const struct mixer_ctl *ctl)
+{
+    unsigned int n;
+
+    for (n = 0; n < mr->num_ramps; n++)
+        if (mr->ramps[n].ctl == ctl)
+            return &mr->ramps[n];
+
+    return NULL;
+}
+
+static void ramp_remove(struct mixer_ramp *mr, struct ramp *ramp)
+{
+    *ramp = mr->ramps[--mr->num_ramps];
+    pthread_cond_broadcast(&mr->done);
+}
+
+static void ramp_arm_timer(struct mixer_ramp *mr, bool enable)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    if (enable) {
+        its.it_value.tv_nsec = MIXER_RAMP_PERIOD_NS;
+        its.it_interval.tv_nsec = MIXER_RAMP_PERIOD_NS;
+    }
+
+    timerfd_settime(mr->timer_fd, 0, &its, NULL);
+}
+
+/* Steps every active ramp, returns true while ramps remain */
+static bool ramp_step(struct mixer_ramp *mr)
+{
+    struct ramp *ramp;
+    int64_t now = ramp_now(), elapsed;
+    unsigned int n = 0;
+    int value;
+
+    while (n < mr->num_ramps) {
+        ramp = &mr->ramps[n];
+        elapsed = now - ramp->start;
+
+        if (elapsed >= ramp->duration) {
+            if (ramp_write(ramp, ramp->to) < 0 &&
+                    ++ramp->retries < MIXER_RAMP_MAX_RETRIES) {
+                n++;
+                continue;
+            }
+            if (ramp->last != ramp->to)
+                fprintf(stderr, "%s: failed to write control '%s'\n", __func__,
+                        mixer_ctl_get_name(ramp->ctl));
+            ramp_remove(mr, ramp);
+            continue;
+        }
+
+        value = ramp->from + (int64_t)(ramp->to - ramp->from) * elapsed / ramp->duration;
+        if (ramp_write(ramp, value) < 0)
+            fprintf(stderr, "%s: failed to write control '%s'\n", __func__,
+                    mixer_ctl_get_name(ramp->ctl));
+        n++;
+    }
+
+    return mr->num_ramps > 0;
+}
+
+static void *ramp_thread(void *arg)
+{
+    struct mixer_ramp *mr = arg;
+    struct pollfd pfd[2];
+    uint64_t count;
+    bool active = false;
+
+    pfd[0].fd = mr->event_fd;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = mr->timer_fd;
+    pfd[1].events = POLLIN;
+
+    for (;;) {
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if (pfd[0].revents & POLLIN) {
+            if (read(mr->event_fd, &count, sizeof(count)) < 0)
+                continue;
+        }
+        if (pfd[1].revents & POLLIN) {
+            if (read(mr->timer_fd, &count, sizeof(count)) < 0)
+                continue;
+        }
+
+        pthread_mutex_lock(&mr->lock);
+        if (mr->closing) {
+            pthread_mutex_unlock(&mr->lock);
+            break;
+        }
+
+        if (ramp_step(mr) != active) {
+            active = !active;
+            ramp_arm_timer(mr, active);
+        }
+        pthread_mutex_unlock(&mr->lock);
+    }
+
+    return NULL;
+}
+
+/** Opens a ramp scheduler.
+ * The scheduler steps the controls of its ramps from a worker thread,
+ * so the controls must not be closed while they ramp.
+ * @returns A ramp scheduler on success, NULL on failure.
+ * @ingroup libtinyalsa-mixer
+ */
+struct mixer_ramp *mixer_ramp_open(void)
+{
+    struct mixer_ramp *mr;
+
+    mr = calloc(1, sizeof(*mr));
+    if (!mr)
+        return NULL;
+
+    mr->event_fd = eventfd(0, EFD_CLOEXEC);
+    if (mr->event_fd < 0)
+        goto err_free;
+
+    mr->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (mr->timer_fd < 0)
+        goto err_close_event;
+
+    pthread_mutex_init(&mr->lock, NULL);
+    pthread_cond_init(&mr->done, NULL);
+
+    if (pthread_create(&mr->thread, NULL, ramp_thread, mr))
+        goto err_close_timer;
+
+    return mr;
+
+err_close_timer:
+    pthread_cond_destroy(&mr->done);
+    pthread_mutex_destroy(&mr->lock);
+    close(mr->timer_fd);
+err_close_event:
+    close(mr->event_fd);
+err_free:
+    free(mr);
+    return NULL;
+}
+
+static void ramp_wake(struct mixer_ramp *mr)
+{
+    uint64_t one = 1;
+
+    if (write(mr->event_fd, &one, sizeof(one)) < 0)
+        fprintf(stderr, "%s: failed to wake up the ramp thread\n", __func__);
+}
+
+/** Closes a ramp scheduler.
+ * Active ramps stop where they are.
+ * @param mr A ramp scheduler. May be NULL.
+ * @ingroup libtinyalsa-mixer
+ */
+void mixer_ramp_close(struct mixer_ramp *mr)
+{
+    if (!mr)
+        return;
+
+    pthread_mutex_lock(&mr->lock);
+    mr->closing = true;
+    pthread_mutex_unlock(&mr->lock);
+    ramp_wake(mr);
+
+    pthread_join(mr->thread, NULL);
+    pthread_cond_destroy(&mr->done);
+    pthread_mutex_destroy(&mr->lock);
+    close(mr->timer_fd);
+    close(mr->event_fd);
+    free(mr->ramps);
+    free(mr);
+}
+
+/** Moves every value of an integer control from one value to another.
+ * The values are stepped every few milliseconds, and the control is only
+ * written when the value changes. If the control is already ramping,
+ * the new ramp replaces the current one and starts from the value the
+ * current one reached, ignoring @p from.
+ * @param mr A ramp scheduler.
+ * @param ctl An integer or boolean control.
+ * @param from The value to start from.
+ * @param to The value to end at.
+ * @param duration_ms The duration of the ramp, in milliseconds.
+ *  With zero, the control is set to @p to right away.
+ * @returns On success, zero. On failure, a negative errno value.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_ramp_start(struct mixer_ramp *mr, struct mixer_ctl *ctl, int from, int to,
+                     unsigned int duration_ms)
+{
+    struct ramp *ramp, *ramps;
+    unsigned int max_ramps;
+
+    if (!mr || !ctl)
+        return -EINVAL;
+
+    switch (mixer_ctl_get_type(ctl)) {
+    case MIXER_CTL_TYPE_BOOL:
+    case MIXER_CTL_TYPE_INT:
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&mr->lock);
+
+    ramp = ramp_find(mr, ctl);
+    if (ramp) {
+        from = ramp->last;
+    } else {
+        if (mr->num_ramps == mr->max_ramps) {
+            max_ramps = mr->max_ramps ? 2 * mr->max_ramps : 8;
+            ramps = realloc(mr->ramps, max_ramps * sizeof(*ramps));
+            if (!ramps) {
+                pthread_mutex_unlock(&mr->lock);
+                return -ENOMEM;
+            }
+            mr->ramps = ramps;
+            mr->max_ramps = max_ramps;
+        }
+        ramp = &mr->ramps[mr->num_ramps++];
+        ramp->ctl = ctl;
+        /* force the first write */
+        ramp->last = from + 1;
+        ramp_write(ramp, from);
+    }
+
+    ramp->from = from;
+    ramp->to = to;
+    ramp->retries = 0;
+    ramp->start = ramp_now();
+    ramp->duration = duration_ms * NSEC_PER_MSEC;
+
+    pthread_mutex_unlock(&mr->lock);
+    ramp_wake(mr);
+    return 0;
+}
+
+/** Stops the ramp of a control where it is.
+ * @param mr A ramp scheduler.
+ * @param ctl A control.
+ * @returns On success, zero. If the control is not ramping, -ENOENT.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_ramp_cancel(struct mixer_ramp *mr, struct mixer_ctl *ctl)
+{
+    struct ramp *ramp;
+
+    if (!mr || !ctl)
+        return -EINVAL;
+
+    pthread_mutex_lock(&mr->lock);
+    ramp = ramp_find(mr, ctl);
+    if (ramp)
+        ramp_remove(mr, ramp);
+    pthread_mutex_unlock(&mr->lock);
+
+    return ramp ? 0 : -ENOENT;
+}
+
+/** Waits for the ramp of a control to complete.
+ * @param mr A ramp scheduler.
+ * @param ctl A control.
+ * @param timeout_ms The longest time to wait, in milliseconds, or -1 to wait forever.
+ * @returns Zero when the control is not ramping anymore.
+ *  On timeout, -ETIMEDOUT.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_ramp_wait(struct mixer_ramp *mr, struct mixer_ctl *ctl, int timeout_ms)
+{
+    struct timespec deadline;
+    int ret = 0;
+
+    if (!mr || !ctl)
+        return -EINVAL;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    if (timeout_ms > 0) {
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (timeout_ms % 1000) * NSEC_PER_MSEC;
+        if (deadline.tv_nsec >= NSEC_PER_SEC) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= NSEC_PER_SEC;
+        }
+    }
+
+    pthread_mutex_lock(&mr->lock);
+    while (ramp_find(mr, ctl) && !ret) {
+        if (timeout_ms < 0)
+            pthread_cond_wait(&mr->done, &mr->lock);
+        else if (pthread_cond_timedwait(&mr->done, &mr->lock, &deadline))
+            ret = -ETIMEDOUT;
+    }
+    pthread_mutex_unlock(&mr->lock);
+
+    return ret;
+}
@@ -0,0 +1,736 @@
+/* mixer_route.c
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are met:
+**     * Redistributions of source code must retain the above copyright
+**       notice, this list of conditions and the following disclaimer.
+**     * Redistributions in binary form must reproduce the above copyright
+**       notice, this list of conditions and the following disclaimer in the
+**       documentation and/or other materials provided with the distribution.
+**     * Neither the name of The Android Open Source Project nor the names of
+**       its contributors may be used to endorse or promote products derived
+**       from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY The Android Open Source Project ``AS IS'' AND
+** ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+** IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+** ARE DISCLAIMED. IN NO EVENT SHALL The Android Open Source Project BE LIABLE
+** FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+** DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+** SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+** CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+** LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+** OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+** DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <limits.h>
+
+#include <tinyalsa/mixer.h>
+
+#include "fnv_hash.h"
+
+/** A control that is referenced by at least one path.
+ * The value tables are offsets into the value pool of the route.
+ */
+struct route_ctl {
+    /** The resolved mixer control */
+    struct mixer_ctl *ctl;
+    /** The type of the control, cached at compile time */
+    enum mixer_ctl_type type;
+    /** The number of values in the control */
+    unsigned int num_values;
+    /** Values read from the mixer when the route was opened */
+    unsigned int reset_values;
+    /** Values last written to the mixer */
+    unsigned int cur_values;
+    /** Values to be written by the next @ref mixer_route_update */
+    unsigned int new_values;
+};
+
+/** A single control setting of a path */
+struct route_setting {
+    /** Index of the control in the control table of the route */
+    unsigned int ctl;
+    /** Offset of the values in the value pool of the route */
+    unsigned int values;
+};
+
+/** A named list of control settings */
+struct route_path {
+    /** The name of the path */
+    char *name;
+    /** Hash of the name of the path */
+    uint32_t hash;
+    /** Index of the first setting in the setting table of the route */
+    unsigned int first_setting;
+    /** The number of settings in the path */
+    unsigned int num_settings;
+};
+
+/** A compiled set of mixer paths.
+ * @ingroup libtinyalsa-mixer
+ */
+struct mixer_route {
+    /** The mixer the paths were resolved against */
+    struct mixer *mixer;
+    /** Every control referenced by a path */
+    struct route_ctl *ctls;
+    unsigned int num_ctls;
+    /** The settings of all paths, stored path after path */
+    struct route_setting *settings;
+    unsigned int num_settings;
+    /** The paths, in the order of the file */
+    struct route_path *paths;
+    unsigned int num_paths;
+    /** All control values */
+    int *pool;
+    size_t pool_size;
+    /** Open addressed hash table of path index + 1, zero for empty */
+    unsigned int *path_table;
+    unsigned int path_table_size;
+    /** Buffer to convert values for @ref mixer_ctl_set_array */
+    void *scratch;
+};
+
+static char *route_trim(char *s)
+{
+    char *end;
+
+    while (isspace((unsigned char)*s))
+        s++;
+
+    end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1]))
+        end--;
+    *end = '\0';
+
+    return s;
+}
+
+static void *route_grow(void *ptr, unsigned int count, size_t size)
+{
+    /* arrays hold at least 16 elements and double when full */
+    if (count < 16)
+        return ptr ? ptr : malloc(16 * size);
+
+    if (count & (count - 1))
+        return ptr;
+
+    return realloc(ptr, 2 * (size_t)count * size);
+}
+
+static int route_pool_alloc(struct mixer_route *route, unsigned int count,
+                            unsigned int *offset)
+{
+    size_t capacity = 16;
+    int *pool;
+
+    while (capacity < route->pool_size + count)
+        capacity *= 2;
+
+    if (capacity > UINT_MAX)
+        return -ENOMEM;
+
+    pool = realloc(route->pool, capacity * sizeof(*pool));
+    if (!pool)
+        return -ENOMEM;
+
+    route->pool = pool;
+    *offset = route->pool_size;
+    route->pool_size += count;
+    return 0;
+}
+
+static int route_find_ctl(struct mixer_route *route, struct mixer_ctl *ctl)
+{
+    struct route_ctl *rctl;
+    unsigned int n;
+
+    for (n = 0; n < route->num_ctls; n++)
+        if (route->ctls[n].ctl == ctl)
+            return n;
+
+    rctl = route_grow(route->ctls, route->num_ctls, sizeof(*rctl));
+    if (!rctl)
+        return -ENOMEM;
+    route->ctls = rctl;
+
+    rctl += route->num_ctls;
+    memset(rctl, 0, sizeof(*rctl));
+    rctl->ctl = ctl;
+    rctl->type = mixer_ctl_get_type(ctl);
+    rctl->num_values = mixer_ctl_get_num_values(ctl);
+
+    return route->num_ctls++;
+}
+
+static int route_parse_enum(struct mixer_ctl *ctl, const char *string, int *value)
+{
+    unsigned int n, num_enums = mixer_ctl_get_num_enums(ctl);
+    const char *name;
+    char *end;
+
+    for (n = 0; n < num_enums; n++) {
+        name = mixer_ctl_get_enum_string(ctl, n);
+        if (name && !strcmp(name, string)) {
+            *value = n;
+            return 0;
+        }
+    }
+
+    /* fall back to the enumerated item number */
+    errno = 0;
+    *value = strtol(string, &end, 0);
+    if (errno || end == string || *end || *value < 0 ||
+            (unsigned int)*value >= num_enums)
+        return -EINVAL;
+
+    return 0;
+}
+
+static int route_parse_values(struct route_ctl *rctl, char *string, int *values)
+{
+    unsigned int n, count = 0;
+    char *token, *end, *save = NULL;
+    long value;
+
+    if (rctl->type == MIXER_CTL_TYPE_ENUM) {
+        if (route_parse_enum(rctl->ctl, string, values) < 0)
+            return -EINVAL;
+        count = 1;
+    } else {
+        for (token = strtok_r(string, " \t", &save); token;
+                token = strtok_r(NULL, " \t", &save)) {
+            if (count >= rctl->num_values)
+                return -EINVAL;
+            errno = 0;
+            value = strtol(token, &end, 0);
+            if (errno || *end || value < INT_MIN || value > INT_MAX)
+                return -EINVAL;
+            values[count++] = value;
+        }
+    }
+
+    /* a single value applies to every value of the control */
+    if (count == 1) {
+        for (n = 1; n < rctl->num_values; n++)
+            values[n] = values[0];
+    } else if (count != rctl->num_values) {
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int route_add_path(struct mixer_route *route, const char *name)
+{
+    struct route_path *path;
+    unsigned int n;
+
+    for (n = 0; n < route->num_paths; n++)
+        if (!strcmp(route->paths[n].name, name))
+            return -EEXIST;
+
+    path = route_grow(route->paths, route->num_paths, sizeof(*path));
+    if (!path)
+        return -ENOMEM;
+    route->paths = path;
+
+    path += route->num_paths;
+    path->name = strdup(name);
+    if (!path->name)
+        return -ENOMEM;
+    path->hash = fnv_hash(name);
+    path->first_setting = route->num_settings;
+    path->num_settings = 0;
+
+    route->num_paths++;
+    return 0;
+}
+
+static int route_add_setting(struct mixer_route *route, const char *ctl_name,
+                             char *values)
+{
+    struct route_setting *setting;
+    struct route_ctl *rctl;
+    struct mixer_ctl *ctl;
+    unsigned int offset;
+    int n, ret;
+
+    ctl = mixer_get_ctl_by_name(route->mixer, ctl_name);
+    if (!ctl) {
+        /* path files are commonly shared between board variants */
+        fprintf(stderr, "%s: unknown control '%s', ignored\n", __func__, ctl_name);
+        return 0;
+    }
+
+    switch (mixer_ctl_get_type(ctl)) {
+    case MIXER_CTL_TYPE_BOOL:
+    case MIXER_CTL_TYPE_INT:
+    case MIXER_CTL_TYPE_ENUM:
+    case MIXER_CTL_TYPE_BYTE:
+        break;
+    default:
+        fprintf(stderr, "%s: control '%s' has an unsupported type\n",
+                __func__, ctl_name);
+        return -EINVAL;
+    }
+
+    n = route_find_ctl(route, ctl);
+    if (n < 0)
+        return n;
+    rctl = &route->ctls[n];
+
+    ret = route_pool_alloc(route, rctl->num_values, &offset);
+    if (ret < 0)
+        return ret;
+
+    ret = route_parse_values(rctl, values, route->pool + offset);
+    if (ret < 0) {
+        fprintf(stderr, "%s: invalid values for control '%s'\n", __func__, ctl_name);
+        return ret;
+    }
+
+    setting = route_grow(route->settings, route->num_settings, sizeof(*setting));
+    if (!setting)
+        return -ENOMEM;
+    route->settings = setting;
+
+    setting += route->num_settings++;
+    setting->ctl = n;
+    setting->values = offset;
+    route->paths[route->num_paths - 1].num_settings++;
+
+    return 0;
+}
+
+static int route_parse(struct mixer_route *route, FILE *file, const char *file_name)
+{
+    char *line = NULL, *s, *eq, *end;
+    size_t line_size = 0;
+    unsigned int line_number = 0;
+    int ret = 0;
+
+    while (getline(&line, &line_size, file) != -1) {
+        line_number++;
+
+        s = route_trim(line);
+        if (*s == '\0' || *s == '#' || *s == ';')
+            continue;
+
+        if (*s == '[') {
+            end = strchr(s, ']');
+            if (!end || end[1] != '\0') {
+                ret = -EINVAL;
+                break;
+            }
+            *end = '\0';
+            ret = route_add_path(route, route_trim(s + 1));
+        } else {
+            eq = strchr(s, '=');
+            if (!eq || !route->num_paths) {
+                ret = -EINVAL;
+                break;
+            }
+            *eq = '\0';
+            ret = route_add_setting(route, route_trim(s), route_trim(eq + 1));
+        }
+
+        if (ret < 0)
+            break;
+    }
+
+    if (ret < 0)
+        fprintf(stderr, "%s:%u: %s\n", file_name, line_number,
+                ret == -EEXIST ? "duplicate path" : "invalid line");
+
+    free(line);
+    return ret;
+}
+
+static int route_build_path_table(struct mixer_route *route)
+{
+    unsigned int n, slot, size = 1;
+
+    while (size < 2 * route->num_paths)
+        size *= 2;
+
+    route->path_table = calloc(size, sizeof(*route->path_table));
+    if (!route->path_table)
+        return -ENOMEM;
+    route->path_table_size = size;
+
+    for (n = 0; n < route->num_paths; n++) {
+        slot = route->paths[n].hash & (size - 1);
+        while (route->path_table[slot])
+            slot = (slot + 1) & (size - 1);
+        route->path_table[slot] = n + 1;
+    }
+
+    return 0;
+}
+
+static size_t route_value_size(enum mixer_ctl_type type)
+{
+    switch (type) {
+    case MIXER_CTL_TYPE_BOOL:
+    case MIXER_CTL_TYPE_INT:
+        return sizeof(long);
+    case MIXER_CTL_TYPE_ENUM:
+        return sizeof(unsigned int);
+    default:
+        return sizeof(unsigned char);
+    }
+}
+
+static void route_values_from_array(enum mixer_ctl_type type, const void *array,
+                                    int *values, unsigned int count)
+{
+    unsigned int n;
+
+    for (n = 0; n < count; n++) {
+        switch (type) {
+        case MIXER_CTL_TYPE_BOOL:
+        case MIXER_CTL_TYPE_INT:
+            values[n] = ((const long *)array)[n];
+            break;
+        case MIXER_CTL_TYPE_ENUM:
+            values[n] = ((const unsigned int *)array)[n];
+            break;
+        default:
+            values[n] = ((const unsigned char *)array)[n];
+            break;
+        }
+    }
+}
+
+static void route_values_to_array(enum mixer_ctl_type type, const int *values,
+                                  void *array, unsigned int count)
+{
+    unsigned int n;
+
+    for (n = 0; n < count; n++) {
+        switch (type) {
+        case MIXER_CTL_TYPE_BOOL:
+        case MIXER_CTL_TYPE_INT:
+            ((long *)array)[n] = values[n];
+            break;
+        case MIXER_CTL_TYPE_ENUM:
+            ((unsigned int *)array)[n] = values[n];
+            break;
+        default:
+            ((unsigned char *)array)[n] = values[n];
+            break;
+        }
+    }
+}
+
+/* Reads the current state of every referenced control, which becomes both
+ * the reset state and what the route assumes the mixer holds.
+ */
+static int route_init_values(struct mixer_route *route)
+{
+    struct route_ctl *rctl;
+    unsigned int n, offset;
+    size_t size, max_size = 0;
+    int ret;
+
+    for (n = 0; n < route->num_ctls; n++) {
+        rctl = &route->ctls[n];
+        size = route_value_size(rctl->type) * rctl->num_values;
+        if (size > max_size)
+            max_size = size;
+    }
+
+    route->scratch = calloc(1, max_size ? max_size : 1);
+    if (!route->scratch)
+        return -ENOMEM;
+
+    for (n = 0; n < route->num_ctls; n++) {
+        rctl = &route->ctls[n];
+
+        ret = route_pool_alloc(route, 3 * rctl->num_values, &offset);
+        if (ret < 0)
+            return ret;
+        rctl->reset_values = offset;
+        rctl->cur_values = offset + rctl->num_values;
+        rctl->new_values = offset + 2 * rctl->num_values;
+
+        size = route_value_size(rctl->type) * rctl->num_values;
+        memset(route->scratch, 0, size);
+        if (mixer_ctl_get_array(rctl->ctl, route->scratch, rctl->num_values) < 0)
+            fprintf(stderr, "%s: failed to read control '%s'\n", __func__,
+                    mixer_ctl_get_name(rctl->ctl));
+
+        route_values_from_array(rctl->type, route->scratch,
+                                route->pool + rctl->reset_values, rctl->num_values);
+        memcpy(route->pool + rctl->cur_values, route->pool + rctl->reset_values,
+               rctl->num_values * sizeof(int));
+        memcpy(route->pool + rctl->new_values, route->pool + rctl->reset_values,
+               rctl->num_values * sizeof(int));
+    }
+
+    return 0;
+}
+
+/** Closes a route returned by @ref mixer_route_open.
+ * @param route A route handle. May be NULL.
+ * @ingroup libtinyalsa-mixer
+ */
+void mixer_route_close(struct mixer_route *route)
+{
+    unsigned int n;
+
+    if (!route)
+        return;
+
+    for (n = 0; n < route->num_paths; n++)
+        free(route->paths[n].name);
+
+    free(route->paths);
+    free(route->settings);
+    free(route->ctls);
+    free(route->pool);
+    free(route->path_table);
+    free(route->scratch);
+    free(route);
+}
+
+/** Compiles the mixer paths of a file into a route.
+ * The file lists named paths, each followed by the control settings of the path:
+ * @code
+ * # comment
+ * [speaker]
+ * Speaker Switch = 1
+ * RX1 Digital Volume = 84 84
+ * SLIM RX1 MUX = AIF1_PB
+ * @endcode
+ * A single value is applied to every value of a control.
+ * Enumerated controls take the string of an item, or its number.
+ * Control names are resolved and values are parsed once, here,
+ * and controls that do not exist on the card are ignored.
+ * The current values of the referenced controls are read and become the reset state.
+ * The mixer must outlive the route.
+ * @param mixer An initialized mixer handle.
+ * @param file_name The path of the file describing the mixer paths.
+ * @returns A route handle on success, NULL on failure.
+ * @ingroup libtinyalsa-mixer
+ */
+struct mixer_route *mixer_route_open(struct mixer *mixer, const char *file_name)
+{
+    struct mixer_route *route;
+    FILE *file;
+    int ret;
+
+    if (!mixer || !file_name)
+        return NULL;
+
+    file = fopen(file_name, "r");
+    if (!file) {
+        fprintf(stderr, "%s: unable to open %s\n", __func__, file_name);
+        return NULL;
+    }
+
+    route = calloc(1, sizeof(*route));
+    if (!route)
+        goto err_close_file;
+    route->mixer = mixer;
+
+    ret = route_parse(route, file, file_name);
+    if (ret < 0)
+        goto err_free_route;
+
+    ret = route_build_path_table(route);
+    if (ret < 0)
+        goto err_free_route;
+
+    ret = route_init_values(route);
+    if (ret < 0)
+        goto err_free_route;
+
+    fclose(file);
+    return route;
+
+err_free_route:
+    mixer_route_close(route);
+err_close_file:
+    fclose(file);
+    return NULL;
+}
+
+static struct route_path *route_get_path(struct mixer_route *route, const char *name)
+{
+    struct route_path *path;
+    uint32_t hash = fnv_hash(name);
+    unsigned int slot, mask = route->path_table_size - 1;
+
+    for (slot = hash & mask; route->path_table[slot]; slot = (slot + 1) & mask) {
+        path = &route->paths[route->path_table[slot] - 1];
+        if (path->hash == hash && !strcmp(path->name, name))
+            return path;
+    }
+
+    return NULL;
+}
+
+/** Gets the number of paths of a route.
+ * @param route A route handle.
+ * @returns The number of paths compiled into the route.
+ * @ingroup libtinyalsa-mixer
+ */
+unsigned int mixer_route_get_num_paths(const struct mixer_route *route)
+{
+    if (!route)
+        return 0;
+
+    return route->num_paths;
+}
+
+/** Gets the name of a path of a route.
+ * @param route A route handle.
+ * @param id The index of the path, in the order of the file.
+ * @returns The name of the path, or NULL if @p id is out of range.
+ * @ingroup libtinyalsa-mixer
+ */
+const char *mixer_route_get_path_name(const struct mixer_route *route, unsigned int id)
+{
+    if (!route || id >= route->num_paths)
+        return NULL;
+
+    return route->paths[id].name;
+}
+
+/** Stages the settings of a path.
+ * Nothing is written to the mixer until @ref mixer_route_update is called.
+ * Paths applied later override the settings of paths applied earlier.
+ * @param route A route handle.
+ * @param name The name of the path.
+ * @returns On success, zero. If the path does not exist, -EINVAL.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_route_apply_path(struct mixer_route *route, const char *name)
+{
+    struct route_setting *setting;
+    struct route_path *path;
+    struct route_ctl *rctl;
+    unsigned int n;
+
+    if (!route || !name)
+        return -EINVAL;
+
+    path = route_get_path(route, name);
+    if (!path)
+        return -EINVAL;
+
+    for (n = 0; n < path->num_settings; n++) {
+        setting = &route->settings[path->first_setting + n];
+        rctl = &route->ctls[setting->ctl];
+        memcpy(route->pool + rctl->new_values, route->pool + setting->values,
+               rctl->num_values * sizeof(int));
+    }
+
+    return 0;
+}
+
+/** Stages the reset state of every control referenced by a path.
+ * Nothing is written to the mixer until @ref mixer_route_update is called.
+ * @param route A route handle.
+ * @param name The name of the path.
+ * @returns On success, zero. If the path does not exist, -EINVAL.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_route_reset_path(struct mixer_route *route, const char *name)
+{
+    struct route_setting *setting;
+    struct route_path *path;
+    struct route_ctl *rctl;
+    unsigned int n;
+
+    if (!route || !name)
+        return -EINVAL;
+
+    path = route_get_path(route, name);
+    if (!path)
+        return -EINVAL;
+
+    for (n = 0; n < path->num_settings; n++) {
+        setting = &route->settings[path->first_setting + n];
+        rctl = &route->ctls[setting->ctl];
+        memcpy(route->pool + rctl->new_values, route->pool + rctl->reset_values,
+               rctl->num_values * sizeof(int));
+    }
+
+    return 0;
+}
+
+/** Stages the reset state of every control of a route.
+ * Nothing is written to the mixer until @ref mixer_route_update is called.
+ * @param route A route handle.
+ * @ingroup libtinyalsa-mixer
+ */
+void mixer_route_reset(struct mixer_route *route)
+{
+    struct route_ctl *rctl;
+    unsigned int n;
+
+    if (!route)
+        return;
+
+    for (n = 0; n < route->num_ctls; n++) {
+        rctl = &route->ctls[n];
+        memcpy(route->pool + rctl->new_values, route->pool + rctl->reset_values,
+               rctl->num_values * sizeof(int));
+    }
+}
+
+/** Writes the staged settings to the mixer.
+ * Only controls whose staged values differ from the values last written
+ * by the route are written, with one write per control.
+ * The route assumes that it is the only writer of its controls.
+ * @param route A route handle.
+ * @returns On success, the number of controls written.
+ *  On failure, a negative errno value. Controls that failed to be written
+ *  are retried on the next update.
+ * @ingroup libtinyalsa-mixer
+ */
+int mixer_route_update(struct mixer_route *route)
+{
+    struct route_ctl *rctl;
+    unsigned int n;
+    int *cur, *new;
+    int ret = 0, count = 0;
+
+    if (!route)
+        return -EINVAL;
+
+    for (n = 0; n < route->num_ctls; n++) {
+        rctl = &route->ctls[n];
+        cur = route->pool + rctl->cur_values;
+        new = route->pool + rctl->new_values;
+
+        if (!memcmp(cur, new, rctl->num_values * sizeof(int)))
+            continue;
+
+        route_values_to_array(rctl->type, new, route->scratch, rctl->num_values);
+        if (mixer_ctl_set_array(rctl->ctl, route->scratch, rctl->num_values) < 0) {
+            fprintf(stderr, "%s: failed to write control '%s'\n", __func__,
+                    mixer_ctl_get_name(rctl->ctl));
+            ret = -EIO;
+            continue;
+        }
+
+        memcpy(cur, new, rctl->num_values * sizeof(int));
+        count++;
+    }
+
+    return ret < 0 ? ret : count;
+}
@@ -57,6 +57,7 @@
 
 #include <sound/asound.h>
 
+#include <tinyalsa/card.h>
 #include <tinyalsa/pcm.h>
 #include <tinyalsa/limits.h>
 #include "pcm_io.h"
@@ -1003,6 +1004,7 @@ int pcm_close(struct pcm *pcm)
 /** Opens a PCM by it's name.
  * @param name The name of the PCM.
  *  The name is given in the format: <i>hw</i>:<b>card</b>,<b>device</b>
+ *  The card may be given by number or by identifier, see @ref card_get_index.
  * @param flags Specify characteristics and functionality about the pcm.
  *  May be a bitwise AND of the following:
  *   - @ref PCM_IN
@@ -1022,14 +1024,37 @@ struct pcm *pcm_open_by_name(const char *name,
                              unsigned int flags,
                              const struct pcm_config *config)
 {
-    unsigned int card, device;
+    char card_name[32];
+    unsigned int device;
+    const char *comma;
+    int card;
+
     if (name[0] != 'h' || name[1] != 'w' || name[2] != ':') {
         oops(&bad_pcm, 0, "name format is not matched");
         return &bad_pcm;
-    } else if (sscanf(&name[3], "%u,%u", &card, &device) != 2) {
+    }
+
+    comma = strchr(&name[3], ',');
+    if (!comma || (size_t)(comma - &name[3]) >= sizeof(card_name)) {
         oops(&bad_pcm, 0, "name format is not matched");
         return &bad_pcm;
     }
+    memcpy(card_name, &name[3], comma - &name[3]);
+    card_name[comma - &name[3]] = '\0';
+
+    if (!strncmp(comma + 1, "DEV=", 4))
+        comma += 4;
+    if (sscanf(comma + 1, "%u", &device) != 1) {
+        oops(&bad_pcm, 0, "name format is not matched");
+        return &bad_pcm;
+    }
+
+    card = card_get_index(card_name);
+    if (card < 0) {
+        oops(&bad_pcm, -card, "no card named %s", card_name);
+        return &bad_pcm;
+    }
+
     return pcm_open(card, device, flags, config);
 }
 
@@ -1073,6 +1098,7 @@ struct pcm *pcm_open(unsigned int card, unsigned int device,
 #ifdef TINYALSA_USES_PLUGINS
     if (pcm->fd < 0) {
         int pcm_type;
+        char *chain;
         pcm->snd_node = snd_utils_open_pcm(card, device);
         pcm_type = snd_utils_get_node_type(pcm->snd_node);
         if (!pcm->snd_node || pcm_type != SND_NODE_TYPE_PLUGIN) {
@@ -1080,7 +1106,11 @@ struct pcm *pcm_open(unsigned int card, unsigned int device,
                  card, device);
             goto fail_close_dev_node;
         }
-        pcm->ops = &plug_ops;
+        /* devices with a "chain" of stages are stacked on another PCM */
+        if (snd_utils_get_str(pcm->snd_node, "chain", &chain))
+            pcm->ops = &plug_ops;
+        else
+            pcm->ops = &chain_ops;
         pcm->fd = pcm->ops->open(card, device, flags, &pcm->data, pcm->snd_node);
     }
 #endif
@@ -1388,11 +1418,62 @@ static int pcm_mmap_transfer_areas(struct pcm *pcm, char *buf,
     return count;
 }
 
+/** Gets the file descriptor to poll for the PCM to be ready.
+ * For plugin PCMs, this is an eventfd that only becomes readable,
+ * see @ref pcm_poll_descriptor.
+ * @param pcm A PCM handle.
+ * @return The file descriptor to poll.
+ * @ingroup libtinyalsa-pcm
+ */
 int pcm_get_poll_fd(struct pcm *pcm)
 {
     return pcm->fd;
 }
 
+/** Gets the descriptor to poll for the PCM to be ready, along with the events
+ * to poll it for. The descriptor can be polled with other descriptors, in the
+ * same poll() or epoll set, and its events translated with @ref pcm_poll_revents.
+ * @param pcm A PCM handle.
+ * @param pfd The descriptor to fill.
+ * @return Zero on success, a negative errno value on failure.
+ * @ingroup libtinyalsa-pcm
+ */
+int pcm_poll_descriptor(struct pcm *pcm, struct pollfd *pfd)
+{
+    if (!pcm_is_ready(pcm) || !pfd)
+        return -EINVAL;
+
+    pfd->fd = pcm->fd;
+    pfd->events = pcm->flags & PCM_IN ? POLLIN : POLLOUT;
+    pfd->revents = 0;
+
+    if (pcm->ops->poll_descriptor)
+        pcm->ops->poll_descriptor(pcm->data, pfd);
+
+    return 0;
+}
+
+/** Translates the events polled on the descriptor of @ref pcm_poll_descriptor.
+ * @param pcm A PCM handle.
+ * @param pfd The descriptor, with the events it was polled with.
+ * @param revents Set to POLLOUT or POLLIN once frames can be written or read,
+ *  along with POLLERR if the PCM is not prepared or running, or to zero if
+ *  the descriptor should be polled again.
+ * @return Zero on success, a negative errno value on failure.
+ * @ingroup libtinyalsa-pcm
+ */
+int pcm_poll_revents(struct pcm *pcm, const struct pollfd *pfd, short *revents)
+{
+    if (!pcm_is_ready(pcm) || !pfd || !revents)
+        return -EINVAL;
+
+    if (pcm->ops->poll_revents)
+        return pcm->ops->poll_revents(pcm->data, pfd, revents);
+
+    *revents = pfd->revents;
+    return 0;
+}
+
 int pcm_avail_update(struct pcm *pcm)
 {
     pcm_sync_ptr(pcm, SNDRV_PCM_SYNC_PTR_APPL|SNDRV_PCM_SYNC_PTR_AVAIL_MIN);
@@ -0,0 +1,474 @@
+/* pcm_chain.c
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are met:
+**     * Redistributions of source code must retain the above copyright
+**       notice, this list of conditions and the following disclaimer.
+**     * Redistributions in binary form must reproduce the above copyright
+**       notice, this list of conditions and the following disclaimer in the
+**       documentation and/or other materials provided with the distribution.
+**     * Neither the name of The Android Open Source Project nor the names of
+**       its contributors may be used to endorse or promote products derived
+**       from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY The Android Open Source Project ``AS IS'' AND
+** ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+** IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+** ARE DISCLAIMED. IN NO EVENT SHALL The Android Open Source Project BE LIABLE
+** FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+** DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+** SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+** CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+** LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+** OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+** DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <dlfcn.h>
+#include <sys/ioctl.h>
+#include <linux/ioctl.h>
+
+#include <sound/asound.h>
+#include <tinyalsa/pcm.h>
+#include <tinyalsa/plugin.h>
+
+#include "pcm_io.h"
+#include "snd_card_plugin.h"
+
+#define PCM_CHAIN_MAX_STAGES 8
+/* Chains stacked deeper on one another are taken for a loop */
+#define PCM_CHAIN_MAX_DEPTH 8
+
+/* Whether the stage operations provide the given operation */
+#define PCM_CHAIN_HAS_STAGE_OP(ops, op)                                  \
+    ((ops)->size >= offsetof(struct pcm_plugin_stage_ops, op) +          \
+     sizeof((ops)->op) && (ops)->op)
+
+struct pcm_chain_stage {
+    void *dl_hdl;
+    const struct pcm_plugin_stage_ops *ops;
+    void *stage;
+};
+
+struct pcm_chain_data {
+    /** The PCM the chain is stacked on */
+    const struct pcm_ops *ops;
+    void *data;
+    struct snd_node *node;
+    unsigned int flags;
+    /** The number of chains this one is stacked under */
+    unsigned int depth;
+    struct pcm_chain_stage stages[PCM_CHAIN_MAX_STAGES];
+    unsigned int num_stages;
+    /** Holds the frames to play while the stages process them */
+    char *buf;
+    unsigned int buf_frames;
+    unsigned int frame_bytes;
+};
+
+static unsigned int pcm_chain_param_get(struct snd_pcm_hw_params *p,
+                                        unsigned int param)
+{
+    return p->intervals[param - SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].min;
+}
+
+static void pcm_chain_close_stages(struct pcm_chain_data *chain)
+{
+    struct pcm_chain_stage *stage;
+
+    while (chain->num_stages) {
+        stage = &chain->stages[--chain->num_stages];
+        stage->ops->close(stage->stage);
+        snd_utils_close_plugin(stage->dl_hdl);
+    }
+}
+
+static int pcm_chain_open_stage(struct pcm_chain_data *chain, struct snd_node *node,
+                const char *so_name, unsigned int card, unsigned int device)
+{
+    struct pcm_chain_stage *stage = &chain->stages[chain->num_stages];
+    int rc;
+
+    if (chain->num_stages == PCM_CHAIN_MAX_STAGES) {
+        fprintf(stderr, "%s: more than %d stages\n", __func__, PCM_CHAIN_MAX_STAGES);
+        return -E2BIG;
+    }
+
+    stage->dl_hdl = snd_utils_open_plugin(node, so_name);
+    if (!stage->dl_hdl) {
+        fprintf(stderr, "%s: unable to open %s\n", __func__, so_name);
+        return -ENOENT;
+    }
+
+    stage->ops = dlsym(stage->dl_hdl, "pcm_plugin_stage_ops");
+    if (!stage->ops || !PCM_CHAIN_HAS_STAGE_OP(stage->ops, process) ||
+        !stage->ops->open || !stage->ops->close) {
+        fprintf(stderr, "%s: no stage operations in %s\n", __func__, so_name);
+        rc = -EINVAL;
+        goto err_ops;
+    }
+
+    rc = stage->ops->open(&stage->stage, card, device, chain->flags);
+    if (rc) {
+        fprintf(stderr, "%s: failed to open stage %s: %d\n", __func__, so_name, rc);
+        goto err_ops;
+    }
+
+    chain->num_stages++;
+    return 0;
+
+err_ops:
+    snd_utils_close_plugin(stage->dl_hdl);
+    return rc;
+}
+
+static int pcm_chain_open_stages(struct pcm_chain_data *chain, struct snd_node *node,
+                const char *stages, unsigned int card, unsigned int device)
+{
+    char *names, *name, *saveptr;
+    int rc = 0;
+
+    names = strdup(stages);
+    if (!names)
+        return -ENOMEM;
+
+    for (name = strtok_r(names, ", ", &saveptr); name;
+         name = strtok_r(NULL, ", ", &saveptr)) {
+        rc = pcm_chain_open_stage(chain, node, name, card, device);
+        if (rc) {
+            pcm_chain_close_stages(chain);
+            break;
+        }
+    }
+
+    free(names);
+    return rc;
+}
+
+static int pcm_chain_open_nested(unsigned int card, unsigned int device,
+                unsigned int flags, void **data, struct snd_node *node,
+                unsigned int depth);
+
+/* Opens the PCM the chain is stacked on, the same way pcm_open() does */
+static int pcm_chain_open_slave(struct pcm_chain_data *chain, unsigned int card,
+                unsigned int device, unsigned int flags)
+{
+    char *stages;
+    int fd;
+
+    chain->ops = &hw_ops;
+    fd = chain->ops->open(card, device, flags, &chain->data, NULL);
+    if (fd >= 0)
+        return fd;
+
+    chain->node = snd_utils_open_pcm(card, device);
+    if (!chain->node || snd_utils_get_node_type(chain->node) != SND_NODE_TYPE_PLUGIN) {
+        fprintf(stderr, "%s: no device (hw/plugin) for card(%u), device(%u)\n",
+                __func__, card, device);
+        fd = -ENODEV;
+        goto err_node;
+    }
+
+    if (snd_utils_get_str(chain->node, "chain", &stages)) {
+        chain->ops = &plug_ops;
+        fd = chain->ops->open(card, device, flags, &chain->data, chain->node);
+    } else {
+        chain->ops = &chain_ops;
+        fd = pcm_chain_open_nested(card, device, flags, &chain->data, chain->node,
+                                   chain->depth + 1);
+    }
+    if (fd >= 0)
+        return fd;
+
+err_node:
+    snd_utils_close_dev_node(chain->node);
+    chain->node = NULL;
+    return fd;
+}
+
+static void pcm_chain_close(void *data)
+{
+    struct pcm_chain_data *chain = data;
+
+    chain->ops->close(chain->data);
+    snd_utils_close_dev_node(chain->node);
+    pcm_chain_close_stages(chain);
+
+    free(chain->buf);
+    free(chain);
+}
+
+static int pcm_chain_open_nested(unsigned int card, unsigned int device,
+                unsigned int flags, void **data, struct snd_node *node,
+                unsigned int depth)
+{
+    struct pcm_chain_data *chain;
+    int slave_card, slave_device;
+    char *stages;
+    int fd, rc;
+
+    /* mmapped frames do not go through the stages */
+    if (flags & PCM_MMAP) {
+        fprintf(stderr, "%s: plugin chains cannot be mmapped\n", __func__);
+        return -EINVAL;
+    }
+
+    if (snd_utils_get_str(node, "chain", &stages) ||
+        snd_utils_get_int(node, "slave-card", &slave_card) ||
+        snd_utils_get_int(node, "slave-device", &slave_device) ||
+        slave_card < 0 || slave_device < 0) {
+        fprintf(stderr, "%s: incomplete chain for card(%u), device(%u)\n",
+                __func__, card, device);
+        return -EINVAL;
+    }
+
+    if ((unsigned int) slave_card == card && (unsigned int) slave_device == device) {
+        fprintf(stderr, "%s: card(%u), device(%u) is chained on itself\n",
+                __func__, card, device);
+        return -ELOOP;
+    }
+
+    if (depth >= PCM_CHAIN_MAX_DEPTH) {
+        fprintf(stderr, "%s: card(%u), device(%u) is chained in a loop\n",
+                __func__, card, device);
+        return -ELOOP;
+    }
+
+    chain = calloc(1, sizeof(*chain));
+    if (!chain)
+        return -ENOMEM;
+
+    chain->flags = flags;
+    chain->depth = depth;
+
+    rc = pcm_chain_open_stages(chain, node, stages, card, device);
+    if (rc)
+        goto err_stages;
+
+    /* transfers block until the slave takes all the processed frames */
+    fd = pcm_chain_open_slave(chain, slave_card, slave_device, flags & ~PCM_NONBLOCK);
+    if (fd < 0) {
+        rc = fd;
+        goto err_slave;
+    }
+
+    *data = chain;
+    return fd;
+
+err_slave:
+    pcm_chain_close_stages(chain);
+err_stages:
+    free(chain);
+    return rc;
+}
+
+static int pcm_chain_open(unsigned int card, unsigned int device,
+                unsigned int flags, void **data, struct snd_node *node)
+{
+    return pcm_chain_open_nested(card, device, flags, data, node, 0);
+}
+
+static int pcm_chain_hw_params(struct pcm_chain_data *chain,
+                struct snd_pcm_hw_params *params)
+{
+    struct pcm_chain_stage *stage;
+    unsigned int n;
+    int rc;
+
+    chain->frame_bytes = pcm_chain_param_get(params, SNDRV_PCM_HW_PARAM_FRAME_BITS) / 8;
+    chain->buf_frames = pcm_chain_param_get(params, SNDRV_PCM_HW_PARAM_PERIOD_SIZE);
+    if (!chain->frame_bytes || !chain->buf_frames)
+        return -EINVAL;
+
+    if (!(chain->flags & PCM_IN)) {
+        free(chain->buf);
+        chain->buf = calloc(chain->buf_frames, chain->frame_bytes);
+        if (!chain->buf)
+            return -ENOMEM;
+    }
+
+    for (n = 0; n < chain->num_stages; n++) {
+        stage = &chain->stages[n];
+        if (!PCM_CHAIN_HAS_STAGE_OP(stage->ops, hw_params))
+            continue;
+        rc = stage->ops->hw_params(stage->stage, params);
+        if (rc)
+            return rc;
+    }
+
+    return 0;
+}
+
+static void pcm_chain_reset(struct pcm_chain_data *chain)
+{
+    struct pcm_chain_stage *stage;
+    unsigned int n;
+
+    for (n = 0; n < chain->num_stages; n++) {
+        stage = &chain->stages[n];
+        if (PCM_CHAIN_HAS_STAGE_OP(stage->ops, reset))
+            stage->ops->reset(stage->stage);
+    }
+}
+
+/* Plays the frames through the stages, a period at a time */
+static int pcm_chain_writei(struct pcm_chain_data *chain, struct snd_xferi *x)
+{
+    struct pcm_chain_stage *stage;
+    const char *src = x->buf;
+    struct snd_xferi xfer;
+    unsigned int n, frames, sent, done = 0;
+    int rc = 0;
+
+    if (!chain->buf)
+        return -EBADFD;
+
+    while (done < x->frames) {
+        frames = x->frames - done;
+        if (frames > chain->buf_frames)
+            frames = chain->buf_frames;
+
+        /* the stages process the frames in place, without copying them again */
+        memcpy(chain->buf, src + done * chain->frame_bytes, frames * chain->frame_bytes);
+        for (n = 0; n < chain->num_stages; n++) {
+            stage = &chain->stages[n];
+            rc = stage->ops->process(stage->stage, chain->buf, frames);
+            if (rc)
+                goto exit;
+        }
+
+        for (sent = 0; sent < frames; sent += xfer.result) {
+            xfer.buf = chain->buf + sent * chain->frame_bytes;
+            xfer.frames = frames - sent;
+            xfer.result = 0;
+            rc = chain->ops->ioctl(chain->data, SNDRV_PCM_IOCTL_WRITEI_FRAMES, &xfer);
+            if (!rc && !xfer.result)
+                rc = -EIO;
+            if (rc) {
+                /* the frames the slave took are played, as those of the hw path */
+                done += sent;
+                goto exit;
+            }
+        }
+
+        done += frames;
+    }
+
+exit:
+    x->result = done;
+    return done ? 0 : rc;
+}
+
+/* Captures the frames into the buffer of the caller, and processes them there */
+static int pcm_chain_readi(struct pcm_chain_data *chain, struct snd_xferi *x)
+{
+    struct pcm_chain_stage *stage;
+    unsigned int n;
+    int rc;
+
+    rc = chain->ops->ioctl(chain->data, SNDRV_PCM_IOCTL_READI_FRAMES, x);
+    if (rc || !x->result)
+        return rc;
+
+    for (n = chain->num_stages; n > 0; n--) {
+        stage = &chain->stages[n - 1];
+        rc = stage->ops->process(stage->stage, x->buf, x->result);
+        if (rc)
+            return rc;
+    }
+
+    return 0;
+}
+
+static int pcm_chain_ioctl(void *data, unsigned int cmd, ...)
+{
+    struct pcm_chain_data *chain = data;
+    va_list ap;
+    void *arg;
+    int rc;
+
+    va_start(ap, cmd);
+    arg = va_arg(ap, void *);
+    va_end(ap);
+
+    switch (cmd) {
+    case SNDRV_PCM_IOCTL_HW_PARAMS:
+        rc = chain->ops->ioctl(chain->data, cmd, arg);
+        if (!rc)
+            rc = pcm_chain_hw_params(chain, arg);
+        return rc;
+    case SNDRV_PCM_IOCTL_PREPARE:
+        rc = chain->ops->ioctl(chain->data, cmd, arg);
+        if (!rc)
+            pcm_chain_reset(chain);
+        return rc;
+    case SNDRV_PCM_IOCTL_WRITEI_FRAMES:
+        return pcm_chain_writei(chain, arg);
+    case SNDRV_PCM_IOCTL_READI_FRAMES:
+        return pcm_chain_readi(chain, arg);
+    default:
+        return chain->ops->ioctl(chain->data, cmd, arg);
+    }
+}
+
+static void *pcm_chain_mmap(void *data, void *addr, size_t length, int prot,
+                int flags, off_t offset)
+{
+    struct pcm_chain_data *chain = data;
+
+    return chain->ops->mmap(chain->data, addr, length, prot, flags, offset);
+}
+
+static int pcm_chain_munmap(void *data, void *addr, size_t length)
+{
+    struct pcm_chain_data *chain = data;
+
+    return chain->ops->munmap(chain->data, addr, length);
+}
+
+static int pcm_chain_poll(void *data, struct pollfd *pfd, nfds_t nfds, int timeout)
+{
+    struct pcm_chain_data *chain = data;
+
+    return chain->ops->poll(chain->data, pfd, nfds, timeout);
+}
+
+static void pcm_chain_poll_descriptor(void *data, struct pollfd *pfd)
+{
+    struct pcm_chain_data *chain = data;
+
+    if (chain->ops->poll_descriptor)
+        chain->ops->poll_descriptor(chain->data, pfd);
+}
+
+static int pcm_chain_poll_revents(void *data, const struct pollfd *pfd,
+                short *revents)
+{
+    struct pcm_chain_data *chain = data;
+
+    if (chain->ops->poll_revents)
+        return chain->ops->poll_revents(chain->data, pfd, revents);
+
+    *revents = pfd->revents;
+    return 0;
+}
+
+const struct pcm_ops chain_ops = {
+    .open = pcm_chain_open,
+    .close = pcm_chain_close,
+    .ioctl = pcm_chain_ioctl,
+    .mmap = pcm_chain_mmap,
+    .munmap = pcm_chain_munmap,
+    .poll = pcm_chain_poll,
+    .poll_descriptor = pcm_chain_poll_descriptor,
+    .poll_revents = pcm_chain_poll_revents,
+};
@@ -44,9 +44,14 @@ struct pcm_ops {
                    off_t offset);
     int (*munmap) (void *data, void *addr, size_t length);
     int (*poll) (void *data, struct pollfd *pfd, nfds_t nfds, int timeout);
+    /** Sets the events to poll the fd for, when it is not the one of a device */
+    void (*poll_descriptor) (void *data, struct pollfd *pfd);
+    /** Translates the events polled on the fd, when it is not the one of a device */
+    int (*poll_revents) (void *data, const struct pollfd *pfd, short *revents);
 };
 
 extern const struct pcm_ops hw_ops;
 extern const struct pcm_ops plug_ops;
+extern const struct pcm_ops chain_ops;
 
 #endif /* TINYALSA_SRC_PCM_IO_H */
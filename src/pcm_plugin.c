@@ -29,16 +29,22 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <limits.h>
 #include <fcntl.h>
 #include <stdarg.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
 #include <poll.h>
+#include <pthread.h>
 #include <dlfcn.h>
 
 #include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
 #include <linux/ioctl.h>
 #include <time.h>
 #include <sound/asound.h>
@@ -56,6 +62,11 @@
 #define PCM_PARAM_GET_MASK(p, n)    \
     &p->masks[n - SNDRV_PCM_HW_PARAM_FIRST_MASK];
 
+/* Whether the optional plugin operations provide the given operation */
+#define PCM_PLUG_HAS_EXT_OP(ext, op)                                    \
+    ((ext) && (ext)->size >= offsetof(struct pcm_plugin_ext_ops, op) +   \
+     sizeof((ext)->op) && (ext)->op)
+
 enum {
     PCM_PLUG_HW_PARAM_SELECT_MIN,
     PCM_PLUG_HW_PARAM_SELECT_MAX,
@@ -69,6 +80,47 @@ enum {
     PCM_PLUG_STATE_RUNNING,
 };
 
+/** Runs the transfers of a plugin with blocking transfer calls on a
+ * worker thread, through a bounded queue of frames.
+ */
+struct pcm_plug_async {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    /** Wakes up the worker when there are frames to transfer */
+    pthread_cond_t work;
+    /** Signalled by the worker when frames have been transferred */
+    pthread_cond_t done;
+    /** The event fd of the stream, readable while the caller can
+     *  transfer avail_min frames */
+    int event_fd;
+    int ready;
+    int playback;
+    char *buf;
+    unsigned int frame_bytes;
+    /** The size of the queue, in frames */
+    unsigned int capacity;
+    /** The oldest frame of the queue */
+    unsigned int head;
+    /** The frames in the queue, including those the worker transfers */
+    unsigned int count;
+    /** The frames the worker transfers at once, a period */
+    unsigned int chunk;
+    unsigned int avail_min;
+    /** The frames transferred by the caller, modulo the boundary */
+    unsigned long appl_ptr;
+    /** The delay of the plugin, after the last transfer of the worker */
+    snd_pcm_sframes_t plugin_delay;
+    /** Changes when the queue is flushed, to discard transfers in flight */
+    unsigned int seq;
+    /** Whether the worker is transferring frames */
+    int busy;
+    /** Whether the plugin is prepared or running */
+    int active;
+    /** The error of the last transfer of the worker */
+    int error;
+    int closing;
+};
+
 struct pcm_plug_data {
     unsigned int card;
     unsigned int device;
@@ -78,8 +130,35 @@ struct pcm_plug_data {
     void *dl_hdl;
     /** pointer to plugin operation */
     const struct pcm_plugin_ops *ops;
+    /** pointer to the optional plugin operations, or NULL */
+    const struct pcm_plugin_ext_ops *ext_ops;
     struct pcm_plugin *plugin;
     void *dev_node;
+    /** Whether the plugin is asked for shared status and control pages */
+    int shared_ptrs;
+    /** The status page shared by the plugin, or NULL */
+    struct snd_pcm_mmap_status *status;
+    /** The control page shared by the plugin, or NULL */
+    struct snd_pcm_mmap_control *control;
+    /** The constraints of the plugin, computed once when it is opened */
+    struct snd_pcm_hw_params constraints;
+    /** The discrete constraints of the plugin, or NULL */
+    const struct pcm_plugin_hw_lists *lists;
+    /** Readable when the stream may be ready, returned as its fd */
+    int event_fd;
+    /** Whether the plugin signals the event fd when the stream progresses */
+    int has_events;
+    /** Whether the event fd is a timer instead, expiring each period */
+    int has_timer;
+    /** The time of a period, once hardware parameters are set */
+    struct timespec period;
+    unsigned int buffer_size;
+    unsigned long boundary;
+    unsigned int avail_min;
+    /** The size of the asynchronous transfer queue, 0 to transfer directly */
+    unsigned int async_frames;
+    /** The asynchronous transfer queue, once hardware parameters are set */
+    struct pcm_plug_async *async;
 };
 
 static unsigned int param_list[] = {
@@ -108,14 +187,413 @@ static int convert_plugin_to_pcm_state(int plugin_state)
     return PCM_STATE_OPEN;
 }
 
+/* Makes the timer readable at once, then each period while the stream runs */
+static void pcm_plug_arm_timer(struct pcm_plug_data *plug_data)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_nsec = 1;
+    if (plug_data->plugin->state == PCM_PLUG_STATE_RUNNING)
+        its.it_interval = plug_data->period;
+
+    timerfd_settime(plug_data->event_fd, 0, &its, NULL);
+}
+
+/* Makes the event fd readable, until the stream is found not to be ready */
+static void pcm_plug_signal(struct pcm_plug_data *plug_data)
+{
+    if (plug_data->has_timer)
+        pcm_plug_arm_timer(plug_data);
+    else
+        eventfd_write(plug_data->event_fd, 1);
+}
+
+/* Makes the event fd unreadable, returns whether it was readable */
+static int pcm_plug_consume(struct pcm_plug_data *plug_data)
+{
+    eventfd_t val;
+    uint64_t ticks;
+
+    /* whether the timer expired matters, not how many times */
+    if (plug_data->has_timer)
+        return read(plug_data->event_fd, &ticks, sizeof(ticks)) == sizeof(ticks);
+
+    return !eventfd_read(plug_data->event_fd, &val);
+}
+
+/* Sets the plugin state, also in the shared status page the core reads it from */
+static void pcm_plug_set_state(struct pcm_plug_data *plug_data, unsigned int state)
+{
+    plug_data->plugin->state = state;
+    if (plug_data->status)
+        plug_data->status->state = convert_plugin_to_pcm_state(state);
+
+    /* the stream is checked again in its new state */
+    if (plug_data->has_timer)
+        pcm_plug_arm_timer(plug_data);
+}
+
+static unsigned int pcm_plug_param_get(struct snd_pcm_hw_params *p,
+                                       unsigned int param)
+{
+    return p->intervals[param - SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].min;
+}
+
+static unsigned int pcm_plug_async_avail(struct pcm_plug_async *a)
+{
+    return a->playback ? a->capacity - a->count : a->count;
+}
+
+/* Keeps the event fd readable for as long as the caller can make progress */
+static void pcm_plug_async_update_ready(struct pcm_plug_async *a)
+{
+    eventfd_t val;
+    int ready = a->error || !a->active ||
+                pcm_plug_async_avail(a) >= a->avail_min;
+
+    if (ready == a->ready)
+        return;
+
+    if (ready)
+        eventfd_write(a->event_fd, 1);
+    else
+        eventfd_read(a->event_fd, &val);
+    a->ready = ready;
+}
+
+/* Discards the queued frames, and the frames the worker transfers */
+static void pcm_plug_async_flush(struct pcm_plug_async *a)
+{
+    a->head = 0;
+    a->count = 0;
+    a->error = 0;
+    a->plugin_delay = 0;
+    a->seq++;
+    pthread_cond_broadcast(&a->done);
+}
+
+static void *pcm_plug_async_thread(void *arg)
+{
+    struct pcm_plug_data *plug_data = arg;
+    struct pcm_plug_async *a = plug_data->async;
+    struct pcm_plugin *plugin = plug_data->plugin;
+    snd_pcm_sframes_t delay;
+    struct snd_xferi x;
+    unsigned int pos, frames, seq;
+    int rc, has_delay;
+
+    pthread_mutex_lock(&a->lock);
+    while (!a->closing) {
+        if (a->playback) {
+            pos = a->head;
+            frames = a->count;
+        } else {
+            pos = (a->head + a->count) % a->capacity;
+            frames = a->capacity - a->count;
+        }
+
+        if (!a->active || a->error || !frames) {
+            pthread_cond_wait(&a->work, &a->lock);
+            continue;
+        }
+
+        if (frames > a->chunk)
+            frames = a->chunk;
+        if (frames > a->capacity - pos)
+            frames = a->capacity - pos;
+        seq = a->seq;
+        a->busy = 1;
+        pthread_mutex_unlock(&a->lock);
+
+        x.buf = a->buf + pos * a->frame_bytes;
+        x.frames = frames;
+        x.result = 0;
+        if (a->playback)
+            rc = plug_data->ops->writei_frames(plugin, &x);
+        else
+            rc = plug_data->ops->readi_frames(plugin, &x);
+
+        has_delay = !rc && plug_data->ops->ioctl &&
+                    !plug_data->ops->ioctl(plugin, (int) SNDRV_PCM_IOCTL_DELAY, &delay);
+
+        pthread_mutex_lock(&a->lock);
+        a->busy = 0;
+        if (seq == a->seq) {
+            if (rc) {
+                a->error = rc;
+            } else {
+                if ((unsigned int) x.result < frames)
+                    frames = x.result;
+                if (a->playback) {
+                    a->head = (a->head + frames) % a->capacity;
+                    a->count -= frames;
+                } else {
+                    a->count += frames;
+                }
+                if (has_delay)
+                    a->plugin_delay = delay;
+            }
+            pcm_plug_async_update_ready(a);
+        }
+        pthread_cond_broadcast(&a->done);
+    }
+    pthread_mutex_unlock(&a->lock);
+
+    return NULL;
+}
+
+static void pcm_plug_async_destroy(struct pcm_plug_data *plug_data)
+{
+    struct pcm_plug_async *a = plug_data->async;
+
+    if (!a)
+        return;
+
+    pthread_mutex_lock(&a->lock);
+    a->closing = 1;
+    pthread_cond_signal(&a->work);
+    pthread_mutex_unlock(&a->lock);
+    pthread_join(a->thread, NULL);
+
+    pthread_cond_destroy(&a->done);
+    pthread_cond_destroy(&a->work);
+    pthread_mutex_destroy(&a->lock);
+    free(a->buf);
+    free(a);
+    plug_data->async = NULL;
+}
+
+static int pcm_plug_async_create(struct pcm_plug_data *plug_data,
+                struct snd_pcm_hw_params *params)
+{
+    struct pcm_plug_async *a;
+    eventfd_t val;
+    int rc = -ENOMEM;
+
+    a = calloc(1, sizeof(*a));
+    if (!a)
+        return -ENOMEM;
+
+    a->playback = !(plug_data->flags & PCM_IN);
+    a->frame_bytes = pcm_plug_param_get(params, SNDRV_PCM_HW_PARAM_FRAME_BITS) / 8;
+    a->chunk = pcm_plug_param_get(params, SNDRV_PCM_HW_PARAM_PERIOD_SIZE);
+    a->capacity = plug_data->async_frames;
+    if (a->capacity > plug_data->buffer_size)
+        a->capacity = plug_data->buffer_size;
+    if (!a->frame_bytes || !a->chunk || !a->capacity) {
+        rc = -EINVAL;
+        goto err_params;
+    }
+    a->avail_min = a->chunk < a->capacity ? a->chunk : a->capacity;
+
+    a->buf = calloc(a->capacity, a->frame_bytes);
+    if (!a->buf)
+        goto err_params;
+
+    /* the queue is empty, and the event fd follows its readiness from now on */
+    a->event_fd = plug_data->event_fd;
+    eventfd_read(a->event_fd, &val);
+
+    pthread_mutex_init(&a->lock, NULL);
+    pthread_cond_init(&a->work, NULL);
+    pthread_cond_init(&a->done, NULL);
+    plug_data->async = a;
+
+    if (pthread_create(&a->thread, NULL, pcm_plug_async_thread, plug_data)) {
+        fprintf(stderr, "%s: failed to create the transfer thread\n", __func__);
+        rc = -ENOMEM;
+        goto err_thread;
+    }
+
+    return 0;
+
+err_thread:
+    plug_data->async = NULL;
+    pthread_cond_destroy(&a->done);
+    pthread_cond_destroy(&a->work);
+    pthread_mutex_destroy(&a->lock);
+    free(a->buf);
+err_params:
+    free(a);
+    return rc;
+}
+
+static void pcm_plug_async_set_active(struct pcm_plug_async *a, int active)
+{
+    pthread_mutex_lock(&a->lock);
+    pcm_plug_async_flush(a);
+    a->active = active;
+    pcm_plug_async_update_ready(a);
+    pthread_cond_signal(&a->work);
+    pthread_mutex_unlock(&a->lock);
+}
+
+/* Waits until the worker is done with the transfer it was making, if any */
+static void pcm_plug_async_sync(struct pcm_plug_async *a)
+{
+    pthread_mutex_lock(&a->lock);
+    while (a->busy)
+        pthread_cond_wait(&a->done, &a->lock);
+    pthread_mutex_unlock(&a->lock);
+}
+
+/* Queues the frames to play, or dequeues the captured frames */
+static int pcm_plug_async_transfer(struct pcm_plug_data *plug_data,
+                struct snd_xferi *x)
+{
+    struct pcm_plug_async *a = plug_data->async;
+    char *data = x->buf;
+    unsigned int pos, frames, done = 0;
+    int rc = 0;
+
+    pthread_mutex_lock(&a->lock);
+    while (done < x->frames) {
+        if (!a->active) {
+            rc = -EBADFD;
+            break;
+        }
+        if (a->error) {
+            rc = a->error;
+            break;
+        }
+
+        frames = pcm_plug_async_avail(a);
+        if (!frames) {
+            if (plug_data->flags & PCM_NONBLOCK) {
+                rc = -EAGAIN;
+                break;
+            }
+            pthread_cond_wait(&a->done, &a->lock);
+            continue;
+        }
+
+        pos = a->playback ? (a->head + a->count) % a->capacity : a->head;
+        if (frames > x->frames - done)
+            frames = x->frames - done;
+        if (frames > a->capacity - pos)
+            frames = a->capacity - pos;
+
+        if (a->playback) {
+            memcpy(a->buf + pos * a->frame_bytes,
+                   data + done * a->frame_bytes, frames * a->frame_bytes);
+            a->count += frames;
+        } else {
+            memcpy(data + done * a->frame_bytes,
+                   a->buf + pos * a->frame_bytes, frames * a->frame_bytes);
+            a->head = (a->head + frames) % a->capacity;
+            a->count -= frames;
+        }
+
+        done += frames;
+        a->appl_ptr = (a->appl_ptr + frames) % plug_data->boundary;
+        pthread_cond_signal(&a->work);
+    }
+    pcm_plug_async_update_ready(a);
+    pthread_mutex_unlock(&a->lock);
+
+    x->result = done;
+    return done ? 0 : rc;
+}
+
+/* Reports the pointers of the queue, rather than those of the plugin */
+static int pcm_plug_async_sync_ptr(struct pcm_plug_data *plug_data,
+                struct snd_pcm_sync_ptr *sync_ptr)
+{
+    struct pcm_plug_async *a = plug_data->async;
+    unsigned long hw_ptr;
+
+    pthread_mutex_lock(&a->lock);
+
+    if (a->playback)
+        hw_ptr = a->appl_ptr + plug_data->boundary + a->capacity - a->count -
+                 plug_data->buffer_size;
+    else
+        hw_ptr = a->appl_ptr + a->count;
+
+    sync_ptr->s.status.hw_ptr = hw_ptr % plug_data->boundary;
+    sync_ptr->c.control.appl_ptr = a->appl_ptr;
+    if (a->error == -EPIPE)
+        sync_ptr->s.status.state = PCM_STATE_XRUN;
+    else
+        sync_ptr->s.status.state = convert_plugin_to_pcm_state(plug_data->plugin->state);
+
+    pthread_mutex_unlock(&a->lock);
+
+    return 0;
+}
+
+static int pcm_plug_async_delay(struct pcm_plug_data *plug_data,
+                snd_pcm_sframes_t *delay)
+{
+    struct pcm_plug_async *a = plug_data->async;
+
+    pthread_mutex_lock(&a->lock);
+    *delay = a->count + a->plugin_delay;
+    pthread_mutex_unlock(&a->lock);
+
+    return 0;
+}
+
+static int pcm_plug_async_drain(struct pcm_plug_data *plug_data)
+{
+    struct pcm_plug_async *a = plug_data->async;
+    int rc;
+
+    pthread_mutex_lock(&a->lock);
+    while (a->active && a->count && !a->error)
+        pthread_cond_wait(&a->done, &a->lock);
+    rc = a->error;
+    pthread_mutex_unlock(&a->lock);
+
+    return rc;
+}
+
+static int pcm_plug_async_poll(struct pcm_plug_data *plug_data,
+                struct pollfd *pfd, nfds_t nfds, int timeout)
+{
+    struct pcm_plug_async *a = plug_data->async;
+    struct pollfd event_pfd;
+    int rc;
+
+    event_pfd.fd = a->event_fd;
+    event_pfd.events = POLLIN;
+    event_pfd.revents = 0;
+
+    rc = poll(&event_pfd, 1, timeout);
+    if (rc <= 0 || !nfds)
+        return rc;
+
+    pthread_mutex_lock(&a->lock);
+    if (a->error)
+        pfd->revents = POLLERR;
+    else
+        pfd->revents = a->playback ? POLLOUT : POLLIN;
+    pthread_mutex_unlock(&a->lock);
+
+    return rc;
+}
+
+/* Called by the plugin when the stream progresses, from any thread */
+static void pcm_plug_event_cb(void *data)
+{
+    struct pcm_plug_data *plug_data = data;
+
+    eventfd_write(plug_data->event_fd, 1);
+}
+
 static void pcm_plug_close(void *data)
 {
     struct pcm_plug_data *plug_data = data;
     struct pcm_plugin *plugin = plug_data->plugin;
 
+    pcm_plug_async_destroy(plug_data);
+    if (plug_data->has_events)
+        plug_data->ext_ops->subscribe_events(plugin, NULL, NULL);
     plug_data->ops->close(plugin);
-    dlclose(plug_data->dl_hdl);
+    snd_utils_close_plugin(plug_data->dl_hdl);
 
+    close(plug_data->event_fd);
     free(plug_data);
 }
 
@@ -260,8 +738,11 @@ static int pcm_plug_get_params(struct pcm_plugin *plugin,
                           &frame_bits, 1);
 
 
-    /* Calculate and set period_size in frames */
-    val.min = pcm_plug_bytes_to_frames(pb.min, frame_bits.min);
+    /*
+     * Calculate and set period_size in frames: the fewest frames are the
+     * widest ones, and the most frames the narrowest ones
+     */
+    val.min = pcm_plug_bytes_to_frames(pb.min, frame_bits.max);
     val.max = pcm_plug_bytes_to_frames(pb.max, frame_bits.min);
     pcm_plug_set_interval(params, SNDRV_PCM_HW_PARAM_PERIOD_SIZE,
                           &val, 1);
@@ -273,7 +754,7 @@ static int pcm_plug_get_params(struct pcm_plugin *plugin,
                           &buffer_bytes, 1);
 
     /* Calculate and set buffer_size in frames */
-    val.min = pcm_plug_bytes_to_frames(buffer_bytes.min, frame_bits.min);
+    val.min = pcm_plug_bytes_to_frames(buffer_bytes.min, frame_bits.max);
     val.max = pcm_plug_bytes_to_frames(buffer_bytes.max, frame_bits.min);
     pcm_plug_set_interval(params, SNDRV_PCM_HW_PARAM_BUFFER_SIZE,
                           &val, 1);
@@ -286,6 +767,7 @@ static int pcm_plug_masks_refine(struct snd_pcm_hw_params *p,
     struct snd_mask *req_mask;
     struct snd_mask *con_mask;
     unsigned int idx, i, masks;
+    int req_empty, con_empty;
 
     masks = SNDRV_PCM_HW_PARAM_LAST_MASK - SNDRV_PCM_HW_PARAM_FIRST_MASK;
 
@@ -305,8 +787,18 @@ static int pcm_plug_masks_refine(struct snd_pcm_hw_params *p,
             p->cmask |= 1 << (idx + SNDRV_PCM_HW_PARAM_FIRST_MASK);
 
         /* Actually change the requested mask to constrained mask */
-        for (i = 0; i < PCM_MASK_SIZE; i++)
+        req_empty = con_empty = 1;
+        for (i = 0; i < PCM_MASK_SIZE; i++) {
             req_mask->bits[i] &= con_mask->bits[i];
+            if (req_mask->bits[i])
+                req_empty = 0;
+            if (con_mask->bits[i])
+                con_empty = 0;
+        }
+
+        /* none of the requested values is supported */
+        if (req_empty && !con_empty)
+            return -EINVAL;
     }
 
     return 0;
@@ -367,6 +859,11 @@ static int pcm_plug_interval_refine(struct snd_pcm_hw_params *p,
             ri->integer = 1;
         }
 
+        /* the requested range is outside of the constraints */
+        if (ri->min > ri->max ||
+            (ri->min == ri->max && (ri->openmin || ri->openmax)))
+            return -EINVAL;
+
         /* Set the changed mask */
         if (changed)
             p->cmask |= (1 << (idx + SNDRV_PCM_HW_PARAM_FIRST_INTERVAL));
@@ -376,8 +873,69 @@ static int pcm_plug_interval_refine(struct snd_pcm_hw_params *p,
 }
 
 
+/* Narrows an interval down to the listed values it contains */
+static int pcm_plug_list_refine(struct snd_pcm_hw_params *p,
+                unsigned int param, const struct pcm_plugin_hw_list *list)
+{
+    struct snd_interval *i;
+    unsigned int idx, val, min = 0, max = 0;
+    int found = 0;
+
+    if (!list->count || !(p->rmask & (1 << param)))
+        return 0;
+
+    i = &p->intervals[param - SNDRV_PCM_HW_PARAM_FIRST_INTERVAL];
+
+    for (idx = 0; idx < list->count; idx++) {
+        val = list->values[idx];
+        if (val < i->min || (val == i->min && i->openmin) ||
+            val > i->max || (val == i->max && i->openmax))
+            continue;
+
+        if (!found || val < min)
+            min = val;
+        if (!found || val > max)
+            max = val;
+        found = 1;
+    }
+
+    if (!found)
+        return -EINVAL;
+
+    if (min != i->min || max != i->max || i->openmin || i->openmax) {
+        i->min = min;
+        i->max = max;
+        i->openmin = 0;
+        i->openmax = 0;
+        i->integer = 1;
+        p->cmask |= 1 << param;
+    }
+
+    return 0;
+}
+
+static int pcm_plug_lists_refine(struct snd_pcm_hw_params *p,
+                const struct pcm_plugin_hw_lists *lists)
+{
+    int rc;
+
+    if (!lists)
+        return 0;
+
+    rc = pcm_plug_list_refine(p, SNDRV_PCM_HW_PARAM_RATE, &lists->rate);
+    if (!rc)
+        rc = pcm_plug_list_refine(p, SNDRV_PCM_HW_PARAM_CHANNELS,
+                                  &lists->channels);
+    if (!rc)
+        rc = pcm_plug_list_refine(p, SNDRV_PCM_HW_PARAM_PERIOD_SIZE,
+                                  &lists->period_size);
+
+    return rc;
+}
+
 static int pcm_plug_hw_params_refine(struct snd_pcm_hw_params *p,
-                struct snd_pcm_hw_params *c)
+                struct snd_pcm_hw_params *c,
+                const struct pcm_plugin_hw_lists *lists)
 {
     int rc;
 
@@ -393,6 +951,10 @@ static int pcm_plug_hw_params_refine(struct snd_pcm_hw_params *p,
         return rc;
     }
 
+    rc = pcm_plug_lists_refine(p, lists);
+    if (rc)
+        return rc;
+
     /* clear the requested params */
     p->rmask = 0;
 
@@ -401,21 +963,40 @@ static int pcm_plug_hw_params_refine(struct snd_pcm_hw_params *p,
 
 static int __pcm_plug_hrefine(struct pcm_plug_data *plug_data,
                 struct snd_pcm_hw_params *params)
+{
+    return pcm_plug_hw_params_refine(params, &plug_data->constraints,
+                                     plug_data->lists);
+}
+
+/* Computes the constraints refinement is done against, once for all */
+static int pcm_plug_init_constraints(struct pcm_plug_data *plug_data)
 {
     struct pcm_plugin *plugin = plug_data->plugin;
-    struct snd_pcm_hw_params plug_params;
+    struct snd_pcm_hw_params *c = &plug_data->constraints;
     int rc;
 
-    memset(&plug_params, 0, sizeof(plug_params));
-    rc = pcm_plug_get_params(plugin, &plug_params);
+    if (PCM_PLUG_HAS_EXT_OP(plug_data->ext_ops, hw_lists))
+        plug_data->lists = plug_data->ext_ops->hw_lists(plugin);
+
+    rc = pcm_plug_get_params(plugin, c);
     if (rc) {
         fprintf(stderr, "%s: pcm_plug_get_params failed %d\n",
                __func__, rc);
         return -EINVAL;
     }
 
-    return pcm_plug_hw_params_refine(params, &plug_params);
+    /* Narrow the ranges down to the listed values */
+    c->rmask = ~0U;
+    rc = pcm_plug_lists_refine(c, plug_data->lists);
+    c->rmask = 0;
+    c->cmask = 0;
+    if (rc) {
+        fprintf(stderr, "%s: no listed value within constraints\n",
+                __func__);
+        return rc;
+    }
 
+    return 0;
 }
 
 static int pcm_plug_hrefine(struct pcm_plug_data *plug_data,
@@ -497,6 +1078,8 @@ static int pcm_plug_hparams(struct pcm_plug_data *plug_data,
                 struct snd_pcm_hw_params *params)
 {
     struct pcm_plugin *plugin = plug_data->plugin;
+    unsigned long long period_ns;
+    unsigned int rate;
     int rc;
 
     if (plugin->state != PCM_PLUG_STATE_OPEN)
@@ -514,21 +1097,64 @@ static int pcm_plug_hparams(struct pcm_plug_data *plug_data,
     pcm_plug_hw_params_set(params);
 
     rc = plug_data->ops->hw_params(plugin, params);
-    if (!rc)
-        plugin->state = PCM_PLUG_STATE_SETUP;
+    if (rc)
+        return rc;
 
-    return rc;
+    plug_data->buffer_size = pcm_plug_param_get(params, SNDRV_PCM_HW_PARAM_BUFFER_SIZE);
+    plug_data->avail_min = pcm_plug_param_get(params, SNDRV_PCM_HW_PARAM_PERIOD_SIZE);
+
+    rate = pcm_plug_param_get(params, SNDRV_PCM_HW_PARAM_RATE);
+    period_ns = rate ? plug_data->avail_min * 1000000000ULL / rate : 0;
+    plug_data->period.tv_sec = period_ns / 1000000000;
+    plug_data->period.tv_nsec = period_ns % 1000000000;
+
+    /* the same boundary the core computes, until sw_params sets it */
+    plug_data->boundary = plug_data->buffer_size;
+    while (plug_data->boundary * 2 <= INT_MAX - plug_data->buffer_size)
+        plug_data->boundary *= 2;
+
+    if (plug_data->async_frames) {
+        rc = pcm_plug_async_create(plug_data, params);
+        if (rc) {
+            fprintf(stderr, "%s: failed to set up the transfer queue %d\n",
+                    __func__, rc);
+            return rc;
+        }
+    }
+
+    pcm_plug_set_state(plug_data, PCM_PLUG_STATE_SETUP);
+
+    return 0;
 }
 
 static int pcm_plug_sparams(struct pcm_plug_data *plug_data,
                 struct snd_pcm_sw_params *params)
 {
     struct pcm_plugin *plugin = plug_data->plugin;
+    struct pcm_plug_async *a = plug_data->async;
+    int rc;
 
     if (plugin->state != PCM_PLUG_STATE_SETUP)
         return -EBADFD;
 
-    return plug_data->ops->sw_params(plugin, params);
+    rc = plug_data->ops->sw_params(plugin, params);
+    if (rc)
+        return rc;
+
+    if (params->boundary >= plug_data->buffer_size)
+        plug_data->boundary = params->boundary;
+    plug_data->avail_min = params->avail_min ? params->avail_min : 1;
+
+    if (a) {
+        pthread_mutex_lock(&a->lock);
+        a->avail_min = plug_data->avail_min;
+        if (a->avail_min > a->capacity)
+            a->avail_min = a->capacity;
+        pcm_plug_async_update_ready(a);
+        pthread_mutex_unlock(&a->lock);
+    }
+
+    return 0;
 }
 
 static int pcm_plug_sync_ptr(struct pcm_plug_data *plug_data,
@@ -537,6 +1163,9 @@ static int pcm_plug_sync_ptr(struct pcm_plug_data *plug_data,
     struct pcm_plugin *plugin = plug_data->plugin;
     int ret = -EBADFD;
 
+    if (plugin->state >= PCM_PLUG_STATE_SETUP && plug_data->async)
+        return pcm_plug_async_sync_ptr(plug_data, sync_ptr);
+
     if (plugin->state >= PCM_PLUG_STATE_SETUP) {
         ret = plug_data->ops->sync_ptr(plugin, sync_ptr);
         if (ret == 0)
@@ -555,6 +1184,9 @@ static int pcm_plug_writei_frames(struct pcm_plug_data *plug_data,
         plugin->state != PCM_PLUG_STATE_RUNNING)
         return -EBADFD;
 
+    if (plug_data->async)
+        return pcm_plug_async_transfer(plug_data, x);
+
     return plug_data->ops->writei_frames(plugin, x);
 }
 
@@ -567,6 +1199,9 @@ static int pcm_plug_readi_frames(struct pcm_plug_data *plug_data,
         plugin->state != PCM_PLUG_STATE_RUNNING)
         return -EBADFD;
 
+    if (plug_data->async)
+        return pcm_plug_async_transfer(plug_data, x);
+
     return plug_data->ops->readi_frames(plugin, x);
 }
 
@@ -591,7 +1226,10 @@ static int pcm_plug_prepare(struct pcm_plug_data *plug_data)
 
     rc = plug_data->ops->prepare(plugin);
     if (!rc)
-        plugin->state = PCM_PLUG_STATE_PREPARED;
+        pcm_plug_set_state(plug_data, PCM_PLUG_STATE_PREPARED);
+
+    if (!rc && plug_data->async)
+        pcm_plug_async_set_active(plug_data->async, 1);
 
     return rc;
 }
@@ -606,7 +1244,7 @@ static int pcm_plug_start(struct pcm_plug_data *plug_data)
 
     rc = plug_data->ops->start(plugin);
     if (!rc)
-        plugin->state = PCM_PLUG_STATE_RUNNING;
+        pcm_plug_set_state(plug_data, PCM_PLUG_STATE_RUNNING);
 
     return rc;
 }
@@ -616,9 +1254,16 @@ static int pcm_plug_drop(struct pcm_plug_data *plug_data)
     struct pcm_plugin *plugin = plug_data->plugin;
     int rc;
 
+    if (plug_data->async)
+        pcm_plug_async_set_active(plug_data->async, 0);
+
     rc = plug_data->ops->drop(plugin);
     if (!rc)
-        plugin->state = PCM_PLUG_STATE_SETUP;
+        pcm_plug_set_state(plug_data, PCM_PLUG_STATE_SETUP);
+
+    /* the transfer in flight, if any, is interrupted by the plugin */
+    if (plug_data->async)
+        pcm_plug_async_sync(plug_data->async);
 
     return rc;
 }
@@ -626,13 +1271,29 @@ static int pcm_plug_drop(struct pcm_plug_data *plug_data)
 static int pcm_plug_drain(struct pcm_plug_data *plug_data)
 {
     struct pcm_plugin *plugin = plug_data->plugin;
+    int rc;
 
     if (plugin->state != PCM_PLUG_STATE_RUNNING)
         return -EBADFD;
 
+    if (plug_data->async && plug_data->async->playback) {
+        rc = pcm_plug_async_drain(plug_data);
+        if (rc)
+            return rc;
+    }
+
     return plug_data->ops->drain(plugin);
 }
 
+static int pcm_plug_hwsync(struct pcm_plug_data *plug_data)
+{
+    /* the plugin keeps the hardware pointer of its status page current */
+    if (plug_data->status || plug_data->async)
+        return 0;
+
+    return plug_data->ops->ioctl(plug_data->plugin, SNDRV_PCM_IOCTL_HWSYNC, NULL);
+}
+
 static int pcm_plug_ioctl(void *data, unsigned int cmd, ...)
 {
     struct pcm_plug_data *plug_data = data;
@@ -664,6 +1325,9 @@ static int pcm_plug_ioctl(void *data, unsigned int cmd, ...)
     case SNDRV_PCM_IOCTL_SYNC_PTR:
         ret = pcm_plug_sync_ptr(plug_data, arg);
         break;
+    case SNDRV_PCM_IOCTL_HWSYNC:
+        ret = pcm_plug_hwsync(plug_data);
+        break;
     case SNDRV_PCM_IOCTL_PREPARE:
         ret = pcm_plug_prepare(plug_data);
         break;
@@ -682,6 +1346,12 @@ static int pcm_plug_ioctl(void *data, unsigned int cmd, ...)
     case SNDRV_PCM_IOCTL_READI_FRAMES:
         ret = pcm_plug_readi_frames(plug_data, arg);
         break;
+    case SNDRV_PCM_IOCTL_DELAY:
+        if (plug_data->async) {
+            ret = pcm_plug_async_delay(plug_data, arg);
+            break;
+        }
+        /* fallthrough */
     default:
         ret = plug_data->ops->ioctl(plugin, cmd, arg);
         break;
@@ -696,14 +1366,136 @@ static int pcm_plug_poll(void *data, struct pollfd *pfd, nfds_t nfds,
     struct pcm_plug_data *plug_data = data;
     struct pcm_plugin *plugin = plug_data->plugin;
 
+    if (plug_data->async)
+        return pcm_plug_async_poll(plug_data, pfd, nfds, timeout);
+
     return plug_data->ops->poll(plugin, pfd, nfds, timeout);
 }
 
+/* Gets the frames the caller can transfer, as the core computes them */
+static int pcm_plug_get_avail(struct pcm_plug_data *plug_data, long *avail,
+                int *state)
+{
+    struct snd_pcm_sync_ptr sync_ptr;
+    unsigned long hw_ptr, appl_ptr;
+    int rc;
+
+    if (plug_data->status && plug_data->control) {
+        hw_ptr = plug_data->status->hw_ptr;
+        appl_ptr = plug_data->control->appl_ptr;
+        *state = plug_data->status->state;
+    } else {
+        memset(&sync_ptr, 0, sizeof(sync_ptr));
+        sync_ptr.flags = SNDRV_PCM_SYNC_PTR_APPL | SNDRV_PCM_SYNC_PTR_AVAIL_MIN;
+        rc = pcm_plug_sync_ptr(plug_data, &sync_ptr);
+        if (rc)
+            return rc;
+        hw_ptr = sync_ptr.s.status.hw_ptr;
+        appl_ptr = sync_ptr.c.control.appl_ptr;
+        *state = sync_ptr.s.status.state;
+    }
+
+    if (plug_data->flags & PCM_IN)
+        *avail = hw_ptr - appl_ptr;
+    else
+        *avail = hw_ptr + plug_data->buffer_size - appl_ptr;
+
+    if (*avail < 0)
+        *avail += plug_data->boundary;
+    else if ((unsigned long) *avail >= plug_data->boundary)
+        *avail -= plug_data->boundary;
+
+    return 0;
+}
+
+/* The event fd is readable when the stream is ready, for either direction */
+static void pcm_plug_poll_descriptor(void *data __attribute__((unused)),
+                struct pollfd *pfd)
+{
+    pfd->events = POLLIN;
+}
+
+static int pcm_plug_poll_revents(void *data, const struct pollfd *pfd,
+                short *revents)
+{
+    struct pcm_plug_data *plug_data = data;
+    short ready = plug_data->flags & PCM_IN ? POLLIN : POLLOUT;
+    struct pcm_plug_async *a = plug_data->async;
+    long avail;
+    int state, rc;
+
+    *revents = pfd->revents & (POLLERR | POLLHUP | POLLNVAL);
+    if (!(pfd->revents & POLLIN))
+        return 0;
+
+    if (a) {
+        pthread_mutex_lock(&a->lock);
+        if (a->error)
+            *revents |= POLLERR;
+        else if (a->ready)
+            *revents |= ready;
+        pthread_mutex_unlock(&a->lock);
+        return 0;
+    }
+
+    /* transfers block in the plugin until it is ready */
+    if (plug_data->plugin->state < PCM_PLUG_STATE_SETUP) {
+        *revents |= ready;
+        return 0;
+    }
+
+    /* consume the event first, not to miss one signalled while checking */
+    pcm_plug_consume(plug_data);
+
+    rc = pcm_plug_get_avail(plug_data, &avail, &state);
+    if (rc) {
+        pcm_plug_signal(plug_data);
+        return rc;
+    }
+
+    switch (state) {
+    case PCM_STATE_PREPARED:
+    case PCM_STATE_RUNNING:
+        if (avail >= (long) plug_data->avail_min)
+            *revents |= ready;
+        break;
+    default:
+        *revents |= ready | POLLERR;
+        break;
+    }
+
+    if (*revents)
+        pcm_plug_signal(plug_data);
+
+    return 0;
+}
+
 static void *pcm_plug_mmap(void *data, void *addr, size_t length, int prot,
                        int flags, off_t offset)
 {
     struct pcm_plug_data *plug_data = data;
     struct pcm_plugin *plugin = plug_data->plugin;
+    void *ptr;
+
+    /* the status and control pages are shared for as long as the PCM is open */
+    if (offset == SNDRV_PCM_MMAP_OFFSET_STATUS ||
+            offset == SNDRV_PCM_MMAP_OFFSET_CONTROL) {
+        /* the pointers of the transfer queue are reported with SYNC_PTR */
+        if (!plug_data->shared_ptrs || plug_data->async_frames)
+            return MAP_FAILED;
+
+        ptr = plug_data->ops->mmap(plugin, addr, length, prot, flags, offset);
+        if (!ptr || ptr == MAP_FAILED)
+            return ptr;
+
+        if (offset == SNDRV_PCM_MMAP_OFFSET_STATUS) {
+            plug_data->status = ptr;
+            plug_data->status->state = convert_plugin_to_pcm_state(plugin->state);
+        } else {
+            plug_data->control = ptr;
+        }
+        return ptr;
+    }
 
     if (plugin->state != PCM_PLUG_STATE_SETUP)
         return NULL;
@@ -716,6 +1508,15 @@ static int pcm_plug_munmap(void *data, void *addr, size_t length)
     struct pcm_plug_data *plug_data = data;
     struct pcm_plugin *plugin = plug_data->plugin;
 
+    if (addr && addr == plug_data->status) {
+        plug_data->status = NULL;
+        return plug_data->ops->munmap(plugin, addr, length);
+    }
+    if (addr && addr == plug_data->control) {
+        plug_data->control = NULL;
+        return plug_data->ops->munmap(plugin, addr, length);
+    }
+
     if (plugin->state != PCM_PLUG_STATE_SETUP)
         return -EBADFD;
 
@@ -727,7 +1528,7 @@ static int pcm_plug_open(unsigned int card, unsigned int device,
 {
     struct pcm_plug_data *plug_data;
     void *dl_hdl;
-    int rc = 0;
+    int rc = 0, async_frames, timer_fd;
     char *so_name;
 
     plug_data = calloc(1, sizeof(*plug_data));
@@ -735,15 +1536,24 @@ static int pcm_plug_open(unsigned int card, unsigned int device,
         return -ENOMEM;
     }
 
+    /* ready until the plugin signals otherwise, see pcm_plug_poll_revents() */
+    plug_data->event_fd = eventfd(1, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (plug_data->event_fd < 0) {
+        rc = -errno;
+        free(plug_data);
+        return rc;
+    }
+
     rc = snd_utils_get_str(pcm_node, "so-name", &so_name);
     if (rc) {
         fprintf(stderr, "%s: failed to get plugin lib name\n", __func__);
         goto err_get_lib;
     }
 
-    dl_hdl = dlopen(so_name, RTLD_NOW);
+    dl_hdl = snd_utils_open_plugin(pcm_node, so_name);
     if (!dl_hdl) {
         fprintf(stderr, "%s: unable to open %s\n", __func__, so_name);
+        rc = -ENOENT;
         goto err_dl_open;
     } else {
         fprintf(stderr, "%s: dlopen successful for %s\n", __func__, so_name);
@@ -755,32 +1565,73 @@ static int pcm_plug_open(unsigned int card, unsigned int device,
     if (!plug_data->ops) {
         fprintf(stderr, "%s: dlsym to open fn failed, err = '%s'\n",
                 __func__, dlerror());
+        rc = -EINVAL;
         goto err_dlsym;
     }
 
+    plug_data->ext_ops = dlsym(dl_hdl, "pcm_plugin_ext_ops");
+    dlerror();
+
     rc = plug_data->ops->open(&plug_data->plugin, card, device, flags);
     if (rc) {
         fprintf(stderr, "%s: failed to open plugin\n", __func__);
         goto err_open;
     }
 
+    rc = pcm_plug_init_constraints(plug_data);
+    if (rc)
+        goto err_constraints;
+
     plug_data->dl_hdl = dl_hdl;
     plug_data->card = card;
     plug_data->device = device;
     plug_data->dev_node = pcm_node;
     plug_data->flags = flags;
 
+    /* transfers of mmapped PCMs do not go through the plugin */
+    if (!(flags & PCM_MMAP) &&
+        !snd_utils_get_int(pcm_node, "async-queue-frames", &async_frames) &&
+        async_frames > 0)
+        plug_data->async_frames = async_frames;
+
+    /* older plugins do not expect the status and control offsets */
+    plug_data->shared_ptrs = PCM_PLUG_HAS_EXT_OP(plug_data->ext_ops, flags) &&
+            (plug_data->ext_ops->flags & PCM_PLUGIN_SHARED_PTRS);
+
+    /* the transfer queue signals the event fd itself */
+    if (!plug_data->async_frames &&
+        PCM_PLUG_HAS_EXT_OP(plug_data->ext_ops, subscribe_events))
+        plug_data->has_events = !plug_data->ext_ops->subscribe_events(
+                plug_data->plugin, pcm_plug_event_cb, plug_data);
+
+    /* the stream of the other plugins is checked each period */
+    if (!plug_data->async_frames && !plug_data->has_events) {
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        if (timer_fd < 0) {
+            rc = -errno;
+            fprintf(stderr, "%s: failed to create the period timer\n", __func__);
+            goto err_timer;
+        }
+        close(plug_data->event_fd);
+        plug_data->event_fd = timer_fd;
+        plug_data->has_timer = 1;
+    }
+
     *data = plug_data;
 
-    plug_data->plugin->state = PCM_PLUG_STATE_OPEN;
+    pcm_plug_set_state(plug_data, PCM_PLUG_STATE_OPEN);
 
-    return 0;
+    return plug_data->event_fd;
 
+err_timer:
+err_constraints:
+    plug_data->ops->close(plug_data->plugin);
 err_open:
 err_dlsym:
-    dlclose(dl_hdl);
+    snd_utils_close_plugin(dl_hdl);
 err_get_lib:
 err_dl_open:
+    close(plug_data->event_fd);
     free(plug_data);
 
     return rc;
@@ -793,4 +1644,6 @@ const struct pcm_ops plug_ops = {
     .mmap = pcm_plug_mmap,
     .munmap = pcm_plug_munmap,
     .poll = pcm_plug_poll,
+    .poll_descriptor = pcm_plug_poll_descriptor,
+    .poll_revents = pcm_plug_poll_revents,
 };
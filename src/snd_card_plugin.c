@@ -31,7 +31,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
+#include <pthread.h>
 
 #define SND_DLSYM(h, p, s, err) \
 do {                            \
@@ -41,6 +43,40 @@ do {                            \
         err = -ENODEV;            \
 } while(0)
 
+/** A card definition, parsed once and shared by the nodes of the card.
+ * Definitions stay cached once their nodes are closed, so that the
+ * devices of the card can be opened again without parsing it again.
+ */
+struct snd_card_def {
+    struct snd_card_def *next;
+    unsigned int card;
+    /** The definition returned by the parser, NULL if the card has none */
+    void *card_node;
+    /** The number of open nodes of the card */
+    unsigned int refs;
+    /** Set when the definition is dropped while nodes still use it */
+    int stale;
+};
+
+/** A plugin library, loaded once for all the devices it implements */
+struct snd_plugin_lib {
+    struct snd_plugin_lib *next;
+    void *dl_hdl;
+    /** The number of open devices of the library */
+    unsigned int refs;
+    /** Whether the library stays loaded once its last device is closed */
+    int resident;
+    char so_name[];
+};
+
+/* Protects the parser, the card definitions and the plugin libraries */
+static pthread_mutex_t snd_utils_lock = PTHREAD_MUTEX_INITIALIZER;
+/* The sound card parser library, loaded once for all cards */
+static void *snd_utils_dl_hdl;
+static const struct snd_node_ops *snd_utils_ops;
+static struct snd_card_def *snd_utils_cards;
+static struct snd_plugin_lib *snd_utils_plugins;
+
 int snd_utils_get_int(struct snd_node *node, const char *prop, int *val)
 {
     if (!node || !node->card_node || !node->dev_node)
@@ -57,20 +93,62 @@ int snd_utils_get_str(struct snd_node *node, const char *prop, char **val)
     return node->ops->get_str(node->dev_node, prop, val);
 }
 
+/* Frees a definition that no node uses, with the lock held */
+static void snd_utils_free_card_def(struct snd_card_def *def)
+{
+    struct snd_card_def **prev;
+
+    for (prev = &snd_utils_cards; *prev; prev = &(*prev)->next) {
+        if (*prev == def) {
+            *prev = def->next;
+            break;
+        }
+    }
+
+    if (def->card_node)
+        snd_utils_ops->close_card(def->card_node);
+    free(def);
+
+    /* the parser is unloaded with the last definition */
+    if (!snd_utils_cards) {
+        dlclose(snd_utils_dl_hdl);
+        snd_utils_dl_hdl = NULL;
+        snd_utils_ops = NULL;
+    }
+}
+
 void snd_utils_close_dev_node(struct snd_node *node)
 {
     if (!node)
         return;
 
-    if (node->card_node)
-        node->ops->close_card(node->card_node);
-
-    if (node->dl_hdl)
-        dlclose(node->dl_hdl);
+    pthread_mutex_lock(&snd_utils_lock);
+    if (--node->def->refs == 0 && node->def->stale)
+        snd_utils_free_card_def(node->def);
+    pthread_mutex_unlock(&snd_utils_lock);
 
     free(node);
 }
 
+/** Drops the cached card definitions that no open device uses.
+ * Those still in use are dropped once their devices are closed.
+ * The cards are parsed again when their devices are next opened.
+ */
+void snd_utils_flush_card_defs(void)
+{
+    struct snd_card_def *def, *next;
+
+    pthread_mutex_lock(&snd_utils_lock);
+    for (def = snd_utils_cards; def; def = next) {
+        next = def->next;
+        if (def->refs)
+            def->stale = 1;
+        else
+            snd_utils_free_card_def(def);
+    }
+    pthread_mutex_unlock(&snd_utils_lock);
+}
+
 enum snd_node_type snd_utils_get_node_type(struct snd_node *node)
 {
     int val = SND_NODE_TYPE_HW;
@@ -83,37 +161,81 @@ enum snd_node_type snd_utils_get_node_type(struct snd_node *node)
     return val;
 }
 
-static int snd_utils_resolve_symbols(struct snd_node *node)
+static int snd_utils_resolve_symbols(void *dl_hdl)
 {
-    void *dl = node->dl_hdl;
     int err;
-    SND_DLSYM(dl, node->ops, "snd_card_ops", err);
+    SND_DLSYM(dl_hdl, snd_utils_ops, "snd_card_ops", err);
     return err;
 }
 
+/* Gets the definition of a card, loading the parser and parsing the card
+ * on first use, with the lock held
+ */
+static struct snd_card_def *snd_utils_get_card_def(unsigned int card)
+{
+    struct snd_card_def *def;
+    int rc;
+
+    for (def = snd_utils_cards; def; def = def->next) {
+        if (def->card == card && !def->stale)
+            break;
+    }
+    if (def) {
+        def->refs++;
+        return def;
+    }
+
+    if (!snd_utils_dl_hdl) {
+        snd_utils_dl_hdl = dlopen("libsndcardparser.so", RTLD_NOW);
+        if (!snd_utils_dl_hdl)
+            return NULL;
+
+        rc = snd_utils_resolve_symbols(snd_utils_dl_hdl);
+        if (rc < 0)
+            goto err_resolve_symbols;
+    }
+
+    def = calloc(1, sizeof(*def));
+    if (!def)
+        goto err_resolve_symbols;
+
+    /* cards without a definition are remembered too */
+    def->card = card;
+    def->card_node = snd_utils_ops->open_card(card);
+    def->refs = 1;
+    def->next = snd_utils_cards;
+    snd_utils_cards = def;
+    return def;
+
+err_resolve_symbols:
+    if (!snd_utils_cards) {
+        dlclose(snd_utils_dl_hdl);
+        snd_utils_dl_hdl = NULL;
+        snd_utils_ops = NULL;
+    }
+    return NULL;
+}
+
 static struct snd_node *snd_utils_open_dev_node(unsigned int card,
                                                 unsigned int device,
                                                 int dev_type)
 {
     struct snd_node *node;
-    int rc = 0;
 
     node = calloc(1, sizeof(*node));
     if (!node)
         return NULL;
 
-    node->dl_hdl = dlopen("libsndcardparser.so", RTLD_NOW);
-    if (!node->dl_hdl) {
-        goto err_dl_open;
-    }
+    pthread_mutex_lock(&snd_utils_lock);
 
-    rc = snd_utils_resolve_symbols(node);
-    if (rc < 0)
-        goto err_resolve_symbols;
+    node->def = snd_utils_get_card_def(card);
+    if (!node->def)
+        goto err_get_card;
 
-    node->card_node = node->ops->open_card(card);
+    node->ops = snd_utils_ops;
+    node->card_node = node->def->card_node;
     if (!node->card_node)
-        goto err_resolve_symbols;
+        goto err_get_node;
 
     if (dev_type == NODE_PCM) {
       node->dev_node = node->ops->get_pcm(node->card_node, device);
@@ -124,15 +246,14 @@ static struct snd_node *snd_utils_open_dev_node(unsigned int card,
     if (!node->dev_node)
         goto err_get_node;
 
+    pthread_mutex_unlock(&snd_utils_lock);
     return node;
 
 err_get_node:
-    node->ops->close_card(node->card_node);
+    node->def->refs--;
 
-err_resolve_symbols:
-    dlclose(node->dl_hdl);
-
-err_dl_open:
+err_get_card:
+    pthread_mutex_unlock(&snd_utils_lock);
     free(node);
     return NULL;
 }
@@ -147,3 +268,76 @@ struct snd_node* snd_utils_open_mixer(unsigned int card)
 {
   return snd_utils_open_dev_node(card, 0, NODE_MIXER);
 }
+
+/** Loads the plugin library of a device.
+ * Libraries are shared by the devices naming the same "so-name", and
+ * only loaded by the first of them. A library whose devices set the
+ * "keep-resident" property stays loaded once they are all closed, so
+ * that opening them again does not go through the dynamic loader.
+ * @returns The handle of the library, to be released with
+ *  snd_utils_close_plugin(), or NULL on failure.
+ */
+void *snd_utils_open_plugin(struct snd_node *node, const char *so_name)
+{
+    struct snd_plugin_lib *lib;
+    int resident = 0;
+    size_t len;
+
+    if (snd_utils_get_int(node, "keep-resident", &resident))
+        resident = 0;
+
+    pthread_mutex_lock(&snd_utils_lock);
+
+    for (lib = snd_utils_plugins; lib; lib = lib->next) {
+        if (!strcmp(lib->so_name, so_name))
+            break;
+    }
+
+    if (!lib) {
+        len = strlen(so_name) + 1;
+        lib = calloc(1, sizeof(*lib) + len);
+        if (!lib)
+            goto exit;
+
+        lib->dl_hdl = dlopen(so_name, RTLD_NOW);
+        if (!lib->dl_hdl) {
+            free(lib);
+            lib = NULL;
+            goto exit;
+        }
+        memcpy(lib->so_name, so_name, len);
+        lib->next = snd_utils_plugins;
+        snd_utils_plugins = lib;
+    }
+
+    lib->refs++;
+    if (resident)
+        lib->resident = 1;
+
+exit:
+    pthread_mutex_unlock(&snd_utils_lock);
+    return lib ? lib->dl_hdl : NULL;
+}
+
+/** Releases a plugin library loaded with snd_utils_open_plugin() */
+void snd_utils_close_plugin(void *dl_hdl)
+{
+    struct snd_plugin_lib **prev, *lib;
+
+    pthread_mutex_lock(&snd_utils_lock);
+
+    for (prev = &snd_utils_plugins; *prev; prev = &(*prev)->next) {
+        lib = *prev;
+        if (lib->dl_hdl != dl_hdl)
+            continue;
+
+        if (--lib->refs == 0 && !lib->resident) {
+            *prev = lib->next;
+            dlclose(lib->dl_hdl);
+            free(lib);
+        }
+        break;
+    }
+
+    pthread_mutex_unlock(&snd_utils_lock);
+}
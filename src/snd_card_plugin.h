@@ -34,6 +34,8 @@
 
 #include <dlfcn.h>
 
+struct snd_card_def;
+
 /** Encapsulates the pcm device definition from
  * the sound card definition configuration file.
  */
@@ -42,8 +44,8 @@ struct snd_node {
     void *card_node;
     /** Pointer to device definition, either PCM or MIXER device */
     void *dev_node;
-    /** Pointer to the sound card parser library */
-    void *dl_hdl;
+    /** The cached card definition that card_node comes from */
+    struct snd_card_def *def;
     /** A pointer to the operations structure. */
     const struct snd_node_ops* ops;
 };
@@ -65,10 +67,16 @@ struct snd_node *snd_utils_open_mixer(unsigned int card);
 
 void snd_utils_close_dev_node(struct snd_node *node);
 
+void snd_utils_flush_card_defs(void);
+
 enum snd_node_type snd_utils_get_node_type(struct snd_node *node);
 
 int snd_utils_get_int(struct snd_node *node, const char *prop, int *val);
 
 int snd_utils_get_str(struct snd_node *node, const char *prop, char **val);
 
+void *snd_utils_open_plugin(struct snd_node *node, const char *so_name);
+
+void snd_utils_close_plugin(void *dl_hdl);
+
 #endif /* end of TINYALSA_SRC_SND_CARD_UTILS_H */
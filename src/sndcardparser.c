@@ -0,0 +1,803 @@
+/* sndcardparser.c
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are met:
+**     * Redistributions of source code must retain the above copyright
+**       notice, this list of conditions and the following disclaimer.
+**     * Redistributions in binary form must reproduce the above copyright
+**       notice, this list of conditions and the following disclaimer in the
+**       documentation and/or other materials provided with the distribution.
+**     * Neither the name of The Android Open Source Project nor the names of
+**       its contributors may be used to endorse or promote products derived
+**       from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY The Android Open Source Project ``AS IS'' AND
+** ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+** IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+** ARE DISCLAIMED. IN NO EVENT SHALL The Android Open Source Project BE LIABLE
+** FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+** DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+** SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+** CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+** LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+** OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+** DAMAGE.
+*/
+
+/* The default sound card definition parser, loaded by the core as
+ * libsndcardparser.so.
+ *
+ * Card N is described by the text file card<N>.conf of the definitions
+ * directory, made of a [mixer] section and [pcm <device>] sections of
+ * "key = value" lines:
+ *
+ *     # lines starting with '#' or ';' are comments
+ *     [mixer]
+ *     type = plugin
+ *     so-name = libmixer_plugin.so
+ *
+ *     [pcm 0]
+ *     type = plugin
+ *     so-name = libpcm_plugin.so
+ *     name = "Primary Out"
+ *     playback = 1
+ *
+ * The "type" key takes "hw", "plugin" or a number. Values that parse as
+ * numbers, in C notation, are readable with both get_int() and get_str().
+ *
+ * The first time a card is opened the text is compiled to an image, in
+ * which properties are found by probing a hash table, and the image is
+ * written to card<N>.bin in the cache directory. Later opens map the
+ * cache directly, for as long as the text it was compiled from is left
+ * untouched. When the cache directory is not writable the image is only
+ * kept in memory.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fnv_hash.h"
+#include "snd_card_plugin.h"
+
+#ifndef TINYALSA_SNDCARD_DEFS_DIR
+#ifdef __ANDROID__
+#define TINYALSA_SNDCARD_DEFS_DIR "/vendor/etc/sndcard"
+#else
+#define TINYALSA_SNDCARD_DEFS_DIR "/etc/tinyalsa"
+#endif
+#endif
+
+#ifndef TINYALSA_SNDCARD_CACHE_DIR
+#ifdef __ANDROID__
+#define TINYALSA_SNDCARD_CACHE_DIR "/data/vendor/audio"
+#else
+#define TINYALSA_SNDCARD_CACHE_DIR "/var/cache/tinyalsa"
+#endif
+#endif
+
+#define SNDCARD_CACHE_MAGIC 0x42444353 /* "SCDB" */
+#define SNDCARD_CACHE_VERSION 1
+
+#define SNDCARD_MIN_BUCKETS 8
+
+/** The header of a compiled card definition.
+ * All offsets are in bytes from the start of the image, except those of
+ * strings, which are from the start of the string table. The string at
+ * offset 0 is the empty string.
+ */
+struct sndcard_cache_header {
+    uint32_t magic;
+    uint32_t version;
+    /* the definition file the image was compiled from */
+    int64_t src_mtime_sec;
+    int64_t src_mtime_nsec;
+    uint64_t src_size;
+    uint64_t src_ino;
+    uint32_t size;
+    uint32_t num_nodes;
+    uint32_t nodes_off;
+    /* a power of two, with one bucket free at least */
+    uint32_t num_buckets;
+    uint32_t buckets_off;
+    uint32_t strings_off;
+};
+
+struct sndcard_cache_node {
+    /* NODE_PCM or NODE_MIXER */
+    uint32_t type;
+    uint32_t device;
+};
+
+struct sndcard_cache_prop {
+    uint32_t node;
+    uint32_t hash;
+    /* 0 in free buckets */
+    uint32_t key;
+    uint32_t value;
+    int32_t ival;
+    uint32_t is_int;
+};
+
+/** The handle of a node, as given to the core */
+struct sndcard_node {
+    const struct sndcard *card;
+    uint32_t index;
+};
+
+struct sndcard {
+    /* the image, mapped from the cache or allocated */
+    void *image;
+    size_t size;
+    int mapped;
+    const struct sndcard_cache_header *header;
+    const struct sndcard_cache_node *nodes;
+    const struct sndcard_cache_prop *buckets;
+    const char *strings;
+    struct sndcard_node *handles;
+};
+
+/* a property as read from the definition file */
+struct sndcard_def_prop {
+    unsigned int node;
+    char *key;
+    char *value;
+};
+
+struct sndcard_def {
+    struct sndcard_cache_node *nodes;
+    unsigned int num_nodes;
+    struct sndcard_def_prop *props;
+    unsigned int num_props;
+    unsigned int max_props;
+};
+
+/* Hashes the node index, least significant byte first, then the key */
+static uint32_t sndcard_hash(uint32_t node, const char *key)
+{
+    unsigned char bytes[sizeof(node)];
+    unsigned int i;
+
+    for (i = 0; i < sizeof(node); i++)
+        bytes[i] = (node >> (i * 8)) & 0xff;
+
+    return fnv_hash_add_string(fnv_hash_add(FNV_HASH_INIT, bytes, sizeof(bytes)), key);
+}
+
+static int sndcard_parse_int(const char *key, const char *value, int *ival)
+{
+    char *end;
+    long val;
+
+    if (!strcmp(key, "type")) {
+        if (!strcmp(value, "hw")) {
+            *ival = SND_NODE_TYPE_HW;
+            return 1;
+        }
+        if (!strcmp(value, "plugin")) {
+            *ival = SND_NODE_TYPE_PLUGIN;
+            return 1;
+        }
+    }
+
+    if (!*value)
+        return 0;
+
+    errno = 0;
+    val = strtol(value, &end, 0);
+    if (errno || *end || val < INT_MIN || val > INT_MAX)
+        return 0;
+
+    *ival = val;
+    return 1;
+}
+
+static char *sndcard_trim(char *str)
+{
+    char *end;
+
+    while (*str == ' ' || *str == '\t')
+        str++;
+
+    end = str + strlen(str);
+    while (end > str && (end[-1] == ' ' || end[-1] == '\t' ||
+                         end[-1] == '\n' || end[-1] == '\r'))
+        end--;
+    *end = '\0';
+
+    return str;
+}
+
+static void sndcard_free_def(struct sndcard_def *def)
+{
+    unsigned int i;
+
+    for (i = 0; i < def->num_props; i++) {
+        free(def->props[i].key);
+        free(def->props[i].value);
+    }
+    free(def->props);
+    free(def->nodes);
+}
+
+/* Gets the node of a section, adding it on first use */
+static int sndcard_def_node(struct sndcard_def *def, uint32_t type,
+                            uint32_t device)
+{
+    struct sndcard_cache_node *nodes;
+    unsigned int i;
+
+    for (i = 0; i < def->num_nodes; i++) {
+        if (def->nodes[i].type == type && def->nodes[i].device == device)
+            return i;
+    }
+
+    nodes = realloc(def->nodes, (def->num_nodes + 1) * sizeof(*nodes));
+    if (!nodes)
+        return -ENOMEM;
+
+    def->nodes = nodes;
+    def->nodes[def->num_nodes].type = type;
+    def->nodes[def->num_nodes].device = device;
+    return def->num_nodes++;
+}
+
+static int sndcard_def_prop(struct sndcard_def *def, unsigned int node,
+                            const char *key, const char *value)
+{
+    struct sndcard_def_prop *props, *prop;
+
+    if (def->num_props == def->max_props) {
+        unsigned int max = def->max_props ? def->max_props * 2 : 16;
+
+        props = realloc(def->props, max * sizeof(*props));
+        if (!props)
+            return -ENOMEM;
+        def->props = props;
+        def->max_props = max;
+    }
+
+    prop = &def->props[def->num_props];
+    prop->node = node;
+    prop->key = strdup(key);
+    prop->value = strdup(value);
+    if (!prop->key || !prop->value) {
+        free(prop->key);
+        free(prop->value);
+        return -ENOMEM;
+    }
+
+    def->num_props++;
+    return 0;
+}
+
+/* Parses a section header, without its brackets */
+static int sndcard_parse_section(struct sndcard_def *def, char *section)
+{
+    char *end;
+    unsigned long device;
+
+    section = sndcard_trim(section);
+    if (!strcmp(section, "mixer"))
+        return sndcard_def_node(def, NODE_MIXER, 0);
+
+    if (strncmp(section, "pcm", 3) || (section[3] != ' ' && section[3] != '\t'))
+        return -EINVAL;
+
+    section = sndcard_trim(section + 3);
+    if (*section < '0' || *section > '9')
+        return -EINVAL;
+
+    errno = 0;
+    device = strtoul(section, &end, 0);
+    if (errno || *end || device > UINT32_MAX)
+        return -EINVAL;
+
+    return sndcard_def_node(def, NODE_PCM, device);
+}
+
+static int sndcard_parse(const char *path, FILE *file, struct sndcard_def *def)
+{
+    char *line = NULL, *str, *key, *value, *end;
+    size_t line_size = 0;
+    unsigned int line_num = 0;
+    int node = -1;
+    int ret = 0;
+
+    while (getline(&line, &line_size, file) >= 0) {
+        line_num++;
+        str = sndcard_trim(line);
+        if (!*str || *str == '#' || *str == ';')
+            continue;
+
+        if (*str == '[') {
+            end = str + strlen(str) - 1;
+            if (*end != ']') {
+                ret = -EINVAL;
+            } else {
+                *end = '\0';
+                node = sndcard_parse_section(def, str + 1);
+                ret = node < 0 ? node : 0;
+            }
+            if (ret == -EINVAL)
+                fprintf(stderr, "%s: %s:%u: invalid section\n", __func__,
+                        path, line_num);
+            if (ret)
+                break;
+            continue;
+        }
+
+        value = strchr(str, '=');
+        if (node < 0 || !value) {
+            fprintf(stderr, "%s: %s:%u: expected a section or a key = value\n",
+                    __func__, path, line_num);
+            ret = -EINVAL;
+            break;
+        }
+
+        *value = '\0';
+        key = sndcard_trim(str);
+        value = sndcard_trim(value + 1);
+        if (!*key) {
+            fprintf(stderr, "%s: %s:%u: empty key\n", __func__, path, line_num);
+            ret = -EINVAL;
+            break;
+        }
+
+        /* quotes keep the blanks at the ends of a value */
+        if (*value == '"') {
+            end = value + strlen(value) - 1;
+            if (end == value || *end != '"') {
+                fprintf(stderr, "%s: %s:%u: unterminated quote\n", __func__,
+                        path, line_num);
+                ret = -EINVAL;
+                break;
+            }
+            *end = '\0';
+            value++;
+        }
+
+        ret = sndcard_def_prop(def, node, key, value);
+        if (ret)
+            break;
+    }
+
+    if (!ret && ferror(file)) {
+        fprintf(stderr, "%s: failed to read %s\n", __func__, path);
+        ret = -EIO;
+    }
+
+    free(line);
+    return ret;
+}
+
+/* Compiles a definition to an image, returning its size or 0 on failure */
+static size_t sndcard_compile(const struct sndcard_def *def,
+                              const struct stat *src, void **image)
+{
+    struct sndcard_cache_header *header;
+    struct sndcard_cache_prop *buckets, *bucket;
+    const struct sndcard_def_prop *prop;
+    size_t strings_size = 1, size;
+    uint32_t num_buckets = SNDCARD_MIN_BUCKETS, hash, key, value;
+    unsigned int i, j;
+    char *base, *strings;
+    int ival;
+
+    while (num_buckets < 2 * def->num_props)
+        num_buckets *= 2;
+
+    for (i = 0; i < def->num_props; i++) {
+        strings_size += strlen(def->props[i].key) + 1;
+        strings_size += strlen(def->props[i].value) + 1;
+    }
+
+    size = sizeof(*header) + def->num_nodes * sizeof(struct sndcard_cache_node) +
+           num_buckets * sizeof(*buckets) + strings_size;
+    if (size > UINT32_MAX)
+        return 0;
+
+    base = calloc(1, size);
+    if (!base)
+        return 0;
+
+    header = (struct sndcard_cache_header *) base;
+    header->magic = SNDCARD_CACHE_MAGIC;
+    header->version = SNDCARD_CACHE_VERSION;
+    header->src_mtime_sec = src->st_mtim.tv_sec;
+    header->src_mtime_nsec = src->st_mtim.tv_nsec;
+    header->src_size = src->st_size;
+    header->src_ino = src->st_ino;
+    header->size = size;
+    header->num_nodes = def->num_nodes;
+    header->nodes_off = sizeof(*header);
+    header->num_buckets = num_buckets;
+    header->buckets_off = header->nodes_off +
+                          def->num_nodes * sizeof(struct sndcard_cache_node);
+    header->strings_off = header->buckets_off + num_buckets * sizeof(*buckets);
+
+    if (def->num_nodes)
+        memcpy(base + header->nodes_off, def->nodes,
+               def->num_nodes * sizeof(struct sndcard_cache_node));
+
+    buckets = (struct sndcard_cache_prop *) (base + header->buckets_off);
+    strings = base + header->strings_off;
+    strings_size = 1;
+
+    for (i = 0; i < def->num_props; i++) {
+        prop = &def->props[i];
+        hash = sndcard_hash(prop->node, prop->key);
+
+        for (j = hash & (num_buckets - 1); ; j = (j + 1) & (num_buckets - 1)) {
+            bucket = &buckets[j];
+            if (!bucket->key || (bucket->hash == hash &&
+                                 bucket->node == prop->node &&
+                                 !strcmp(strings + bucket->key, prop->key)))
+                break;
+        }
+
+        /* a key given again overrides the earlier value */
+        if (!bucket->key) {
+            key = strings_size;
+            strcpy(strings + key, prop->key);
+            strings_size += strlen(prop->key) + 1;
+            bucket->node = prop->node;
+            bucket->hash = hash;
+            bucket->key = key;
+        }
+
+        value = strings_size;
+        strcpy(strings + value, prop->value);
+        strings_size += strlen(prop->value) + 1;
+        bucket->value = value;
+        bucket->is_int = sndcard_parse_int(prop->key, prop->value, &ival);
+        bucket->ival = bucket->is_int ? ival : 0;
+    }
+
+    *image = base;
+    return size;
+}
+
+/* Checks that an image can be walked without going out of its bounds */
+static int sndcard_validate(const void *image, size_t size)
+{
+    const struct sndcard_cache_header *header = image;
+    const struct sndcard_cache_prop *buckets;
+    const char *strings;
+    size_t strings_size;
+    uint32_t i;
+
+    if (size < sizeof(*header) ||
+        header->magic != SNDCARD_CACHE_MAGIC ||
+        header->version != SNDCARD_CACHE_VERSION ||
+        header->size != size)
+        return 0;
+
+    if (header->nodes_off != sizeof(*header) ||
+        header->num_nodes > (size - header->nodes_off) /
+                            sizeof(struct sndcard_cache_node) ||
+        header->buckets_off != header->nodes_off +
+                               header->num_nodes * sizeof(struct sndcard_cache_node))
+        return 0;
+
+    if (header->num_buckets < SNDCARD_MIN_BUCKETS ||
+        (header->num_buckets & (header->num_buckets - 1)) ||
+        header->num_buckets > (size - header->buckets_off) / sizeof(*buckets) ||
+        header->strings_off != header->buckets_off +
+                               header->num_buckets * sizeof(*buckets) ||
+        header->strings_off >= size)
+        return 0;
+
+    buckets = (const struct sndcard_cache_prop *)
+              ((const char *) image + header->buckets_off);
+    strings = (const char *) image + header->strings_off;
+    strings_size = size - header->strings_off;
+    if (strings[0] || strings[strings_size - 1])
+        return 0;
+
+    for (i = 0; i < header->num_buckets; i++) {
+        if (!buckets[i].key)
+            continue;
+        if (buckets[i].key >= strings_size ||
+            buckets[i].value >= strings_size ||
+            buckets[i].node >= header->num_nodes)
+            return 0;
+    }
+
+    return 1;
+}
+
+/* Maps the cache of a card, if it is up to date with its definition */
+static size_t sndcard_map_cache(const char *path, const struct stat *src,
+                                void **image)
+{
+    const struct sndcard_cache_header *header;
+    struct stat st;
+    void *base;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return 0;
+
+    if (fstat(fd, &st) || st.st_size < (off_t) sizeof(*header) ||
+        st.st_size > UINT32_MAX) {
+        close(fd);
+        return 0;
+    }
+
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return 0;
+
+    header = base;
+    if (!sndcard_validate(base, st.st_size) ||
+        header->src_mtime_sec != src->st_mtim.tv_sec ||
+        header->src_mtime_nsec != src->st_mtim.tv_nsec ||
+        header->src_size != (uint64_t) src->st_size ||
+        header->src_ino != (uint64_t) src->st_ino) {
+        munmap(base, st.st_size);
+        return 0;
+    }
+
+    *image = base;
+    return st.st_size;
+}
+
+/* Writes the cache of a card, replacing any previous one at once */
+static void sndcard_write_cache(const char *path, const void *image,
+                                size_t size)
+{
+    char tmp_path[PATH_MAX];
+    const char *buf = image;
+    ssize_t written;
+    int fd;
+
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", path) >=
+        (int) sizeof(tmp_path))
+        return;
+
+    fd = mkstemp(tmp_path);
+    if (fd < 0)
+        return;
+
+    while (size) {
+        written = write(fd, buf, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            break;
+        buf += written;
+        size -= written;
+    }
+
+    if (size || fchmod(fd, 0644) || close(fd)) {
+        if (size)
+            close(fd);
+        unlink(tmp_path);
+        return;
+    }
+
+    if (rename(tmp_path, path))
+        unlink(tmp_path);
+}
+
+/* Compiles the definition file of a card, caching the result if possible */
+static size_t sndcard_load_defs(const char *path, const char *cache_path,
+                                void **image, int *mapped)
+{
+    struct sndcard_def def = { 0 };
+    struct stat st;
+    size_t size = 0;
+    FILE *file;
+
+    file = fopen(path, "re");
+    if (!file) {
+        if (errno != ENOENT)
+            fprintf(stderr, "%s: failed to open %s: %s\n", __func__, path,
+                    strerror(errno));
+        return 0;
+    }
+
+    /* the cache is keyed by the file as it was read */
+    if (fstat(fileno(file), &st)) {
+        fclose(file);
+        return 0;
+    }
+
+    size = sndcard_map_cache(cache_path, &st, image);
+    if (size) {
+        *mapped = 1;
+        fclose(file);
+        return size;
+    }
+
+    if (!sndcard_parse(path, file, &def)) {
+        size = sndcard_compile(&def, &st, image);
+        if (size)
+            sndcard_write_cache(cache_path, *image, size);
+        else
+            fprintf(stderr, "%s: failed to compile %s\n", __func__, path);
+    }
+
+    sndcard_free_def(&def);
+    fclose(file);
+    return size;
+}
+
+static const char *sndcard_dir(const char *env, const char *def)
+{
+    const char *dir = getenv(env);
+
+    return dir && *dir ? dir : def;
+}
+
+static void sndcard_close_card(void *card_node)
+{
+    struct sndcard *card = card_node;
+
+    if (!card)
+        return;
+
+    if (card->mapped)
+        munmap(card->image, card->size);
+    else
+        free(card->image);
+    free(card->handles);
+    free(card);
+}
+
+static void *sndcard_open_card(unsigned int card_num)
+{
+    char path[PATH_MAX], cache_path[PATH_MAX];
+    struct sndcard *card;
+    void *image = NULL;
+    size_t size;
+    uint32_t i;
+    int ret;
+
+    ret = snprintf(path, sizeof(path), "%s/card%u.conf",
+                   sndcard_dir("TINYALSA_SNDCARD_DEFS_DIR",
+                               TINYALSA_SNDCARD_DEFS_DIR), card_num);
+    if (ret < 0 || ret >= (int) sizeof(path))
+        return NULL;
+
+    ret = snprintf(cache_path, sizeof(cache_path), "%s/card%u.bin",
+                   sndcard_dir("TINYALSA_SNDCARD_CACHE_DIR",
+                               TINYALSA_SNDCARD_CACHE_DIR), card_num);
+    if (ret < 0 || ret >= (int) sizeof(cache_path))
+        return NULL;
+
+    card = calloc(1, sizeof(*card));
+    if (!card)
+        return NULL;
+
+    size = sndcard_load_defs(path, cache_path, &image, &card->mapped);
+    if (!size) {
+        free(card);
+        return NULL;
+    }
+
+    card->image = image;
+    card->size = size;
+    card->header = image;
+    card->nodes = (const struct sndcard_cache_node *)
+                  ((const char *) image + card->header->nodes_off);
+    card->buckets = (const struct sndcard_cache_prop *)
+                    ((const char *) image + card->header->buckets_off);
+    card->strings = (const char *) image + card->header->strings_off;
+
+    card->handles = calloc(card->header->num_nodes ? card->header->num_nodes : 1,
+                           sizeof(*card->handles));
+    if (!card->handles) {
+        sndcard_close_card(card);
+        return NULL;
+    }
+
+    for (i = 0; i < card->header->num_nodes; i++) {
+        card->handles[i].card = card;
+        card->handles[i].index = i;
+    }
+
+    return card;
+}
+
+static void *sndcard_get_node(void *card_node, uint32_t type, uint32_t device)
+{
+    struct sndcard *card = card_node;
+    uint32_t i;
+
+    if (!card)
+        return NULL;
+
+    for (i = 0; i < card->header->num_nodes; i++) {
+        if (card->nodes[i].type == type && card->nodes[i].device == device)
+            return &card->handles[i];
+    }
+
+    return NULL;
+}
+
+static void *sndcard_get_pcm(void *card_node, unsigned int id)
+{
+    return sndcard_get_node(card_node, NODE_PCM, id);
+}
+
+static void *sndcard_get_mixer(void *card_node)
+{
+    return sndcard_get_node(card_node, NODE_MIXER, 0);
+}
+
+static const struct sndcard_cache_prop *sndcard_find_prop(void *dev_node,
+                                                          const char *prop)
+{
+    const struct sndcard_node *node = dev_node;
+    const struct sndcard *card;
+    const struct sndcard_cache_prop *bucket;
+    uint32_t hash, mask, i, n;
+
+    if (!node || !prop)
+        return NULL;
+
+    card = node->card;
+    hash = sndcard_hash(node->index, prop);
+    mask = card->header->num_buckets - 1;
+
+    for (i = hash & mask, n = 0; n <= mask; i = (i + 1) & mask, n++) {
+        bucket = &card->buckets[i];
+        if (!bucket->key)
+            break;
+        if (bucket->hash == hash && bucket->node == node->index &&
+            !strcmp(card->strings + bucket->key, prop))
+            return bucket;
+    }
+
+    return NULL;
+}
+
+static int sndcard_get_int(void *dev_node, const char *prop, int *val)
+{
+    const struct sndcard_cache_prop *bucket;
+
+    bucket = sndcard_find_prop(dev_node, prop);
+    if (!bucket)
+        return -ENOENT;
+    if (!bucket->is_int)
+        return -EINVAL;
+
+    *val = bucket->ival;
+    return 0;
+}
+
+static int sndcard_get_str(void *dev_node, const char *prop, char **val)
+{
+    const struct sndcard_node *node = dev_node;
+    const struct sndcard_cache_prop *bucket;
+
+    bucket = sndcard_find_prop(dev_node, prop);
+    if (!bucket)
+        return -ENOENT;
+
+    *val = (char *) node->card->strings + bucket->value;
+    return 0;
+}
+
+struct snd_node_ops snd_card_ops = {
+    .open_card = sndcard_open_card,
+    .close_card = sndcard_close_card,
+    .get_int = sndcard_get_int,
+    .get_str = sndcard_get_str,
+    .get_mixer = sndcard_get_mixer,
+    .get_pcm = sndcard_get_pcm,
+};
@@ -0,0 +1,60 @@
+/* stub_pcm_plugin.h
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are met:
+**     * Redistributions of source code must retain the above copyright
+**       notice, this list of conditions and the following disclaimer.
+**     * Redistributions in binary form must reproduce the above copyright
+**       notice, this list of conditions and the following disclaimer in the
+**       documentation and/or other materials provided with the distribution.
+**     * Neither the name of The Android Open Source Project nor the names of
+**       its contributors may be used to endorse or promote products derived
+**       from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY The Android Open Source Project ``AS IS'' AND
+** ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+** IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+** ARE DISCLAIMED. IN NO EVENT SHALL The Android Open Source Project BE LIABLE
+** FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+** DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+** SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+** CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+** LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+** OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+** DAMAGE.
+*/
+
+#ifndef TINYALSA_TESTS_STUB_PCM_PLUGIN_H_
+#define TINYALSA_TESTS_STUB_PCM_PLUGIN_H_
+
+/* The library the stub card of tests/sndcard opens, as a plugin and as a stage */
+#define STUB_PCM_PLUGIN_LIB "libstub_pcm_plugin.so"
+
+/* The symbol of the stub calls, looked up with dlsym() */
+#define STUB_PCM_PLUGIN_CALLS "stub_pcm_plugin_calls"
+
+/* What the core asked of the stub plugin, reset by the tests */
+struct stub_pcm_plugin_calls {
+    /* mmap calls for the status and the control pages */
+    unsigned int status_maps;
+    unsigned int control_maps;
+    unsigned int starts;
+    unsigned int drains;
+    unsigned int drops;
+    /* frames the stub played */
+    unsigned long frames;
+    /* if set, the discrete constraints of the stub, read when it is opened */
+    const struct pcm_plugin_hw_lists *lists;
+    /* set to hold the written frames back, until it is cleared */
+    int hold;
+    /* if set, the writes fail once this many frames are written */
+    unsigned long limit;
+    /* the first sample of the last write */
+    int sample;
+    /* frames processed by the stub stages */
+    unsigned long processed;
+};
+
+#endif
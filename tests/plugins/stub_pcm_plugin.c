@@ -0,0 +1,337 @@
+/* stub_pcm_plugin.c
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are met:
+**     * Redistributions of source code must retain the above copyright
+**       notice, this list of conditions and the following disclaimer.
+**     * Redistributions in binary form must reproduce the above copyright
+**       notice, this list of conditions and the following disclaimer in the
+**       documentation and/or other materials provided with the distribution.
+**     * Neither the name of The Android Open Source Project nor the names of
+**       its contributors may be used to endorse or promote products derived
+**       from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY The Android Open Source Project ``AS IS'' AND
+** ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+** IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+** ARE DISCLAIMED. IN NO EVENT SHALL The Android Open Source Project BE LIABLE
+** FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+** DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+** SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+** CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+** LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+** OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+** DAMAGE.
+*/
+
+/*
+ * A playback plugin for the tests of the plugin core. It plays the frames
+ * as soon as they are written, unless told to hold them back, and counts
+ * what the core asks of it in stub_pcm_plugin_calls. The tests change
+ * pcm_plugin_ext_ops before they open the stub, to take the paths of the
+ * older plugins.
+ *
+ * The stub is also a stage of chained devices, which adds one to the
+ * samples it processes.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sound/asound.h>
+#include <tinyalsa/pcm.h>
+#include <tinyalsa/plugin.h>
+
+#include "stub_pcm_plugin.h"
+
+#define STUB_FORMAT_BIT(x) (1ULL << (x))
+
+struct stub_pcm_priv {
+    unsigned int frame_bytes;
+    unsigned int avail_min;
+    /* shared with the core when the flags of pcm_plugin_ext_ops ask for it */
+    struct snd_pcm_mmap_status status;
+    struct snd_pcm_mmap_control control;
+};
+
+struct stub_pcm_plugin_calls stub_pcm_plugin_calls;
+
+static struct pcm_plugin_hw_constraints stub_pcm_constrs = {
+    .access = STUB_FORMAT_BIT(SNDRV_PCM_ACCESS_RW_INTERLEAVED),
+    .format = STUB_FORMAT_BIT(SNDRV_PCM_FORMAT_S16_LE),
+    .bit_width = {
+        .min = 16,
+        .max = 16,
+    },
+    .channels = {
+        .min = 1,
+        .max = 8,
+    },
+    .rate = {
+        .min = 8000,
+        .max = 192000,
+    },
+    .periods = {
+        .min = 1,
+        .max = 8,
+    },
+    .period_bytes = {
+        .min = 64,
+        .max = 65536,
+    },
+};
+
+/* Plays the frames written so far */
+static void stub_pcm_play(struct stub_pcm_priv *priv)
+{
+    stub_pcm_plugin_calls.frames += priv->control.appl_ptr - priv->status.hw_ptr;
+    priv->status.hw_ptr = priv->control.appl_ptr;
+}
+
+static int stub_pcm_open(struct pcm_plugin **plugin, unsigned int card,
+                unsigned int device, unsigned int mode)
+{
+    struct pcm_plugin *stub;
+    struct stub_pcm_priv *priv;
+
+    if (mode & PCM_IN)
+        return -EINVAL;
+
+    stub = calloc(1, sizeof(*stub));
+    if (!stub)
+        return -ENOMEM;
+
+    priv = calloc(1, sizeof(*priv));
+    if (!priv) {
+        free(stub);
+        return -ENOMEM;
+    }
+
+    stub->card = card;
+    stub->device = device;
+    stub->mode = mode;
+    stub->constraints = &stub_pcm_constrs;
+    stub->priv = priv;
+
+    *plugin = stub;
+    return 0;
+}
+
+static int stub_pcm_close(struct pcm_plugin *plugin)
+{
+    free(plugin->priv);
+    free(plugin);
+    return 0;
+}
+
+static int stub_pcm_hw_params(struct pcm_plugin *plugin,
+                struct snd_pcm_hw_params *params)
+{
+    struct stub_pcm_priv *priv = plugin->priv;
+
+    priv->frame_bytes = params->intervals[SNDRV_PCM_HW_PARAM_FRAME_BITS -
+                                          SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].min / 8;
+    return 0;
+}
+
+static int stub_pcm_sw_params(struct pcm_plugin *plugin,
+                struct snd_pcm_sw_params *params)
+{
+    struct stub_pcm_priv *priv = plugin->priv;
+
+    priv->avail_min = params->avail_min;
+    return 0;
+}
+
+static int stub_pcm_sync_ptr(struct pcm_plugin *plugin,
+                struct snd_pcm_sync_ptr *sync_ptr)
+{
+    struct stub_pcm_priv *priv = plugin->priv;
+
+    if (!stub_pcm_plugin_calls.hold)
+        stub_pcm_play(priv);
+
+    sync_ptr->s.status.hw_ptr = priv->status.hw_ptr;
+    sync_ptr->c.control.appl_ptr = priv->control.appl_ptr;
+    if (sync_ptr->flags & SNDRV_PCM_SYNC_PTR_AVAIL_MIN)
+        sync_ptr->c.control.avail_min = priv->avail_min;
+    return 0;
+}
+
+static int stub_pcm_writei_frames(struct pcm_plugin *plugin, struct snd_xferi *x)
+{
+    struct stub_pcm_priv *priv = plugin->priv;
+    snd_pcm_uframes_t frames = x->frames;
+
+    if (stub_pcm_plugin_calls.limit) {
+        if (priv->control.appl_ptr >= stub_pcm_plugin_calls.limit)
+            return -EIO;
+        if (frames > stub_pcm_plugin_calls.limit - priv->control.appl_ptr)
+            frames = stub_pcm_plugin_calls.limit - priv->control.appl_ptr;
+    }
+
+    stub_pcm_plugin_calls.sample = *(const int16_t *) x->buf;
+    priv->control.appl_ptr += frames;
+    if (!stub_pcm_plugin_calls.hold)
+        stub_pcm_play(priv);
+
+    x->result = frames;
+    return 0;
+}
+
+static int stub_pcm_readi_frames(struct pcm_plugin *plugin, struct snd_xferi *x)
+{
+    return -EINVAL;
+}
+
+static int stub_pcm_ttstamp(struct pcm_plugin *plugin, int *tstamp)
+{
+    return 0;
+}
+
+static int stub_pcm_prepare(struct pcm_plugin *plugin)
+{
+    struct stub_pcm_priv *priv = plugin->priv;
+
+    priv->status.hw_ptr = 0;
+    priv->control.appl_ptr = 0;
+    return 0;
+}
+
+static int stub_pcm_start(struct pcm_plugin *plugin)
+{
+    stub_pcm_plugin_calls.starts++;
+    return 0;
+}
+
+static int stub_pcm_drain(struct pcm_plugin *plugin)
+{
+    stub_pcm_plugin_calls.drains++;
+    return 0;
+}
+
+static int stub_pcm_drop(struct pcm_plugin *plugin)
+{
+    stub_pcm_plugin_calls.drops++;
+    return 0;
+}
+
+static int stub_pcm_ioctl(struct pcm_plugin *plugin, int cmd, void *arg)
+{
+    /* no frame is left to play once it is written */
+    if (cmd == (int) SNDRV_PCM_IOCTL_DELAY)
+        *(snd_pcm_sframes_t *) arg = 0;
+
+    return 0;
+}
+
+static void *stub_pcm_mmap(struct pcm_plugin *plugin, void *addr, size_t length,
+                int prot, int flags, off_t offset)
+{
+    struct stub_pcm_priv *priv = plugin->priv;
+
+    if (offset == SNDRV_PCM_MMAP_OFFSET_STATUS) {
+        stub_pcm_plugin_calls.status_maps++;
+        return &priv->status;
+    }
+    if (offset == SNDRV_PCM_MMAP_OFFSET_CONTROL) {
+        stub_pcm_plugin_calls.control_maps++;
+        return &priv->control;
+    }
+
+    return MAP_FAILED;
+}
+
+static int stub_pcm_munmap(struct pcm_plugin *plugin, void *addr, size_t length)
+{
+    return 0;
+}
+
+static int stub_pcm_poll(struct pcm_plugin *plugin, struct pollfd *pfd,
+                nfds_t nfds, int timeout)
+{
+    /* the frames are played as soon as they are written */
+    return 1;
+}
+
+struct pcm_plugin_ops pcm_plugin_ops = {
+    .open = stub_pcm_open,
+    .close = stub_pcm_close,
+    .hw_params = stub_pcm_hw_params,
+    .sw_params = stub_pcm_sw_params,
+    .sync_ptr = stub_pcm_sync_ptr,
+    .writei_frames = stub_pcm_writei_frames,
+    .readi_frames = stub_pcm_readi_frames,
+    .ttstamp = stub_pcm_ttstamp,
+    .prepare = stub_pcm_prepare,
+    .start = stub_pcm_start,
+    .drain = stub_pcm_drain,
+    .drop = stub_pcm_drop,
+    .ioctl = stub_pcm_ioctl,
+    .mmap = stub_pcm_mmap,
+    .munmap = stub_pcm_munmap,
+    .poll = stub_pcm_poll,
+};
+
+static const struct pcm_plugin_hw_lists *stub_pcm_hw_lists(struct pcm_plugin *plugin)
+{
+    return stub_pcm_plugin_calls.lists;
+}
+
+struct pcm_plugin_ext_ops pcm_plugin_ext_ops = {
+    .size = sizeof(struct pcm_plugin_ext_ops),
+    .flags = PCM_PLUGIN_SHARED_PTRS,
+    .hw_lists = stub_pcm_hw_lists,
+};
+
+static int stub_stage_open(void **stage, unsigned int card, unsigned int device,
+                unsigned int flags)
+{
+    unsigned int *channels;
+
+    channels = calloc(1, sizeof(*channels));
+    if (!channels)
+        return -ENOMEM;
+
+    *stage = channels;
+    return 0;
+}
+
+static void stub_stage_close(void *stage)
+{
+    free(stage);
+}
+
+static int stub_stage_hw_params(void *stage, struct snd_pcm_hw_params *params)
+{
+    unsigned int *channels = stage;
+
+    *channels = params->intervals[SNDRV_PCM_HW_PARAM_CHANNELS -
+                                  SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].min;
+    return 0;
+}
+
+static int stub_stage_process(void *stage, void *buf, unsigned int frames)
+{
+    unsigned int *channels = stage;
+    int16_t *samples = buf;
+    unsigned int i;
+
+    for (i = 0; i < frames * *channels; i++)
+        samples[i]++;
+
+    stub_pcm_plugin_calls.processed += frames;
+    return 0;
+}
+
+const struct pcm_plugin_stage_ops pcm_plugin_stage_ops = {
+    .size = sizeof(struct pcm_plugin_stage_ops),
+    .open = stub_stage_open,
+    .close = stub_stage_close,
+    .hw_params = stub_stage_hw_params,
+    .process = stub_stage_process,
+};
@@ -0,0 +1,209 @@
+/* card_test.cc
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are met:
+**     * Redistributions of source code must retain the above copyright
+**       notice, this list of conditions and the following disclaimer.
+**     * Redistributions in binary form must reproduce the above copyright
+**       notice, this list of conditions and the following disclaimer in the
+**       documentation and/or other materials provided with the distribution.
+**     * Neither the name of The Android Open Source Project nor the names of
+**       its contributors may be used to endorse or promote products derived
+**       from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY The Android Open Source Project ``AS IS'' AND
+** ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+** IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+** ARE DISCLAIMED. IN NO EVENT SHALL The Android Open Source Project BE LIABLE
+** FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+** DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+** SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+** CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+** LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+** OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+** DAMAGE.
+*/
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "tinyalsa/card.h"
+
+namespace tinyalsa {
+namespace testing {
+
+class CardMonitorTest : public ::testing::Test {
+  protected:
+    virtual void SetUp() override {
+        char dir_template[] = "/tmp/tinyalsa_card_XXXXXX";
+        ASSERT_NE(mkdtemp(dir_template), nullptr);
+        dir = dir_template;
+        monitor = card_monitor_open(dir.c_str(), OnEvent, &events);
+        ASSERT_NE(monitor, nullptr);
+    }
+
+    virtual void TearDown() override {
+        card_monitor_close(monitor);
+        for (const char *name : {"controlC7", "pcmC7D0p", "pcmC7D1c", "comprC7D2", "timer",
+                                 "controlC32"}) {
+            unlink((dir + "/" + name).c_str());
+        }
+        rmdir(dir.c_str());
+    }
+
+    void Create(const std::string &name) {
+        int fd = open((dir + "/" + name).c_str(), O_CREAT | O_WRONLY, 0644);
+        ASSERT_GE(fd, 0);
+        close(fd);
+    }
+
+    void Remove(const std::string &name) {
+        ASSERT_EQ(unlink((dir + "/" + name).c_str()), 0);
+    }
+
+    static void OnEvent(const card_event *event, void *data) {
+        static_cast<std::vector<card_event> *>(data)->push_back(*event);
+    }
+
+    std::string dir;
+    card_monitor *monitor = nullptr;
+    std::vector<card_event> events;
+};
+
+TEST(CardTest, NullParametersCheck) {
+    EXPECT_EQ(card_monitor_open(nullptr, nullptr, nullptr), nullptr);
+    card_monitor_close(nullptr);
+    EXPECT_EQ(card_monitor_get_fd(nullptr), -EINVAL);
+    EXPECT_EQ(card_monitor_process(nullptr, 0), -EINVAL);
+    EXPECT_EQ(mixer_manager_handle_card_event(nullptr, nullptr), -EINVAL);
+    card_list_free(nullptr);
+    EXPECT_EQ(card_list_find(nullptr, ""), nullptr);
+    EXPECT_EQ(card_get_index(nullptr), -EINVAL);
+}
+
+TEST(CardTest, GetIndex) {
+    EXPECT_EQ(card_get_index("3"), 3);
+    EXPECT_EQ(card_get_index("CARD=5"), 5);
+    EXPECT_EQ(card_get_index("no such card"), -ENODEV);
+    EXPECT_EQ(card_get_index(""), -ENODEV);
+
+    const card_list *list = card_list_get(CARD_LIST_CACHED);
+    ASSERT_NE(list, nullptr);
+    for (unsigned int i = 0; i < list->num_cards; ++i) {
+        EXPECT_EQ(card_get_index(list->cards[i].id), static_cast<int>(list->cards[i].card));
+    }
+    card_list_free(list);
+}
+
+TEST(CardTest, ListCards) {
+    const card_list *list = card_list_get(0);
+    ASSERT_NE(list, nullptr);
+
+    for (unsigned int i = 0; i < list->num_cards; ++i) {
+        const card_desc *desc = &list->cards[i];
+        EXPECT_STRNE(desc->id, "");
+        EXPECT_EQ(card_list_find(list, desc->id), desc);
+        for (unsigned int j = 0; j < desc->num_pcms; ++j) {
+            EXPECT_GT(desc->pcms[j].playback_subdevices + desc->pcms[j].capture_subdevices, 0);
+            if (j > 0) {
+                EXPECT_GT(desc->pcms[j].device, desc->pcms[j - 1].device);
+            }
+        }
+    }
+    EXPECT_EQ(card_list_find(list, "no such card"), nullptr);
+
+    const card_list *cached = card_list_get(CARD_LIST_CACHED);
+    ASSERT_NE(cached, nullptr);
+    EXPECT_EQ(cached->num_cards, list->num_cards);
+    const card_list *again = card_list_get(CARD_LIST_CACHED);
+    EXPECT_EQ(again, cached);
+
+    // lists obtained before stay valid
+    card_list_invalidate();
+    const card_list *reread = card_list_get(CARD_LIST_CACHED);
+    ASSERT_NE(reread, nullptr);
+    EXPECT_NE(reread, cached);
+    EXPECT_EQ(cached->num_cards, list->num_cards);
+
+    card_list_free(reread);
+    card_list_free(again);
+    card_list_free(cached);
+    card_list_free(list);
+    card_list_invalidate();
+}
+
+TEST_F(CardMonitorTest, ReportsDeviceNodes) {
+    EXPECT_GE(card_monitor_get_fd(monitor), 0);
+    EXPECT_EQ(card_monitor_process(monitor, 0), 0);
+
+    Create("controlC7");
+    Create("pcmC7D0p");
+    Create("pcmC7D1c");
+    Create("comprC7D2");
+    Create("timer");
+    ASSERT_EQ(card_monitor_process(monitor, 1000), 4);
+    ASSERT_EQ(events.size(), 4);
+
+    EXPECT_EQ(events[0].type, CARD_EVENT_ADD);
+    EXPECT_EQ(events[0].device_type, CARD_DEVICE_CONTROL);
+    EXPECT_EQ(events[0].card, 7);
+    EXPECT_EQ(events[1].device_type, CARD_DEVICE_PCM_PLAYBACK);
+    EXPECT_EQ(events[1].device, 0);
+    EXPECT_EQ(events[2].device_type, CARD_DEVICE_PCM_CAPTURE);
+    EXPECT_EQ(events[2].device, 1);
+    EXPECT_EQ(events[3].device_type, CARD_DEVICE_COMPRESS);
+    EXPECT_EQ(events[3].device, 2);
+
+    events.clear();
+    Remove("pcmC7D0p");
+    Remove("controlC7");
+    ASSERT_EQ(card_monitor_process(monitor, 1000), 2);
+    ASSERT_EQ(events.size(), 2);
+    EXPECT_EQ(events[0].type, CARD_EVENT_REMOVE);
+    EXPECT_EQ(events[0].device_type, CARD_DEVICE_PCM_PLAYBACK);
+    EXPECT_EQ(events[1].type, CARD_EVENT_REMOVE);
+    EXPECT_EQ(events[1].device_type, CARD_DEVICE_CONTROL);
+    EXPECT_STREQ(events[0].id, events[1].id);
+}
+
+TEST_F(CardMonitorTest, IgnoresCardsBeyondTheKernelLimit) {
+    Create("controlC32");
+    EXPECT_EQ(card_monitor_process(monitor, 100), 0);
+    EXPECT_EQ(events.size(), 0);
+}
+
+TEST_F(CardMonitorTest, InvalidatesCardList) {
+    const card_list *before = card_list_get(CARD_LIST_CACHED);
+    ASSERT_NE(before, nullptr);
+
+    Create("controlC7");
+    ASSERT_EQ(card_monitor_process(monitor, 1000), 1);
+    const card_list *after = card_list_get(CARD_LIST_CACHED);
+    ASSERT_NE(after, nullptr);
+    EXPECT_NE(after, before);
+
+    card_list_free(after);
+    card_list_free(before);
+    card_list_invalidate();
+}
+
+TEST_F(CardMonitorTest, ReportsRemovedDirectory) {
+    ASSERT_EQ(rmdir(dir.c_str()), 0);
+    EXPECT_EQ(card_monitor_process(monitor, 1000), -ENODEV);
+    EXPECT_EQ(events.size(), 0);
+
+    card_monitor_close(monitor);
+    monitor = card_monitor_open(dir.c_str(), OnEvent, &events);
+    EXPECT_EQ(monitor, nullptr);
+}
+
+} // namespace testing
+} // namespace tinyalsa
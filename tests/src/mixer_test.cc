@@ -27,16 +27,28 @@
 */
 #include "pcm_test_device.h"
 
+#include <atomic>
+#include <cstring>
 #include <limits>
+#include <memory>
 #include <string_view>
 #include <string>
 #include <thread>
 #include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <sound/asound.h>
 
 #include <gtest/gtest.h>
 
+#include "tinyalsa/card.h"
 #include "tinyalsa/mixer.h"
 
 namespace tinyalsa {
@@ -106,6 +118,46 @@ TEST(MixerTest, NullParametersCheck) {
     EXPECT_EQ(mixer_read_event(nullptr, reinterpret_cast<mixer_ctl_event *>(1)), -EINVAL);
     EXPECT_EQ(mixer_read_event(reinterpret_cast<mixer *>(1), nullptr), -EINVAL);
     EXPECT_EQ(mixer_consume_event(nullptr), -EINVAL);
+    EXPECT_EQ(mixer_ctl_get_db(nullptr, 0, reinterpret_cast<int *>(1)), -EINVAL);
+    EXPECT_EQ(mixer_ctl_get_db(reinterpret_cast<mixer_ctl *>(1), 0, nullptr), -EINVAL);
+    EXPECT_EQ(mixer_ctl_get_db_range(nullptr, nullptr, nullptr), -EINVAL);
+    EXPECT_EQ(mixer_ctl_set_db(nullptr, 0, 0), -EINVAL);
+    EXPECT_EQ(mixer_read_events(nullptr, reinterpret_cast<mixer_ctl_event *>(1), 1), -EINVAL);
+    EXPECT_EQ(mixer_read_events(reinterpret_cast<mixer *>(1), nullptr, 1), -EINVAL);
+    EXPECT_EQ(mixer_ctl_set_event_callback(nullptr, nullptr, nullptr), -EINVAL);
+    EXPECT_EQ(mixer_dispatch_events(nullptr), -EINVAL);
+    EXPECT_EQ(mixer_snapshot_save(nullptr, nullptr, nullptr), -EINVAL);
+    EXPECT_EQ(mixer_snapshot_restore(nullptr, reinterpret_cast<const void *>(1), 1), -EINVAL);
+    EXPECT_EQ(mixer_snapshot_restore(reinterpret_cast<mixer *>(1), nullptr, 1), -EINVAL);
+    mixer_ramp_close(nullptr);
+    EXPECT_EQ(mixer_ramp_start(nullptr, nullptr, 0, 0, 0), -EINVAL);
+    EXPECT_EQ(mixer_ramp_cancel(nullptr, nullptr), -EINVAL);
+    EXPECT_EQ(mixer_ramp_wait(nullptr, nullptr, 0), -EINVAL);
+    EXPECT_EQ(mixer_route_open(nullptr, ""), nullptr);
+    EXPECT_EQ(mixer_route_open(reinterpret_cast<mixer *>(1), nullptr), nullptr);
+    mixer_route_close(nullptr);
+    EXPECT_EQ(mixer_route_get_num_paths(nullptr), 0);
+    EXPECT_EQ(mixer_route_get_path_name(nullptr, 0), nullptr);
+    EXPECT_EQ(mixer_route_apply_path(nullptr, ""), -EINVAL);
+    EXPECT_EQ(mixer_route_reset_path(nullptr, ""), -EINVAL);
+    mixer_route_reset(nullptr);
+    EXPECT_EQ(mixer_route_update(nullptr), -EINVAL);
+    EXPECT_EQ(mixer_get_id(nullptr), nullptr);
+    EXPECT_EQ(mixer_open_by_name(nullptr), nullptr);
+    EXPECT_EQ(mixer_find_ctls(nullptr, "", MIXER_FIND_PREFIX, nullptr, 0), -EINVAL);
+    EXPECT_EQ(mixer_ctl_subscribe_events(nullptr, 1), -EINVAL);
+    EXPECT_EQ(mixer_subscribe_events_by_name(nullptr, "", MIXER_FIND_PREFIX, 1), -EINVAL);
+    EXPECT_EQ(mixer_find_ctls(reinterpret_cast<mixer *>(1), nullptr, MIXER_FIND_PREFIX, nullptr, 0),
+              -EINVAL);
+    EXPECT_EQ(mixer_open_by_name("0"), nullptr);
+    EXPECT_EQ(mixer_open_by_name("hw:no such card"), nullptr);
+    mixer_manager_close(nullptr);
+    EXPECT_EQ(mixer_manager_get_num_mixers(nullptr), 0);
+    EXPECT_EQ(mixer_manager_get_mixer(nullptr, 0), nullptr);
+    EXPECT_EQ(mixer_manager_get_mixer_by_id(nullptr, ""), nullptr);
+    EXPECT_EQ(mixer_manager_get_ctl(nullptr, nullptr, "", 0), nullptr);
+    EXPECT_EQ(mixer_manager_get_ctls(nullptr, nullptr, nullptr, nullptr, 0), 0);
+    EXPECT_EQ(mixer_manager_update(nullptr), -EINVAL);
 }
 
 class MixerTest : public ::testing::TestWithParam<unsigned int> {
@@ -130,6 +182,121 @@ TEST_P(MixerTest, AddNewControls) {
     ASSERT_EQ(mixer_add_new_ctls(mixer_object), 0);
 }
 
+// Removes the user control of a test, if still present, and closes the control device
+class UserControlGuard {
+  public:
+    UserControlGuard(int fd, const char *name) : fd_(fd) {
+        memset(&id_, 0, sizeof(id_));
+        id_.iface = SNDRV_CTL_ELEM_IFACE_MIXER;
+        strncpy(reinterpret_cast<char *>(id_.name), name, sizeof(id_.name) - 1);
+    }
+
+    ~UserControlGuard() {
+        Remove();
+        close(fd_);
+    }
+
+    UserControlGuard(const UserControlGuard &) = delete;
+    UserControlGuard &operator=(const UserControlGuard &) = delete;
+
+    int Remove() { return ioctl(fd_, SNDRV_CTL_IOCTL_ELEM_REMOVE, &id_); }
+
+  private:
+    int fd_;
+    snd_ctl_elem_id id_;
+};
+
+TEST_P(MixerTest, TrackAddedAndRemovedControls) {
+    static constexpr char kName[] = "Tinyalsa Test Volume";
+
+    // user controls can be added to any card through its control device
+    std::string path = "/dev/snd/controlC" + std::to_string(GetParam());
+    int fd = open(path.c_str(), O_RDWR);
+    if (fd < 0) {
+        GTEST_SKIP() << "The control device of the card could not be opened.";
+    }
+    UserControlGuard guard(fd, kName);
+
+    ASSERT_EQ(mixer_subscribe_events(mixer_object, 1), 0);
+    unsigned int count = mixer_get_num_ctls(mixer_object);
+
+    snd_ctl_elem_info info;
+    memset(&info, 0, sizeof(info));
+    info.id.iface = SNDRV_CTL_ELEM_IFACE_MIXER;
+    strncpy(reinterpret_cast<char *>(info.id.name), kName, sizeof(info.id.name) - 1);
+    info.type = SNDRV_CTL_ELEM_TYPE_INTEGER;
+    info.access = SNDRV_CTL_ELEM_ACCESS_READWRITE;
+    info.count = 1;
+    info.value.integer.min = 0;
+    info.value.integer.max = 100;
+    info.value.integer.step = 1;
+    if (ioctl(fd, SNDRV_CTL_IOCTL_ELEM_ADD, &info) < 0) {
+        GTEST_SKIP() << "The card does not support user controls.";
+    }
+
+    // the control is added as its event is read, without mixer_add_new_ctls()
+    mixer_ctl_event events[16];
+    mixer_ctl *ctl = nullptr;
+    while (!ctl && mixer_wait_event(mixer_object, 1000) > 0) {
+        mixer_read_events(mixer_object, events, 16);
+        ctl = mixer_get_ctl_by_name(mixer_object, kName);
+    }
+    ASSERT_NE(ctl, nullptr);
+    EXPECT_EQ(mixer_get_num_ctls(mixer_object), count + 1);
+    EXPECT_EQ(mixer_ctl_set_value(ctl, 0, 50), 0);
+    EXPECT_EQ(mixer_ctl_get_value(ctl, 0), 50);
+    ASSERT_EQ(mixer_ctl_subscribe_events(ctl, 1), 0);
+
+    ASSERT_EQ(guard.Remove(), 0);
+
+    while (mixer_get_ctl_by_name(mixer_object, kName) &&
+            mixer_wait_event(mixer_object, 1000) > 0) {
+        mixer_read_events(mixer_object, events, 16);
+    }
+    EXPECT_EQ(mixer_get_ctl_by_name(mixer_object, kName), nullptr);
+    EXPECT_EQ(mixer_get_num_ctls(mixer_object), count);
+
+    // the handle of the removed control remains valid
+    EXPECT_STREQ(mixer_ctl_get_name(ctl), kName);
+    EXPECT_EQ(mixer_ctl_set_value(ctl, 0, 0), -ENODEV);
+    EXPECT_EQ(mixer_ctl_get_value(ctl, 0), -ENODEV);
+    int values[1];
+    EXPECT_EQ(mixer_ctl_get_array(ctl, values, 1), -ENODEV);
+    EXPECT_EQ(mixer_ctl_set_array(ctl, values, 1), -ENODEV);
+    // its subscription went with it
+    EXPECT_EQ(mixer_ctl_subscribe_events(ctl, 0), 0);
+    EXPECT_EQ(mixer_add_new_ctls(mixer_object), 0);
+    EXPECT_EQ(mixer_get_num_ctls(mixer_object), count);
+
+    // a control added back works again through the handle of the removed one
+    info.id.numid = 0;
+    ASSERT_EQ(ioctl(fd, SNDRV_CTL_IOCTL_ELEM_ADD, &info), 0);
+    EXPECT_EQ(mixer_add_new_ctls(mixer_object), 0);
+    EXPECT_EQ(mixer_get_ctl_by_name(mixer_object, kName), ctl);
+    EXPECT_EQ(mixer_get_num_ctls(mixer_object), count + 1);
+    EXPECT_EQ(mixer_ctl_set_value(ctl, 0, 25), 0);
+    EXPECT_EQ(mixer_ctl_get_value(ctl, 0), 25);
+
+    mixer_subscribe_events(mixer_object, 0);
+}
+
+TEST_P(MixerTest, OpenByName) {
+    std::string name = "hw:" + std::to_string(GetParam());
+    mixer *by_number = mixer_open_by_name(name.c_str());
+    ASSERT_NE(by_number, nullptr);
+    EXPECT_STREQ(mixer_get_id(by_number), mixer_get_id(mixer_object));
+    mixer_close(by_number);
+
+    // plugin cards are not known by id
+    const char *id = mixer_get_id(mixer_object);
+    if (card_get_index(id) == static_cast<int>(GetParam())) {
+        mixer *by_id = mixer_open_by_name((std::string{"hw:"} + id).c_str());
+        ASSERT_NE(by_id, nullptr);
+        EXPECT_STREQ(mixer_get_id(by_id), id);
+        mixer_close(by_id);
+    }
+}
+
 TEST_P(MixerTest, GetName) {
     const char *name = mixer_get_name(mixer_object);
     std::cout << name << std::endl;
@@ -184,6 +351,24 @@ TEST_P(MixerControlsTest, GetNumberOfControlsByName) {
     ASSERT_EQ(mixer_get_num_ctls_by_name(mixer_object, name.c_str()), 0);
 }
 
+TEST_P(MixerControlsTest, ControlsShareNames) {
+    for (unsigned int i = 0; i < number_of_controls; ++i) {
+        const char *name = mixer_ctl_get_name(controls[i]);
+        unsigned int same_name = 0;
+        for (unsigned int j = 0; j < number_of_controls; ++j) {
+            if (strcmp(mixer_ctl_get_name(controls[j]), name) == 0) {
+                // controls of the same name hold the same string
+                EXPECT_EQ(mixer_ctl_get_name(controls[j]), name);
+                same_name++;
+            }
+        }
+        EXPECT_EQ(mixer_get_num_ctls_by_name(mixer_object, name), same_name);
+        EXPECT_NE(mixer_get_ctl_by_name_and_device(mixer_object, name,
+                                                   mixer_ctl_get_device(controls[i])),
+                  nullptr);
+    }
+}
+
 TEST_P(MixerControlsTest, GetControlById) {
     for (unsigned int i = 0; i < number_of_controls; ++i) {
         ASSERT_EQ(mixer_get_ctl(mixer_object, i), controls[i]);
@@ -224,6 +409,45 @@ static inline bool IsValidTypeString(std::string& type) {
             type == "IEC958" || type == "INT64";
 }
 
+TEST_P(MixerControlsTest, FindControls) {
+    std::vector<mixer_ctl *> found(number_of_controls);
+    EXPECT_EQ(mixer_find_ctls(mixer_object, "", MIXER_FIND_PREFIX, found.data(), found.size()),
+              static_cast<int>(number_of_controls));
+    EXPECT_EQ(mixer_find_ctls(mixer_object, "*", MIXER_FIND_GLOB, nullptr, 0),
+              static_cast<int>(number_of_controls));
+    EXPECT_EQ(mixer_find_ctls(mixer_object, ".*", MIXER_FIND_REGEX, nullptr, 0),
+              static_cast<int>(number_of_controls));
+    EXPECT_EQ(mixer_find_ctls(mixer_object, "(", MIXER_FIND_REGEX, nullptr, 0), -EINVAL);
+
+    for (unsigned int i = 0; i < number_of_controls; ++i) {
+        std::string name{mixer_ctl_get_name(controls[i])};
+        std::string prefix = name.substr(0, name.size() / 2);
+        unsigned int expected = 0;
+        for (unsigned int j = 0; j < number_of_controls; ++j) {
+            if (!strncmp(mixer_ctl_get_name(controls[j]), prefix.c_str(), prefix.size())) {
+                expected++;
+            }
+        }
+
+        int count = mixer_find_ctls(mixer_object, prefix.c_str(), MIXER_FIND_PREFIX,
+                                    found.data(), found.size());
+        ASSERT_EQ(count, static_cast<int>(expected));
+        for (int j = 0; j < count; ++j) {
+            EXPECT_EQ(strncmp(mixer_ctl_get_name(found[j]), prefix.c_str(), prefix.size()), 0);
+            if (j > 0) {
+                EXPECT_LE(strcmp(mixer_ctl_get_name(found[j - 1]), mixer_ctl_get_name(found[j])), 0);
+            }
+        }
+
+        EXPECT_EQ(mixer_find_ctls(mixer_object, (prefix + "*").c_str(), MIXER_FIND_GLOB,
+                                  nullptr, 0), count);
+        EXPECT_GE(mixer_find_ctls(mixer_object, ("*" + name.substr(name.size() / 2)).c_str(),
+                                  MIXER_FIND_GLOB, nullptr, 0), 1);
+        EXPECT_EQ(mixer_find_ctls(mixer_object, name.c_str(), MIXER_FIND_GLOB, nullptr, 0),
+                  static_cast<int>(mixer_get_num_ctls_by_name(mixer_object, name.c_str())));
+    }
+}
+
 TEST_P(MixerControlsTest, GetControlTypeString) {
     ASSERT_STREQ(mixer_ctl_get_type_string(nullptr), "");
 
@@ -253,9 +477,55 @@ TEST_P(MixerControlsTest, GetNumberOfEnumsAndEnumString) {
     }
 }
 
+TEST_P(MixerControlsTest, SetEnumByString) {
+    for (unsigned int i = 0; i < number_of_controls; ++i) {
+        mixer_ctl *control = const_cast<mixer_ctl *>(controls[i]);
+        if (mixer_ctl_get_type(control) != MIXER_CTL_TYPE_ENUM) {
+            continue;
+        }
+        int value = mixer_ctl_get_value(control, 0);
+        const char *enum_name = mixer_ctl_get_enum_string(control, value);
+        ASSERT_NE(enum_name, nullptr);
+        std::string unknown_name{enum_name};
+        unknown_name += " unknown";
+        EXPECT_EQ(mixer_ctl_set_enum_by_string(control, unknown_name.c_str()), -EINVAL);
+        if (mixer_ctl_set_enum_by_string(control, enum_name) == 0) {
+            EXPECT_EQ(mixer_ctl_get_value(control, 0), value);
+        }
+    }
+}
+
+TEST_P(MixerControlsTest, EnumStringOutlivesUpdate) {
+    for (unsigned int i = 0; i < number_of_controls; ++i) {
+        mixer_ctl *control = const_cast<mixer_ctl *>(controls[i]);
+        if (mixer_ctl_get_type(control) != MIXER_CTL_TYPE_ENUM) {
+            continue;
+        }
+        const char *enum_name = mixer_ctl_get_enum_string(control, 0);
+        ASSERT_NE(enum_name, nullptr);
+        std::string copy{enum_name};
+        mixer_ctl_update(control);
+        EXPECT_EQ(copy, enum_name);
+        // the names are only reloaded when the items change
+        EXPECT_EQ(mixer_ctl_get_enum_string(control, 0), enum_name);
+    }
+}
+
 TEST_P(MixerControlsTest, UpdateControl) {
     for (unsigned int i = 0; i < number_of_controls; ++i) {
+        const char *name = mixer_ctl_get_name(controls[i]);
+        mixer_ctl_type type = mixer_ctl_get_type(controls[i]);
+        unsigned int num_values = mixer_ctl_get_num_values(controls[i]);
+        int min = mixer_ctl_get_range_min(controls[i]);
+        int max = mixer_ctl_get_range_max(controls[i]);
+
         mixer_ctl_update(const_cast<mixer_ctl *>(controls[i]));
+
+        EXPECT_EQ(mixer_ctl_get_name(controls[i]), name);
+        EXPECT_EQ(mixer_ctl_get_type(controls[i]), type);
+        EXPECT_EQ(mixer_ctl_get_num_values(controls[i]), num_values);
+        EXPECT_EQ(mixer_ctl_get_range_min(controls[i]), min);
+        EXPECT_EQ(mixer_ctl_get_range_max(controls[i]), max);
     }
 }
 
@@ -315,6 +585,35 @@ TEST_P(MixerControlsTest, SetPercent) {
     }
 }
 
+TEST_P(MixerControlsTest, Db) {
+    for (unsigned int i = 0; i < number_of_controls; ++i) {
+        mixer_ctl *control = const_cast<mixer_ctl *>(controls[i]);
+        int min_db, max_db, db;
+        if (mixer_ctl_get_type(control) != MIXER_CTL_TYPE_INT) {
+            ASSERT_EQ(mixer_ctl_get_db_range(control, &min_db, &max_db), -EINVAL);
+            continue;
+        }
+        if (mixer_ctl_get_db_range(control, &min_db, &max_db) != 0) {
+            continue;
+        }
+        ASSERT_LE(min_db, max_db);
+        ASSERT_EQ(mixer_ctl_get_db(control, 0, &db), 0);
+        ASSERT_GE(db, min_db);
+        ASSERT_LE(db, max_db);
+
+        int value = mixer_ctl_get_value(control, 0);
+        if (mixer_ctl_set_db(control, 0, max_db) == 0) {
+            EXPECT_EQ(mixer_ctl_get_value(control, 0), mixer_ctl_get_range_max(control));
+            EXPECT_EQ(mixer_ctl_get_db(control, 0, &db), 0);
+            EXPECT_EQ(db, max_db);
+        }
+        if (mixer_ctl_set_db(control, 0, MIXER_CTL_DB_MUTE) == 0) {
+            EXPECT_EQ(mixer_ctl_get_value(control, 0), mixer_ctl_get_range_min(control));
+        }
+        mixer_ctl_set_value(control, 0, value);
+    }
+}
+
 TEST_P(MixerControlsTest, Event) {
     ASSERT_EQ(mixer_subscribe_events(mixer_object, 1), 0);
     const mixer_ctl *control = nullptr;
@@ -349,6 +648,358 @@ TEST_P(MixerControlsTest, Event) {
     mixer_ctl_set_percent(const_cast<mixer_ctl *>(control), 0, percent);
 }
 
+TEST_P(MixerControlsTest, Snapshot) {
+    void *data = nullptr;
+    size_t size = 0;
+    ASSERT_EQ(mixer_snapshot_save(mixer_object, &data, &size), 0);
+    ASSERT_NE(data, nullptr);
+    std::unique_ptr<void, decltype(&free)> snapshot{data, &free};
+
+    // nothing changed since the snapshot was taken
+    EXPECT_EQ(mixer_snapshot_restore(mixer_object, data, size), 0);
+    EXPECT_EQ(mixer_snapshot_restore(mixer_object, data, size - 1), -EINVAL);
+
+    std::unique_ptr<uint8_t []> corrupted = std::make_unique<uint8_t []>(size);
+    memcpy(corrupted.get(), data, size);
+    corrupted[0] ^= 0xff;
+    EXPECT_EQ(mixer_snapshot_restore(mixer_object, corrupted.get(), size), -EINVAL);
+
+    for (unsigned int i = 0; i < number_of_controls; ++i) {
+        mixer_ctl *control = const_cast<mixer_ctl *>(controls[i]);
+        if (mixer_ctl_get_type(control) != MIXER_CTL_TYPE_INT ||
+                mixer_ctl_get_range_max(control) <= mixer_ctl_get_range_min(control)) {
+            continue;
+        }
+        int value = mixer_ctl_get_value(control, 0);
+        int other = value == mixer_ctl_get_range_max(control) ?
+                mixer_ctl_get_range_min(control) : mixer_ctl_get_range_max(control);
+        if (mixer_ctl_set_value(control, 0, other) == 0 &&
+                mixer_ctl_get_value(control, 0) == other) {
+            EXPECT_EQ(mixer_snapshot_restore(mixer_object, data, size), 1);
+            EXPECT_EQ(mixer_ctl_get_value(control, 0), value);
+            break;
+        }
+    }
+}
+
+TEST_P(MixerControlsTest, Route) {
+    const mixer_ctl *control = nullptr;
+    for (unsigned int i = 0; i < number_of_controls; ++i) {
+        if (mixer_ctl_get_type(controls[i]) == MIXER_CTL_TYPE_INT &&
+                mixer_ctl_get_range_max(controls[i]) > mixer_ctl_get_range_min(controls[i]) &&
+                mixer_get_ctl_by_name(mixer_object, mixer_ctl_get_name(controls[i])) ==
+                        controls[i]) {
+            control = controls[i];
+            break;
+        }
+    }
+
+    if (control == nullptr) {
+        GTEST_SKIP() << "No integer control was found in the controls list.";
+    }
+
+    int value = mixer_ctl_get_value(control, 0);
+    int target = value == mixer_ctl_get_range_max(control) ?
+            mixer_ctl_get_range_min(control) : mixer_ctl_get_range_max(control);
+
+    char file_name[] = "/tmp/mixer_route_XXXXXX";
+    int fd = mkstemp(file_name);
+    ASSERT_GE(fd, 0);
+    std::string paths = "# test paths\n[test]\n";
+    paths += std::string{mixer_ctl_get_name(control)} + " = " + std::to_string(target) + "\n";
+    paths += "[empty]\n";
+    ASSERT_EQ(write(fd, paths.data(), paths.size()), static_cast<ssize_t>(paths.size()));
+    close(fd);
+
+    mixer_route *route = mixer_route_open(mixer_object, file_name);
+    unlink(file_name);
+    ASSERT_NE(route, nullptr);
+    ASSERT_EQ(mixer_route_get_num_paths(route), 2);
+    EXPECT_STREQ(mixer_route_get_path_name(route, 0), "test");
+    EXPECT_STREQ(mixer_route_get_path_name(route, 1), "empty");
+    EXPECT_EQ(mixer_route_get_path_name(route, 2), nullptr);
+    EXPECT_EQ(mixer_route_apply_path(route, "missing"), -EINVAL);
+
+    EXPECT_EQ(mixer_route_apply_path(route, "test"), 0);
+    if (mixer_route_update(route) == 1) {
+        EXPECT_EQ(mixer_ctl_get_value(control, 0), target);
+        // nothing changed since the last update
+        EXPECT_EQ(mixer_route_update(route), 0);
+    }
+
+    EXPECT_EQ(mixer_route_reset_path(route, "test"), 0);
+    mixer_route_update(route);
+    EXPECT_EQ(mixer_ctl_get_value(control, 0), value);
+
+    mixer_route_close(route);
+}
+
+TEST_P(MixerControlsTest, EventCallback) {
+    mixer_ctl *control = nullptr;
+    for (unsigned int i = 0; i < number_of_controls; ++i) {
+        std::string_view name{mixer_ctl_get_name(controls[i])};
+
+        if (name.find("Volume") != std::string_view::npos) {
+            control = const_cast<mixer_ctl *>(controls[i]);
+        }
+    }
+
+    if (control == nullptr) {
+        GTEST_SKIP() << "No volume control was found in the controls list.";
+    }
+
+    ASSERT_EQ(mixer_subscribe_events(mixer_object, 1), 0);
+
+    mixer_ctl_event events[16];
+    // drop the events that are already pending
+    while (mixer_read_events(mixer_object, events, 16) > 0) {
+    }
+
+    std::pair<mixer_ctl *, unsigned int> calls{control, 0};
+    ASSERT_EQ(mixer_ctl_set_event_callback(
+            control,
+            [](mixer_ctl *ctl, const mixer_ctl_event *, void *data) {
+                auto *calls = static_cast<std::pair<mixer_ctl *, unsigned int> *>(data);
+                EXPECT_EQ(ctl, calls->first);
+                calls->second++;
+            },
+            &calls), 0);
+
+    int percent = mixer_ctl_get_percent(control, 0);
+    ASSERT_EQ(mixer_ctl_set_percent(
+            control, 0, percent == k100Percent ? k0Percent : k100Percent), 0);
+    EXPECT_EQ(mixer_wait_event(mixer_object, 1000), 1);
+    EXPECT_GE(mixer_dispatch_events(mixer_object), 1);
+    EXPECT_GE(calls.second, 1);
+
+    ASSERT_EQ(mixer_ctl_set_event_callback(control, nullptr, nullptr), 0);
+    mixer_ctl_set_percent(control, 0, percent);
+    EXPECT_EQ(mixer_wait_event(mixer_object, 1000), 1);
+    EXPECT_GE(mixer_read_events(mixer_object, events, 16), 1);
+    EXPECT_EQ(mixer_read_events(mixer_object, events, 16), 0);
+
+    ASSERT_EQ(mixer_subscribe_events(mixer_object, 0), 0);
+}
+
+TEST_P(MixerControlsTest, EventFilter) {
+    std::vector<mixer_ctl *> volumes;
+    for (unsigned int i = 0; i < number_of_controls; ++i) {
+        std::string_view name{mixer_ctl_get_name(controls[i])};
+        if (name.find("Volume") != std::string_view::npos &&
+                mixer_ctl_get_type(controls[i]) == MIXER_CTL_TYPE_INT) {
+            volumes.push_back(const_cast<mixer_ctl *>(controls[i]));
+        }
+    }
+
+    if (volumes.size() < 2) {
+        GTEST_SKIP() << "Fewer than two volume controls were found in the controls list.";
+    }
+
+    mixer_ctl *wanted = volumes[0];
+    mixer_ctl *other = volumes[1];
+    ASSERT_EQ(mixer_ctl_subscribe_events(wanted, 1), 0);
+
+    mixer_ctl_event events[16];
+    // drop the events that are already pending
+    while (mixer_read_events(mixer_object, events, 16) > 0) {
+    }
+
+    int other_percent = mixer_ctl_get_percent(other, 0);
+    ASSERT_EQ(mixer_ctl_set_percent(
+            other, 0, other_percent == k100Percent ? k0Percent : k100Percent), 0);
+    EXPECT_EQ(mixer_wait_event(mixer_object, 100), 0);
+
+    int percent = mixer_ctl_get_percent(wanted, 0);
+    ASSERT_EQ(mixer_ctl_set_percent(
+            wanted, 0, percent == k100Percent ? k0Percent : k100Percent), 0);
+    EXPECT_EQ(mixer_wait_event(mixer_object, 1000), 1);
+    mixer_ctl_event event;
+    ASSERT_EQ(mixer_read_event(mixer_object, &event), 1);
+    EXPECT_STREQ(reinterpret_cast<const char *>(event.data.element.id.name),
+                 mixer_ctl_get_name(wanted));
+    EXPECT_EQ(mixer_read_event(mixer_object, &event), 0);
+
+    ASSERT_EQ(mixer_ctl_subscribe_events(wanted, 0), 0);
+    mixer_ctl_set_percent(wanted, 0, percent);
+    mixer_ctl_set_percent(other, 0, other_percent);
+
+    std::string pattern{mixer_ctl_get_name(wanted)};
+    EXPECT_GE(mixer_subscribe_events_by_name(mixer_object, pattern.c_str(), MIXER_FIND_GLOB, 1), 1);
+    EXPECT_GE(mixer_subscribe_events_by_name(mixer_object, pattern.c_str(), MIXER_FIND_GLOB, 0), 1);
+}
+
+TEST_P(MixerControlsTest, EventFilterKeepsSubscription) {
+    std::vector<mixer_ctl *> volumes;
+    for (unsigned int i = 0; i < number_of_controls; ++i) {
+        std::string_view name{mixer_ctl_get_name(controls[i])};
+        if (name.find("Volume") != std::string_view::npos &&
+                mixer_ctl_get_type(controls[i]) == MIXER_CTL_TYPE_INT) {
+            volumes.push_back(const_cast<mixer_ctl *>(controls[i]));
+        }
+    }
+
+    if (volumes.size() < 2) {
+        GTEST_SKIP() << "Fewer than two volume controls were found in the controls list.";
+    }
+
+    mixer_ctl *wanted = volumes[0];
+    mixer_ctl *other = volumes[1];
+    ASSERT_EQ(mixer_subscribe_events(mixer_object, 1), 0);
+    ASSERT_EQ(mixer_ctl_subscribe_events(wanted, 1), 0);
+
+    mixer_ctl_event events[16];
+    while (mixer_read_events(mixer_object, events, 16) > 0) {
+    }
+
+    // an event queued by the filter is still read once the filter is gone
+    int percent = mixer_ctl_get_percent(wanted, 0);
+    ASSERT_EQ(mixer_ctl_set_percent(
+            wanted, 0, percent == k100Percent ? k0Percent : k100Percent), 0);
+    EXPECT_EQ(mixer_wait_event(mixer_object, 1000), 1);
+    ASSERT_EQ(mixer_ctl_subscribe_events(wanted, 0), 0);
+    mixer_ctl_event event;
+    ASSERT_EQ(mixer_read_event(mixer_object, &event), 1);
+    EXPECT_STREQ(reinterpret_cast<const char *>(event.data.element.id.name),
+                 mixer_ctl_get_name(wanted));
+
+    // the subscription of the mixer outlives the filter
+    int other_percent = mixer_ctl_get_percent(other, 0);
+    ASSERT_EQ(mixer_ctl_set_percent(
+            other, 0, other_percent == k100Percent ? k0Percent : k100Percent), 0);
+    EXPECT_EQ(mixer_wait_event(mixer_object, 1000), 1);
+    EXPECT_GE(mixer_read_events(mixer_object, events, 16), 1);
+
+    mixer_ctl_set_percent(wanted, 0, percent);
+    mixer_ctl_set_percent(other, 0, other_percent);
+    ASSERT_EQ(mixer_subscribe_events(mixer_object, 0), 0);
+}
+
+TEST_P(MixerControlsTest, Ramp) {
+    mixer_ctl *control = nullptr;
+    for (unsigned int i = 0; i < number_of_controls; ++i) {
+        if (mixer_ctl_get_type(controls[i]) == MIXER_CTL_TYPE_INT &&
+                mixer_ctl_get_range_max(controls[i]) > mixer_ctl_get_range_min(controls[i]) &&
+                mixer_ctl_set_value(const_cast<mixer_ctl *>(controls[i]), 0,
+                                    mixer_ctl_get_value(controls[i], 0)) == 0) {
+            control = const_cast<mixer_ctl *>(controls[i]);
+            break;
+        }
+    }
+
+    if (control == nullptr) {
+        GTEST_SKIP() << "No writable integer control was found in the controls list.";
+    }
+
+    int value = mixer_ctl_get_value(control, 0);
+    int min = mixer_ctl_get_range_min(control);
+    int max = mixer_ctl_get_range_max(control);
+
+    mixer_ramp *ramp = mixer_ramp_open();
+    ASSERT_NE(ramp, nullptr);
+    EXPECT_EQ(mixer_ramp_cancel(ramp, control), -ENOENT);
+
+    ASSERT_EQ(mixer_ramp_start(ramp, control, min, max, 50), 0);
+    EXPECT_EQ(mixer_ramp_wait(ramp, control, 1000), 0);
+    EXPECT_EQ(mixer_ctl_get_value(control, 0), max);
+
+    // the second ramp replaces the first one
+    ASSERT_EQ(mixer_ramp_start(ramp, control, max, min, 10000), 0);
+    ASSERT_EQ(mixer_ramp_start(ramp, control, max, min, 20), 0);
+    EXPECT_EQ(mixer_ramp_wait(ramp, control, 1000), 0);
+    EXPECT_EQ(mixer_ctl_get_value(control, 0), min);
+
+    ASSERT_EQ(mixer_ramp_start(ramp, control, min, max, 10000), 0);
+    EXPECT_EQ(mixer_ramp_wait(ramp, control, 0), -ETIMEDOUT);
+    EXPECT_EQ(mixer_ramp_cancel(ramp, control), 0);
+    EXPECT_EQ(mixer_ramp_wait(ramp, control, 0), 0);
+
+    mixer_ramp_close(ramp);
+    mixer_ctl_set_value(control, 0, value);
+}
+
+TEST_P(MixerControlsTest, ConcurrentAccess) {
+    std::vector<std::thread> threads;
+    std::atomic<unsigned int> mismatches{0};
+
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&]() {
+            for (unsigned int i = 0; i < number_of_controls; ++i) {
+                if (mixer_get_ctl_const(mixer_object, i) != controls[i]) {
+                    mismatches++;
+                }
+                const char *name = mixer_ctl_get_name(controls[i]);
+                if (mixer_get_num_ctls_by_name(mixer_object, name) == 0) {
+                    mismatches++;
+                }
+                mixer_ctl *control = const_cast<mixer_ctl *>(controls[i]);
+                for (unsigned int j = 0; j < mixer_ctl_get_num_enums(control); ++j) {
+                    if (mixer_ctl_get_enum_string(control, j) == nullptr) {
+                        mismatches++;
+                    }
+                }
+            }
+        });
+    }
+
+    // handles obtained before stay valid while controls are added
+    EXPECT_EQ(mixer_add_new_ctls(mixer_object), 0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(mismatches, 0u);
+    for (unsigned int i = 0; i < number_of_controls; ++i) {
+        EXPECT_EQ(mixer_get_ctl_const(mixer_object, i), controls[i]);
+    }
+}
+
+TEST_P(MixerControlsTest, Manager) {
+    unsigned int card = GetParam();
+    mixer_manager *manager = mixer_manager_open(&card, 1);
+    ASSERT_NE(manager, nullptr);
+    ASSERT_EQ(mixer_manager_get_num_mixers(manager), 1);
+
+    mixer *managed = mixer_manager_get_mixer(manager, 0);
+    ASSERT_NE(managed, nullptr);
+    const char *card_id = mixer_get_id(mixer_object);
+    ASSERT_NE(card_id, nullptr);
+    EXPECT_STREQ(mixer_get_id(managed), card_id);
+    EXPECT_EQ(mixer_manager_get_mixer_by_id(manager, card_id), managed);
+    EXPECT_EQ(mixer_manager_get_mixer(manager, 1), nullptr);
+
+    std::unordered_map<std::string, unsigned int> indexes;
+    for (unsigned int i = 0; i < number_of_controls; ++i) {
+        const char *name = mixer_ctl_get_name(controls[i]);
+        unsigned int index = indexes[name]++;
+        mixer_ctl *control = mixer_manager_get_ctl(manager, card_id, name, index);
+        ASSERT_NE(control, nullptr);
+        EXPECT_EQ(control, mixer_get_ctl_by_name_and_index(managed, name, index));
+        EXPECT_EQ(control, mixer_manager_get_ctl(manager, nullptr, name, index));
+    }
+
+    const char *names[] = { mixer_ctl_get_name(controls[0]), "no such control" };
+    mixer_ctl *found[2];
+    EXPECT_EQ(mixer_manager_get_ctls(manager, card_id, names, found, 2), 1);
+    EXPECT_EQ(found[0], mixer_get_ctl_by_name(managed, names[0]));
+    EXPECT_EQ(found[1], nullptr);
+
+    EXPECT_EQ(mixer_manager_update(manager), 0);
+
+    card_event event{};
+    event.type = CARD_EVENT_REMOVE;
+    event.device_type = CARD_DEVICE_CONTROL;
+    event.card = card;
+    EXPECT_EQ(mixer_manager_handle_card_event(manager, &event), 0);
+    EXPECT_EQ(mixer_manager_get_num_mixers(manager), 0);
+    EXPECT_EQ(mixer_manager_get_ctl(manager, nullptr, names[0], 0), nullptr);
+
+    event.type = CARD_EVENT_ADD;
+    EXPECT_EQ(mixer_manager_handle_card_event(manager, &event), 0);
+    ASSERT_EQ(mixer_manager_get_num_mixers(manager), 1);
+    EXPECT_NE(mixer_manager_get_ctl(manager, card_id, names[0], 0), nullptr);
+    mixer_manager_close(manager);
+}
+
 INSTANTIATE_TEST_SUITE_P(
     MixerTest,
     MixerTest,
@@ -76,6 +76,21 @@ TEST_F(PcmOutTest, GetFileDescriptor) {
     ASSERT_GT(pcm_get_file_descriptor(pcm_object), 0);
 }
 
+TEST_F(PcmOutTest, PollDescriptor) {
+    pollfd pfd;
+    short revents = 0;
+    ASSERT_EQ(pcm_poll_descriptor(nullptr, &pfd), -EINVAL);
+    ASSERT_EQ(pcm_poll_descriptor(pcm_object, nullptr), -EINVAL);
+    ASSERT_EQ(pcm_poll_descriptor(pcm_object, &pfd), 0);
+    ASSERT_EQ(pfd.fd, pcm_get_poll_fd(pcm_object));
+    ASSERT_EQ(pcm_poll_revents(pcm_object, &pfd, nullptr), -EINVAL);
+
+    ASSERT_EQ(pcm_prepare(pcm_object), 0);
+    ASSERT_EQ(poll(&pfd, 1, 1000), 1);
+    ASSERT_EQ(pcm_poll_revents(pcm_object, &pfd, &revents), 0);
+    ASSERT_TRUE(revents & POLLOUT);
+}
+
 TEST_F(PcmOutTest, GetChannels) {
     ASSERT_EQ(pcm_get_channels(pcm_object), kDefaultConfig.channels);
 }
@@ -0,0 +1,442 @@
+/* pcm_plugin_test.cc
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are met:
+**     * Redistributions of source code must retain the above copyright
+**       notice, this list of conditions and the following disclaimer.
+**     * Redistributions in binary form must reproduce the above copyright
+**       notice, this list of conditions and the following disclaimer in the
+**       documentation and/or other materials provided with the distribution.
+**     * Neither the name of The Android Open Source Project nor the names of
+**       its contributors may be used to endorse or promote products derived
+**       from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY The Android Open Source Project ``AS IS'' AND
+** ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+** IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+** ARE DISCLAIMED. IN NO EVENT SHALL The Android Open Source Project BE LIABLE
+** FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+** DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+** SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+** CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+** LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+** OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+** DAMAGE.
+*/
+
+#include <dlfcn.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "stub_pcm_plugin.h"
+#include "tinyalsa/card.h"
+#include "tinyalsa/pcm.h"
+#include "tinyalsa/plugin.h"
+
+namespace tinyalsa {
+namespace testing {
+
+#ifndef TEST_STUB_CARD
+#define TEST_STUB_CARD 101
+#endif
+
+static constexpr unsigned int kStubCard = TEST_STUB_CARD;
+static constexpr unsigned int kStubDevice = 0;
+static constexpr unsigned int kStubQueueDevice = 1;
+static constexpr unsigned int kStubChainDevice = 2;
+static constexpr unsigned int kStubLoopDevice = 3;
+static constexpr unsigned int kStubResidentDevice = 5;
+
+static constexpr unsigned int kChannels = 2;
+static constexpr unsigned int kPeriodSize = 256;
+static constexpr unsigned int kPeriodCount = 4;
+static constexpr pcm_config kStubConfig = {
+    .channels = kChannels,
+    .rate = 48000,
+    .period_size = kPeriodSize,
+    .period_count = kPeriodCount,
+    .format = PCM_FORMAT_S16_LE,
+    .start_threshold = 0,
+    .stop_threshold = 0,
+    .silence_threshold = 0,
+    .silence_size = 0,
+};
+
+class PcmPluginTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // keep the stub loaded, for its counters and operations to outlive the PCMs
+        handle = dlopen(STUB_PCM_PLUGIN_LIB, RTLD_NOW);
+        ASSERT_NE(handle, nullptr) << dlerror();
+        calls = static_cast<stub_pcm_plugin_calls *>(dlsym(handle, STUB_PCM_PLUGIN_CALLS));
+        ASSERT_NE(calls, nullptr);
+        ext_ops = static_cast<pcm_plugin_ext_ops *>(dlsym(handle, "pcm_plugin_ext_ops"));
+        ASSERT_NE(ext_ops, nullptr);
+        saved_ext_ops = *ext_ops;
+        *calls = {};
+    }
+
+    void TearDown() override {
+        if (handle) {
+            *ext_ops = saved_ext_ops;
+            dlclose(handle);
+        }
+    }
+
+    void WritePeriods(pcm *pcm, unsigned int periods) {
+        std::vector<int16_t> buffer(kPeriodSize * kChannels);
+        for (unsigned int i = 0; i < periods; i++) {
+            ASSERT_EQ(pcm_writei(pcm, buffer.data(), kPeriodSize), (int) kPeriodSize)
+                    << pcm_get_error(pcm);
+        }
+    }
+
+    void *handle = nullptr;
+    stub_pcm_plugin_calls *calls = nullptr;
+    pcm_plugin_ext_ops *ext_ops = nullptr;
+    pcm_plugin_ext_ops saved_ext_ops = {};
+};
+
+TEST_F(PcmPluginTest, SharesStatusAndControlWhenAsked) {
+    ext_ops->flags = PCM_PLUGIN_SHARED_PTRS;
+
+    pcm *pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &kStubConfig);
+    ASSERT_TRUE(pcm_is_ready(pcm)) << pcm_get_error(pcm);
+    EXPECT_EQ(calls->status_maps, 1u);
+    EXPECT_EQ(calls->control_maps, 1u);
+
+    WritePeriods(pcm, kPeriodCount);
+    EXPECT_EQ(calls->frames, kPeriodSize * kPeriodCount);
+    EXPECT_EQ(pcm_mmap_avail(pcm), (int) (kPeriodSize * kPeriodCount));
+    pcm_close(pcm);
+}
+
+TEST_F(PcmPluginTest, OlderPluginsDoNotShareStatusAndControl) {
+    // a pcm_plugin_ext_ops built without the flags
+    ext_ops->size = offsetof(pcm_plugin_ext_ops, flags);
+
+    pcm *pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &kStubConfig);
+    ASSERT_TRUE(pcm_is_ready(pcm)) << pcm_get_error(pcm);
+    EXPECT_EQ(calls->status_maps, 0u);
+    EXPECT_EQ(calls->control_maps, 0u);
+
+    WritePeriods(pcm, kPeriodCount);
+    EXPECT_EQ(calls->frames, kPeriodSize * kPeriodCount);
+    EXPECT_EQ(pcm_mmap_avail(pcm), (int) (kPeriodSize * kPeriodCount));
+    pcm_close(pcm);
+
+    ext_ops->size = sizeof(*ext_ops);
+    ext_ops->flags = 0;
+
+    pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &kStubConfig);
+    ASSERT_TRUE(pcm_is_ready(pcm)) << pcm_get_error(pcm);
+    EXPECT_EQ(calls->status_maps, 0u);
+    EXPECT_EQ(calls->control_maps, 0u);
+    pcm_close(pcm);
+}
+
+TEST_F(PcmPluginTest, ListedValuesNarrowTheConstraints) {
+    static constexpr unsigned int kRates[] = {44100, 16000, 48000, 4000};
+    static constexpr unsigned int kPeriodSizes[] = {kPeriodSize, kPeriodSize * 2};
+    pcm_plugin_hw_lists lists = {};
+    lists.rate = {std::size(kRates), kRates};
+    lists.period_size = {std::size(kPeriodSizes), kPeriodSizes};
+    calls->lists = &lists;
+
+    // the values outside of the ranges of the constraints are ignored
+    pcm_params *params = pcm_params_get(kStubCard, kStubDevice, PCM_OUT);
+    ASSERT_NE(params, nullptr);
+    EXPECT_EQ(pcm_params_get_min(params, PCM_PARAM_RATE), 16000u);
+    EXPECT_EQ(pcm_params_get_max(params, PCM_PARAM_RATE), 48000u);
+    EXPECT_EQ(pcm_params_get_min(params, PCM_PARAM_PERIOD_SIZE), kPeriodSize);
+    EXPECT_EQ(pcm_params_get_max(params, PCM_PARAM_PERIOD_SIZE), kPeriodSize * 2);
+    // the channels are not listed, and keep their range
+    EXPECT_EQ(pcm_params_get_min(params, PCM_PARAM_CHANNELS), 1u);
+    EXPECT_EQ(pcm_params_get_max(params, PCM_PARAM_CHANNELS), 8u);
+    pcm_params_free(params);
+
+    pcm *pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &kStubConfig);
+    ASSERT_TRUE(pcm_is_ready(pcm)) << pcm_get_error(pcm);
+    pcm_close(pcm);
+
+    // within the range, but not listed
+    pcm_config config = kStubConfig;
+    config.rate = 32000;
+    pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &config);
+    EXPECT_FALSE(pcm_is_ready(pcm));
+    pcm_close(pcm);
+}
+
+TEST_F(PcmPluginTest, ListsOutsideOfTheConstraintsFailToOpen) {
+    static constexpr unsigned int kRates[] = {4000, 384000};
+    pcm_plugin_hw_lists lists = {};
+    lists.rate = {std::size(kRates), kRates};
+    calls->lists = &lists;
+
+    pcm *pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &kStubConfig);
+    EXPECT_FALSE(pcm_is_ready(pcm));
+    pcm_close(pcm);
+
+    EXPECT_EQ(pcm_params_get(kStubCard, kStubDevice, PCM_OUT), nullptr);
+}
+
+TEST_F(PcmPluginTest, QueuedFramesArePlayedBeforeDraining) {
+    pcm *pcm = pcm_open(kStubCard, kStubQueueDevice, PCM_OUT, &kStubConfig);
+    ASSERT_TRUE(pcm_is_ready(pcm)) << pcm_get_error(pcm);
+
+    ASSERT_EQ(pcm_prepare(pcm), 0);
+    WritePeriods(pcm, 1);
+    ASSERT_EQ(pcm_start(pcm), 0) << pcm_get_error(pcm);
+    EXPECT_EQ(calls->starts, 1u);
+
+    // more frames than the queue holds, for the writes to wait for the worker
+    WritePeriods(pcm, kPeriodCount * 2 - 1);
+
+    ASSERT_EQ(pcm_drain(pcm), 0) << pcm_get_error(pcm);
+    EXPECT_EQ(calls->drains, 1u);
+    EXPECT_EQ(calls->frames, kPeriodSize * kPeriodCount * 2);
+    EXPECT_EQ(pcm_get_delay(pcm), 0);
+
+    // the worker is stopped and joined
+    pcm_close(pcm);
+    EXPECT_EQ(calls->frames, kPeriodSize * kPeriodCount * 2);
+}
+
+TEST_F(PcmPluginTest, PollsPluginsWithoutEventsEachPeriod) {
+    // the pointers come from sync_ptr, which plays the frames held back
+    ext_ops->flags = 0;
+
+    pcm *pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &kStubConfig);
+    ASSERT_TRUE(pcm_is_ready(pcm)) << pcm_get_error(pcm);
+
+    pollfd pfd;
+    short revents;
+    ASSERT_EQ(pcm_poll_descriptor(pcm, &pfd), 0);
+
+    calls->hold = 1;
+    ASSERT_EQ(pcm_prepare(pcm), 0);
+    WritePeriods(pcm, kPeriodCount);
+    ASSERT_EQ(pcm_start(pcm), 0) << pcm_get_error(pcm);
+
+    // the buffer is full: the descriptor is no longer readable once checked
+    ASSERT_EQ(poll(&pfd, 1, -1), 1);
+    ASSERT_EQ(pcm_poll_revents(pcm, &pfd, &revents), 0);
+    EXPECT_EQ(revents, 0);
+    pfd.revents = 0;
+    EXPECT_EQ(poll(&pfd, 1, 0), 0);
+
+    // it is again within a period of the frames being played
+    calls->hold = 0;
+    ASSERT_EQ(poll(&pfd, 1, 1000), 1);
+    ASSERT_EQ(pcm_poll_revents(pcm, &pfd, &revents), 0);
+    EXPECT_EQ(revents, POLLOUT);
+    EXPECT_EQ(calls->frames, kPeriodSize * kPeriodCount);
+
+    pcm_close(pcm);
+}
+
+TEST_F(PcmPluginTest, ParamsOutsideOfTheConstraintsFailToOpen) {
+    pcm_config config = kStubConfig;
+    config.rate = 4000;
+    pcm *pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &config);
+    EXPECT_FALSE(pcm_is_ready(pcm));
+    pcm_close(pcm);
+
+    config = kStubConfig;
+    config.format = PCM_FORMAT_S32_LE;
+    pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &config);
+    EXPECT_FALSE(pcm_is_ready(pcm));
+    pcm_close(pcm);
+
+    config = kStubConfig;
+    config.period_count = 16;
+    pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &config);
+    EXPECT_FALSE(pcm_is_ready(pcm));
+    pcm_close(pcm);
+}
+
+TEST_F(PcmPluginTest, PeriodSizeBoundsHoldForWideFrames) {
+    // 8 frames of 8 channels are 128 bytes, above the 64 bytes of the stub
+    pcm_config config = kStubConfig;
+    config.channels = 8;
+    config.period_size = 8;
+    pcm *pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &config);
+    ASSERT_TRUE(pcm_is_ready(pcm)) << pcm_get_error(pcm);
+    EXPECT_EQ(pcm_get_config(pcm)->period_size, 8u);
+    pcm_close(pcm);
+}
+
+TEST_F(PcmPluginTest, ChainedFramesGoThroughTheStages) {
+    pcm *pcm = pcm_open(kStubCard, kStubChainDevice, PCM_OUT, &kStubConfig);
+    ASSERT_TRUE(pcm_is_ready(pcm)) << pcm_get_error(pcm);
+
+    WritePeriods(pcm, kPeriodCount);
+    EXPECT_EQ(calls->frames, kPeriodSize * kPeriodCount);
+    // each of the two stages processes the frames once, and adds one to them
+    EXPECT_EQ(calls->processed, kPeriodSize * kPeriodCount * 2);
+    EXPECT_EQ(calls->sample, 2);
+
+    pcm_close(pcm);
+}
+
+TEST_F(PcmPluginTest, ChainedWritesReturnTheFramesPlayedBeforeAnError) {
+    // the slave takes half of the second period, then fails
+    calls->limit = kPeriodSize + kPeriodSize / 2;
+
+    pcm *pcm = pcm_open(kStubCard, kStubChainDevice, PCM_OUT, &kStubConfig);
+    ASSERT_TRUE(pcm_is_ready(pcm)) << pcm_get_error(pcm);
+
+    std::vector<int16_t> buffer(kPeriodSize * 2 * kChannels);
+    EXPECT_EQ(pcm_writei(pcm, buffer.data(), kPeriodSize * 2), (int) calls->limit);
+    EXPECT_EQ(calls->frames, calls->limit);
+    EXPECT_LT(pcm_writei(pcm, buffer.data(), kPeriodSize), 0);
+
+    pcm_close(pcm);
+}
+
+TEST_F(PcmPluginTest, ChainsInALoopFailToOpen) {
+    pcm *pcm = pcm_open(kStubCard, kStubLoopDevice, PCM_OUT, &kStubConfig);
+    EXPECT_FALSE(pcm_is_ready(pcm));
+    EXPECT_EQ(calls->processed, 0u);
+    pcm_close(pcm);
+}
+
+static bool StubIsLoaded() {
+    void *handle = dlopen(STUB_PCM_PLUGIN_LIB, RTLD_NOW | RTLD_NOLOAD);
+    if (handle) {
+        dlclose(handle);
+    }
+    return handle != nullptr;
+}
+
+// not a PcmPluginTest, which keeps the stub loaded
+TEST(PcmPluginLibraryTest, ResidentPluginsStayLoaded) {
+    if (StubIsLoaded()) {
+        GTEST_SKIP() << "the stub was made resident already";
+    }
+
+    pcm *pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &kStubConfig);
+    ASSERT_TRUE(pcm_is_ready(pcm)) << pcm_get_error(pcm);
+    // the devices of a library share it
+    struct pcm *other = pcm_open(kStubCard, kStubDevice, PCM_OUT, &kStubConfig);
+    ASSERT_TRUE(pcm_is_ready(other)) << pcm_get_error(other);
+    pcm_close(pcm);
+    EXPECT_TRUE(StubIsLoaded());
+    pcm_close(other);
+    EXPECT_FALSE(StubIsLoaded());
+
+    pcm = pcm_open(kStubCard, kStubResidentDevice, PCM_OUT, &kStubConfig);
+    ASSERT_TRUE(pcm_is_ready(pcm)) << pcm_get_error(pcm);
+    pcm_close(pcm);
+    EXPECT_TRUE(StubIsLoaded());
+}
+
+class PcmPluginCardTest : public PcmPluginTest {
+  protected:
+    void SetUp() override {
+        PcmPluginTest::SetUp();
+
+        // a definition of the stub card that the tests can remove
+        const char *defs_dir = getenv("TINYALSA_SNDCARD_DEFS_DIR");
+        ASSERT_NE(defs_dir, nullptr);
+        saved_defs_dir = defs_dir;
+        dir = std::filesystem::path{::testing::TempDir()} /
+                ("pcm_plugin_card_test." + std::to_string(getpid()));
+        std::filesystem::create_directories(dir);
+        conf = dir / ("card" + std::to_string(kStubCard) + ".conf");
+        RestoreDefinition();
+        setenv("TINYALSA_SNDCARD_DEFS_DIR", dir.c_str(), 1);
+        setenv("TINYALSA_SNDCARD_CACHE_DIR", dir.c_str(), 1);
+
+        // the definitions cached by the other tests are read from elsewhere
+        card_list_invalidate();
+    }
+
+    void TearDown() override {
+        card_list_invalidate();
+        setenv("TINYALSA_SNDCARD_DEFS_DIR", saved_defs_dir.c_str(), 1);
+        unsetenv("TINYALSA_SNDCARD_CACHE_DIR");
+        std::filesystem::remove_all(dir);
+        PcmPluginTest::TearDown();
+    }
+
+    void RemoveDefinition() {
+        std::filesystem::remove(conf);
+        std::filesystem::remove(dir / ("card" + std::to_string(kStubCard) + ".bin"));
+    }
+
+    void RestoreDefinition() {
+        std::filesystem::copy_file(std::filesystem::path{saved_defs_dir} / conf.filename(),
+                conf, std::filesystem::copy_options::overwrite_existing);
+    }
+
+    std::string saved_defs_dir;
+    std::filesystem::path dir;
+    std::filesystem::path conf;
+};
+
+TEST_F(PcmPluginCardTest, DevicesReopenWithoutParsingTheCardAgain) {
+    pcm *pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &kStubConfig);
+    ASSERT_TRUE(pcm_is_ready(pcm)) << pcm_get_error(pcm);
+    pcm_close(pcm);
+
+    // the definition is cached, once it is parsed
+    RemoveDefinition();
+    pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &kStubConfig);
+    EXPECT_TRUE(pcm_is_ready(pcm)) << pcm_get_error(pcm);
+    pcm_close(pcm);
+
+    // until it is dropped
+    card_list_invalidate();
+    pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &kStubConfig);
+    EXPECT_FALSE(pcm_is_ready(pcm));
+    pcm_close(pcm);
+
+    // the card is remembered to have no definition, until it is dropped again
+    RestoreDefinition();
+    card_list_invalidate();
+    pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &kStubConfig);
+    EXPECT_TRUE(pcm_is_ready(pcm)) << pcm_get_error(pcm);
+    pcm_close(pcm);
+}
+
+TEST_F(PcmPluginCardTest, DroppedDefinitionsOutliveTheirDevices) {
+    pcm *pcm = pcm_open(kStubCard, kStubDevice, PCM_OUT, &kStubConfig);
+    ASSERT_TRUE(pcm_is_ready(pcm)) << pcm_get_error(pcm);
+
+    RemoveDefinition();
+    card_list_invalidate();
+
+    // the open device still uses the dropped definition
+    WritePeriods(pcm, kPeriodCount);
+    EXPECT_EQ(calls->frames, kPeriodSize * kPeriodCount);
+
+    // which new devices do not get
+    struct pcm *other = pcm_open(kStubCard, kStubDevice, PCM_OUT, &kStubConfig);
+    EXPECT_FALSE(pcm_is_ready(other));
+    pcm_close(other);
+
+    RestoreDefinition();
+    card_list_invalidate();
+    other = pcm_open(kStubCard, kStubDevice, PCM_OUT, &kStubConfig);
+    EXPECT_TRUE(pcm_is_ready(other)) << pcm_get_error(other);
+    pcm_close(other);
+
+    // the dropped definition is freed with its last device
+    pcm_close(pcm);
+}
+
+} // namespace testing
+} // namespace tinyalsa
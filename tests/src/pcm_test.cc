@@ -26,6 +26,7 @@
 ** DAMAGE.
 */
 
+#include <cerrno>
 #include <cstdio>
 #include <fstream>
 #include <iostream>
@@ -36,6 +37,7 @@
 
 #include <gtest/gtest.h>
 
+#include "tinyalsa/card.h"
 #include "tinyalsa/pcm.h"
 
 #include "pcm_test_device.h"
@@ -92,6 +94,35 @@ TEST(PcmTest, OpenAndCloseOutPcm) {
     ASSERT_EQ(pcm_close(pcm_object), 0);
 }
 
+TEST(PcmTest, OpenByCardId) {
+    const card_list *list = card_list_get(CARD_LIST_CACHED);
+    ASSERT_NE(list, nullptr);
+    std::string id;
+    for (unsigned int n = 0; n < list->num_cards; n++) {
+        if (list->cards[n].card == kLoopbackCard) {
+            id = list->cards[n].id;
+        }
+    }
+    ASSERT_FALSE(id.empty());
+    const card_desc *desc = card_list_find(list, id.c_str());
+    ASSERT_NE(desc, nullptr);
+    EXPECT_EQ(desc->card, kLoopbackCard);
+    card_list_free(list);
+
+    EXPECT_EQ(card_get_index(id.c_str()), (int) kLoopbackCard);
+    EXPECT_EQ(card_get_index(("CARD=" + id).c_str()), (int) kLoopbackCard);
+    EXPECT_EQ(card_get_index("no such card"), -ENODEV);
+
+    std::string name = "hw:" + id + "," + std::to_string(kLoopbackPlaybackDevice);
+    pcm *pcm_object = pcm_open_by_name(name.c_str(), PCM_OUT, &kDefaultConfig);
+    ASSERT_TRUE(pcm_is_ready(pcm_object)) << pcm_get_error(pcm_object);
+    ASSERT_EQ(pcm_close(pcm_object), 0);
+
+    pcm_object = pcm_open_by_name("hw:no such card,0", PCM_OUT, &kDefaultConfig);
+    ASSERT_FALSE(pcm_is_ready(pcm_object));
+    ASSERT_EQ(pcm_close(pcm_object), 0);
+}
+
 TEST(PcmTest, OpenWithoutBlocking) {
     char loopback_device_info_path[120] = {};
     snprintf(loopback_device_info_path, sizeof(loopback_device_info_path),
@@ -0,0 +1,236 @@
+/* sndcardparser_test.cc
+**
+** Copyright 2026, The Android Open Source Project
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are met:
+**     * Redistributions of source code must retain the above copyright
+**       notice, this list of conditions and the following disclaimer.
+**     * Redistributions in binary form must reproduce the above copyright
+**       notice, this list of conditions and the following disclaimer in the
+**       documentation and/or other materials provided with the distribution.
+**     * Neither the name of The Android Open Source Project nor the names of
+**       its contributors may be used to endorse or promote products derived
+**       from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY The Android Open Source Project ``AS IS'' AND
+** ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+** IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+** ARE DISCLAIMED. IN NO EVENT SHALL The Android Open Source Project BE LIABLE
+** FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+** DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+** SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+** CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+** LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+** OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+** DAMAGE.
+*/
+
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "tinyalsa/plugin.h"
+
+namespace tinyalsa {
+namespace testing {
+
+static constexpr unsigned int kCard = 7;
+
+static constexpr char kDefinition[] = R"(# a comment
+; another one
+[mixer]
+type = plugin
+so-name = libmixer_plugin.so
+
+[pcm 0]
+type = plugin
+name = "  Spaced Out  "
+description =   trimmed value
+playback = 0
+playback = 1
+period = 0x100
+
+[ pcm  2 ]
+type = hw
+name = Cached Name
+)";
+
+class SndCardParserTest : public ::testing::Test {
+  protected:
+    virtual void SetUp() override {
+        char dir_template[] = "/tmp/tinyalsa_sndcard_XXXXXX";
+        ASSERT_NE(mkdtemp(dir_template), nullptr);
+        dir = dir_template;
+        conf = dir + "/card" + std::to_string(kCard) + ".conf";
+        cache = dir + "/card" + std::to_string(kCard) + ".bin";
+        setenv("TINYALSA_SNDCARD_DEFS_DIR", dir.c_str(), 1);
+        setenv("TINYALSA_SNDCARD_CACHE_DIR", dir.c_str(), 1);
+
+        handle = dlopen("libsndcardparser.so", RTLD_NOW);
+        ASSERT_NE(handle, nullptr) << dlerror();
+        ops = static_cast<snd_node_ops *>(dlsym(handle, "snd_card_ops"));
+        ASSERT_NE(ops, nullptr);
+    }
+
+    virtual void TearDown() override {
+        if (handle) {
+            dlclose(handle);
+        }
+        unsetenv("TINYALSA_SNDCARD_DEFS_DIR");
+        unsetenv("TINYALSA_SNDCARD_CACHE_DIR");
+        unlink(conf.c_str());
+        unlink(cache.c_str());
+        rmdir(dir.c_str());
+    }
+
+    static void WriteFile(const std::string &path, const std::string &contents) {
+        std::ofstream file{path, std::ios::binary | std::ios::trunc};
+        file << contents;
+    }
+
+    static std::string ReadFile(const std::string &path) {
+        std::ifstream file{path, std::ios::binary};
+        return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    }
+
+    std::string GetStr(void *card, unsigned int device, const char *prop) {
+        char *value = nullptr;
+        void *node = ops->get_pcm(card, device);
+        if (!node || ops->get_str(node, prop, &value)) {
+            return "";
+        }
+        return value;
+    }
+
+    std::string dir;
+    std::string conf;
+    std::string cache;
+    void *handle = nullptr;
+    snd_node_ops *ops = nullptr;
+};
+
+TEST_F(SndCardParserTest, ParsesTheDefinition) {
+    WriteFile(conf, kDefinition);
+    void *card = ops->open_card(kCard);
+    ASSERT_NE(card, nullptr);
+
+    void *mixer = ops->get_mixer(card);
+    ASSERT_NE(mixer, nullptr);
+    char *value = nullptr;
+    ASSERT_EQ(ops->get_str(mixer, "so-name", &value), 0);
+    EXPECT_STREQ(value, "libmixer_plugin.so");
+
+    void *pcm = ops->get_pcm(card, 0);
+    ASSERT_NE(pcm, nullptr);
+    int ival = -1;
+    // the type takes names, and the numbers are in C notation
+    ASSERT_EQ(ops->get_int(pcm, "type", &ival), 0);
+    EXPECT_EQ(ival, 1);
+    ASSERT_EQ(ops->get_int(pcm, "period", &ival), 0);
+    EXPECT_EQ(ival, 0x100);
+    ASSERT_EQ(ops->get_str(pcm, "period", &value), 0);
+    EXPECT_STREQ(value, "0x100");
+    EXPECT_EQ(ops->get_int(pcm, "name", &ival), -EINVAL);
+    EXPECT_EQ(ops->get_int(pcm, "no such key", &ival), -ENOENT);
+
+    // quotes keep the blanks that are otherwise trimmed
+    EXPECT_EQ(GetStr(card, 0, "name"), "  Spaced Out  ");
+    EXPECT_EQ(GetStr(card, 0, "description"), "trimmed value");
+
+    // a key given again overrides the earlier value
+    ASSERT_EQ(ops->get_int(pcm, "playback", &ival), 0);
+    EXPECT_EQ(ival, 1);
+
+    EXPECT_EQ(GetStr(card, 2, "name"), "Cached Name");
+    EXPECT_EQ(ops->get_pcm(card, 1), nullptr);
+    ops->close_card(card);
+}
+
+TEST_F(SndCardParserTest, InvalidDefinitionsFailToOpen) {
+    for (const char *definition : {
+            "[pcm]\ntype = plugin\n",
+            "[pcm x]\ntype = plugin\n",
+            "[pcm 0\ntype = plugin\n",
+            "[pcm0]\ntype = plugin\n",
+            "[speaker]\ntype = plugin\n",
+            "type = plugin\n[pcm 0]\n",
+            "[pcm 0]\ntype\n",
+            "[pcm 0]\n = plugin\n",
+            "[pcm 0]\nname = \"unterminated\n",
+         }) {
+        WriteFile(conf, definition);
+        EXPECT_EQ(ops->open_card(kCard), nullptr) << definition;
+    }
+
+    unlink(conf.c_str());
+    EXPECT_EQ(ops->open_card(kCard), nullptr);
+}
+
+TEST_F(SndCardParserTest, ReusesTheCacheUntilTheDefinitionChanges) {
+    WriteFile(conf, kDefinition);
+    void *card = ops->open_card(kCard);
+    ASSERT_NE(card, nullptr);
+    ops->close_card(card);
+
+    // a value changed in the cache shows that the cache is read
+    std::string image = ReadFile(cache);
+    size_t pos = image.find("Cached Name");
+    ASSERT_NE(pos, std::string::npos);
+    image.replace(pos, 6, "Mapped");
+    WriteFile(cache, image);
+
+    card = ops->open_card(kCard);
+    ASSERT_NE(card, nullptr);
+    EXPECT_EQ(GetStr(card, 2, "name"), "Mapped Name");
+    ops->close_card(card);
+
+    // and compiled again once the definition changes
+    std::string definition = kDefinition;
+    definition += "description = changed\n";
+    WriteFile(conf, definition);
+
+    card = ops->open_card(kCard);
+    ASSERT_NE(card, nullptr);
+    EXPECT_EQ(GetStr(card, 2, "name"), "Cached Name");
+    EXPECT_EQ(GetStr(card, 2, "description"), "changed");
+    ops->close_card(card);
+    EXPECT_NE(ReadFile(cache).find("changed"), std::string::npos);
+}
+
+TEST_F(SndCardParserTest, RejectsCorruptedCaches) {
+    WriteFile(conf, kDefinition);
+    void *card = ops->open_card(kCard);
+    ASSERT_NE(card, nullptr);
+    ops->close_card(card);
+    const std::string image = ReadFile(cache);
+    ASSERT_FALSE(image.empty());
+
+    std::string truncated = image.substr(0, image.size() - 1);
+    std::string bad_magic = image;
+    bad_magic[0] ^= 0xff;
+    // the strings of the image are no longer terminated
+    std::string unterminated = image;
+    unterminated.back() = 'x';
+
+    for (const std::string &corrupted : {truncated, bad_magic, unterminated}) {
+        WriteFile(cache, corrupted);
+        card = ops->open_card(kCard);
+        ASSERT_NE(card, nullptr);
+        EXPECT_EQ(GetStr(card, 0, "name"), "  Spaced Out  ");
+        EXPECT_EQ(GetStr(card, 2, "name"), "Cached Name");
+        ops->close_card(card);
+        // the definition is compiled again, to replace the cache
+        EXPECT_EQ(ReadFile(cache), image);
+    }
+}
+
+} // namespace testing
+} // namespace tinyalsa
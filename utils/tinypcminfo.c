@@ -100,6 +100,33 @@ static inline const char *pcm_get_format_name(unsigned bit_index)
     return bit_index < ARRAY_SIZE(format_lookup) ? format_lookup[bit_index] : NULL;
 }
 
+static int list_pcms(void)
+{
+    const struct card_list *list;
+    const struct card_desc *desc;
+    const struct card_pcm *pcm;
+    unsigned int n, m;
+
+    list = card_list_get(0);
+    if (!list) {
+        fprintf(stderr, "Unable to list the cards\n");
+        return EXIT_FAILURE;
+    }
+
+    for (n = 0; n < list->num_cards; n++) {
+        desc = &list->cards[n];
+        printf("card %u: %s [%s]\n", desc->card, desc->id, desc->name);
+        for (m = 0; m < desc->num_pcms; m++) {
+            pcm = &desc->pcms[m];
+            printf("  device %u: %s [%s] playback %u, capture %u\n", pcm->device,
+                   pcm->id, pcm->name, pcm->playback_subdevices, pcm->capture_subdevices);
+        }
+    }
+
+    card_list_free(list);
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     unsigned int device = 0;
@@ -110,6 +137,7 @@ int main(int argc, char **argv)
         { "help",   'h', OPTPARSE_NONE     },
         { "card",   'D', OPTPARSE_REQUIRED },
         { "device", 'd', OPTPARSE_REQUIRED },
+        { "list",   'l', OPTPARSE_NONE     },
         { 0, 0, 0 }
     };
 
@@ -124,8 +152,11 @@ int main(int argc, char **argv)
         case 'd':
             device = atoi(opts.optarg);
             break;
+        case 'l':
+            return list_pcms();
         case 'h':
             fprintf(stderr, "Usage: %s -D card -d device\n", argv[0]);
+            fprintf(stderr, "       %s -l\n", argv[0]);
             return 0;
         case '?':
             fprintf(stderr, "%s\n", opts.errmsg);